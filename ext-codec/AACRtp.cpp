@@ -99,6 +99,13 @@ bool AACRtpDecoder::inputRtp(const RtpPacket::Ptr &rtp, bool key_pos) {
         if (len <= 0) {
             break;
         }
+        if (_frame->_buffer.empty() && len == size) {
+            // 完整的audio unit在同一个rtp包内，直接引用rtp负载，无内存拷贝
+            outputFrame(rtp, ptr, len, _last_dts + i * dts_inc);
+            ptr += len;
+            au_header_ptr += 2;
+            continue;
+        }
         _frame->_buffer.append((char *)ptr, len);
         ptr += len;
         au_header_ptr += 2;
@@ -124,4 +131,14 @@ void AACRtpDecoder::flushData() {
     obtainFrame();
 }
 
+void AACRtpDecoder::outputFrame(const RtpPacket::Ptr &rtp, const uint8_t *ptr, size_t size, uint64_t dts) {
+    size_t prefix = 0;
+    if (size > ADTS_HEADER_LEN && (ptr[0] == 0xFF && (ptr[1] & 0xF0) == 0xF0)) {
+        // adts头打入了rtp包，不符合规范，兼容EasyPusher的bug
+        prefix = ADTS_HEADER_LEN;
+    }
+    auto buffer = std::make_shared<toolkit::BufferOffset<toolkit::Buffer::Ptr> >(rtp, ptr - (uint8_t *)rtp->data(), size);
+    RtpCodec::inputFrame(std::make_shared<FrameFromBuffer<FrameFromPtr> >(CodecAAC, std::move(buffer), dts, 0, prefix));
+}
+
 }//namespace mediakit
\ No newline at end of file
@@ -34,6 +34,7 @@ public:
 private:
     void obtainFrame();
     void flushData();
+    void outputFrame(const RtpPacket::Ptr &rtp, const uint8_t *ptr, size_t size, uint64_t dts);
 
 private:
     uint64_t _last_dts = 0;
@@ -22,6 +22,20 @@
 #include "mpeg4-avc.h"
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define H264_START_CODE_SSE2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define H264_START_CODE_AVX2
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define H264_START_CODE_NEON
+#endif
+
 using namespace std;
 using namespace toolkit;
 
@@ -50,13 +64,115 @@ bool getAVCInfo(const string &strSps, int &iVideoWidth, int &iVideoHeight, float
     return getAVCInfo(strSps.data(), strSps.size(), iVideoWidth, iVideoHeight, iVideoFps);
 }
 
-static const char *memfind(const char *buf, ssize_t len, const char *subbuf, ssize_t sublen) {
-    for (auto i = 0; i < len - sublen; ++i) {
-        if (memcmp(buf + i, subbuf, sublen) == 0) {
-            return buf + i;
+// 标量实现：起始码第3个字节大于1时，可以一次跳过3个字节
+static const char *findStartCode_c(const char *ptr, const char *end) {
+    auto p = (const uint8_t *)ptr;
+    auto last = (const uint8_t *)end - 2;
+    while (p < last) {
+        if (p[2] > 1) {
+            p += 3;
+        } else if (p[1]) {
+            p += 2;
+        } else if (p[0] || p[2] != 1) {
+            ++p;
+        } else {
+            return (const char *)p;
+        }
+    }
+    return nullptr;
+}
+
+#if defined(H264_START_CODE_SSE2) || defined(H264_START_CODE_AVX2)
+static inline int countTrailingZero(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+#if defined(H264_START_CODE_SSE2)
+static const char *findStartCode_sse2(const char *ptr, const char *end) {
+    auto zero = _mm_setzero_si128();
+    auto one = _mm_set1_epi8(1);
+    // 每轮比较16个候选位置，需要读取18个字节
+    while (end - ptr >= 18) {
+        auto b0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)ptr), zero);
+        auto b1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(ptr + 1)), zero);
+        auto b2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(ptr + 2)), one);
+        auto mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(b0, b1), b2));
+        if (mask) {
+            return ptr + countTrailingZero(mask);
+        }
+        ptr += 16;
+    }
+    return findStartCode_c(ptr, end);
+}
+#endif
+
+#if defined(H264_START_CODE_AVX2)
+__attribute__((target("avx2"))) static const char *findStartCode_avx2(const char *ptr, const char *end) {
+    auto zero = _mm256_setzero_si256();
+    auto one = _mm256_set1_epi8(1);
+    // 每轮比较32个候选位置，需要读取34个字节
+    while (end - ptr >= 34) {
+        auto b0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)ptr), zero);
+        auto b1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(ptr + 1)), zero);
+        auto b2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(ptr + 2)), one);
+        auto mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(b0, b1), b2));
+        if (mask) {
+            return ptr + countTrailingZero(mask);
+        }
+        ptr += 32;
+    }
+    return findStartCode_sse2(ptr, end);
+}
+#endif
+
+#if defined(H264_START_CODE_NEON)
+static const char *findStartCode_neon(const char *ptr, const char *end) {
+    auto zero = vdupq_n_u8(0);
+    auto one = vdupq_n_u8(1);
+    // 每轮比较16个候选位置，需要读取18个字节
+    while (end - ptr >= 18) {
+        auto b0 = vceqq_u8(vld1q_u8((const uint8_t *)ptr), zero);
+        auto b1 = vceqq_u8(vld1q_u8((const uint8_t *)ptr + 1), zero);
+        auto b2 = vceqq_u8(vld1q_u8((const uint8_t *)ptr + 2), one);
+        auto hit = vreinterpretq_u64_u8(vandq_u8(vandq_u8(b0, b1), b2));
+        if (vgetq_lane_u64(hit, 0) | vgetq_lane_u64(hit, 1)) {
+            // neon没有movemask指令，命中后由标量实现定位具体位置
+            return findStartCode_c(ptr, ptr + 18);
         }
+        ptr += 16;
+    }
+    return findStartCode_c(ptr, end);
+}
+#endif
+
+using StartCodeFinder = const char *(*)(const char *ptr, const char *end);
+
+static StartCodeFinder getStartCodeFinder() {
+#if defined(H264_START_CODE_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return findStartCode_avx2;
     }
-    return NULL;
+#endif
+#if defined(H264_START_CODE_SSE2)
+    return findStartCode_sse2;
+#elif defined(H264_START_CODE_NEON)
+    return findStartCode_neon;
+#else
+    return findStartCode_c;
+#endif
+}
+
+const char *findStartCode(const char *ptr, const char *end) {
+    // 运行时根据cpu指令集选择实现
+    static auto finder = getStartCodeFinder();
+    return finder(ptr, end);
 }
 
 void splitH264(
@@ -65,10 +181,11 @@ void splitH264(
     auto end = ptr + len;
     size_t next_prefix;
     while (true) {
-        auto next_start = memfind(start, end - start, "\x00\x00\x01", 3);
+        // 起始码后至少需要1个字节的nalu数据
+        auto next_start = findStartCode(start, end - 1);
         if (next_start) {
             //找到下一帧
-            if (*(next_start - 1) == 0x00) {
+            if (next_start > start && *(next_start - 1) == 0x00) {
                 //这个是00 00 00 01开头
                 next_start -= 1;
                 next_prefix = 4;
@@ -21,6 +21,14 @@ namespace mediakit{
 void splitH264(const char *ptr, size_t len, size_t prefix, const std::function<void(const char *, size_t, size_t)> &cb);
 size_t prefixSize(const char *ptr, size_t len);
 
+/**
+ * 查找[ptr, end)范围内第一个00 00 01起始码，未找到返回nullptr
+ * 根据cpu指令集自动选择AVX2/SSE2/NEON或标量实现
+ * Find the first 00 00 01 start code in [ptr, end), return nullptr if not found
+ * AVX2/SSE2/NEON or scalar implementation is selected at runtime according to the cpu
+ */
+const char *findStartCode(const char *ptr, const char *end);
+
 template<typename Parent>
 class H264FrameHelper : public Parent{
 public:
@@ -36,8 +36,8 @@ H264RtpDecoder::H264RtpDecoder() {
     _frame = obtainFrame();
 }
 
-H264Frame::Ptr H264RtpDecoder::obtainFrame() {
-    auto frame = FrameImp::create<H264Frame>();
+H264Frame::Ptr H264RtpDecoder::obtainFrame(size_t capacity) {
+    auto frame = FrameImp::create<H264Frame>(capacity);
     frame->_prefix_size = 4;
     return frame;
 }
@@ -106,6 +106,10 @@ bool H264RtpDecoder::mergeFu(const RtpPacket::Ptr &rtp, const uint8_t *ptr, ssiz
     FuFlags *fu = (FuFlags *) (ptr + 1);
     if (fu->start_bit) {
         //该帧的第一个rtp包
+        if (_frame->_buffer.capacity() < _fu_size_hint) {
+            //按最近的帧大小预先申请内存，避免追加分片时扩容拷贝
+            _frame = obtainFrame(_fu_size_hint);
+        }
         _frame->_buffer.assign("\x00\x00\x00\x01", 4);
         _frame->_buffer.push_back(nal_suffix | fu->nal_type);
         _frame->_pts = stamp;
@@ -134,6 +138,8 @@ bool H264RtpDecoder::mergeFu(const RtpPacket::Ptr &rtp, const uint8_t *ptr, ssiz
 
     //确保下一次fu必须收到第一个包
     _fu_dropped = true;
+    //关键帧较大，帧大小提示缓慢回落
+    _fu_size_hint = MAX(_frame->size(), _fu_size_hint - _fu_size_hint / 8);
     //该帧最后一个rtp包,输出frame
     outputFrame(rtp, _frame);
     return false;
@@ -42,7 +42,7 @@ private:
     bool mergeFu(const RtpPacket::Ptr &rtp, const uint8_t *ptr, ssize_t size, uint64_t stamp, uint16_t seq);
 
     bool decodeRtp(const RtpPacket::Ptr &rtp);
-    H264Frame::Ptr obtainFrame();
+    H264Frame::Ptr obtainFrame(size_t capacity = 0);
     void outputFrame(const RtpPacket::Ptr &rtp, const H264Frame::Ptr &frame);
 
 private:
@@ -50,6 +50,8 @@ private:
     bool _gop_dropped = false;
     bool _fu_dropped = true;
     uint16_t _last_seq = 0;
+    // 最近fu分片帧的大小，用于预先申请组帧内存
+    size_t _fu_size_hint = 0;
     H264Frame::Ptr _frame;
     DtsGenerator _dts_generator;
 };
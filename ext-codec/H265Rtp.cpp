@@ -30,8 +30,8 @@ H265RtpDecoder::H265RtpDecoder() {
     _frame = obtainFrame();
 }
 
-H265Frame::Ptr H265RtpDecoder::obtainFrame() {
-    auto frame = FrameImp::create<H265Frame>();
+H265Frame::Ptr H265RtpDecoder::obtainFrame(size_t capacity) {
+    auto frame = FrameImp::create<H265Frame>(capacity);
     frame->_prefix_size = 4;
     return frame;
 }
@@ -126,6 +126,10 @@ bool H265RtpDecoder::mergeFu(const RtpPacket::Ptr &rtp, const uint8_t *ptr, ssiz
     auto type = ptr[2] & 0x3f;
     if (s_bit) {
         //该帧的第一个rtp包
+        if (_frame->_buffer.capacity() < _fu_size_hint) {
+            //按最近的帧大小预先申请内存，避免追加分片时扩容拷贝
+            _frame = obtainFrame(_fu_size_hint);
+        }
         _frame->_buffer.assign("\x00\x00\x00\x01", 4);
         _frame->_buffer.push_back((type << 1) | (ptr[0] & 0x81));
         _frame->_buffer.push_back(ptr[1]);
@@ -168,6 +172,8 @@ bool H265RtpDecoder::mergeFu(const RtpPacket::Ptr &rtp, const uint8_t *ptr, ssiz
 
     //确保下一次fu必须收到第一个包
     _fu_dropped = true;
+    //关键帧较大，帧大小提示缓慢回落
+    _fu_size_hint = MAX(_frame->size(), _fu_size_hint - _fu_size_hint / 8);
     //该帧最后一个rtp包
     outputFrame(rtp, _frame);
     return false;
@@ -0,0 +1,444 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(ENABLE_FFMPEG) && defined(ENABLE_X264)
+#include <algorithm>
+#include "AbrLadder.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/onceToken.h"
+#include "Poller/EventPoller.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+namespace Abr {
+#define ABR_FIELD "abr."
+const string kLadder = ABR_FIELD "ladder";
+const string kGopSec = ABR_FIELD "gopSec";
+
+static onceToken token([]() {
+    mINI::Instance()[kLadder] = "";
+    mINI::Instance()[kGopSec] = 2;
+});
+} // namespace Abr
+
+INSTANCE_IMP(AbrManager)
+
+static vector<AbrProfile> parseLadder(const string &str) {
+    vector<AbrProfile> ret;
+    for (auto item : split(str, ",")) {
+        auto fields = split(trim(item), ":");
+        if (fields.size() != 3) {
+            WarnL << "Invalid abr profile: " << item;
+            continue;
+        }
+        auto size = split(fields[1], "x");
+        if (size.size() != 2) {
+            WarnL << "Invalid abr profile: " << item;
+            continue;
+        }
+        AbrProfile profile;
+        profile.name = trim(fields[0]);
+        // 宽高对齐到偶数，yuv420p要求
+        profile.width = atoi(size[0].data()) & ~1;
+        profile.height = atoi(size[1].data()) & ~1;
+        profile.bitrate = atoi(fields[2].data());
+        if (profile.name.empty() || profile.width <= 0 || profile.height <= 0 || profile.bitrate <= 0) {
+            WarnL << "Invalid abr profile: " << item;
+            continue;
+        }
+        ret.emplace_back(std::move(profile));
+    }
+    return ret;
+}
+
+////////////////////////////////////////AbrRendition////////////////////////////////////////
+
+AbrRendition::AbrRendition(const AbrProfile &profile, std::weak_ptr<AbrLadder> ladder) {
+    _profile = profile;
+    _ladder = std::move(ladder);
+    // 首帧必定为关键帧
+    _gop_index = UINT64_MAX;
+}
+
+AbrRendition::~AbrRendition() {
+    // 先停止编码线程再释放编码器
+    stopThread(true);
+}
+
+bool AbrRendition::start(const MediaTuple &tuple, const string &origin_url, float fps, const Track::Ptr &audio) {
+    _fps = fps;
+    _origin_url = origin_url;
+    _encoder = std::make_shared<H264Encoder>();
+    if (!_encoder->init(_profile.width, _profile.height, _fps, _profile.bitrate * 1000, true)) {
+        WarnL << "H264Encoder init failed: " << tuple.shortUrl();
+        return false;
+    }
+    _sws = std::make_shared<FFmpegSws>(AV_PIX_FMT_YUV420P, _profile.width, _profile.height);
+
+    _dev = std::make_shared<DevChannel>(tuple);
+    _dev->setMediaListener(shared_from_this());
+
+    VideoInfo info;
+    info.codecId = CodecH264;
+    info.iWidth = _profile.width;
+    info.iHeight = _profile.height;
+    info.iFrameRate = _fps;
+    info.iBitRate = _profile.bitrate * 1000;
+    _dev->initVideo(info);
+    if (audio) {
+        // 音频不转码，直接转发
+        _dev->addTrack(audio->clone());
+    }
+    _dev->addTrackCompleted();
+    startThread("abr " + _profile.name);
+    return true;
+}
+
+void AbrRendition::inputYUV(const FFmpegFrame::Ptr &frame, uint64_t gop_index) {
+    addEncodeTask([this, frame, gop_index]() { encode(frame, gop_index); });
+}
+
+void AbrRendition::encode(const FFmpegFrame::Ptr &frame, uint64_t gop_index) {
+    auto out = _sws->inputFrame(frame);
+    if (!out) {
+        return;
+    }
+    // 所有档位在同一个解码帧上切换关键帧，保证关键帧对齐
+    // 如果该帧因编码太慢被丢弃，则在本gop内的下一帧补上关键帧
+    bool force_idr = gop_index != _gop_index;
+    _gop_index = gop_index;
+
+    H264Encoder::H264Frame *out_frames;
+    int frames = _encoder->inputData((char **)out->get()->data, out->get()->linesize, out->get()->pts, &out_frames, force_idr);
+    for (int i = 0; i < frames; ++i) {
+        _dev->inputH264((char *)out_frames[i].pucData, out_frames[i].iLength, out_frames[i].dts, out_frames[i].pts);
+    }
+}
+
+void AbrRendition::inputAudio(const Frame::Ptr &frame) {
+    // 音频与视频在同一个编码线程中输入DevChannel，保证每个档位只有一个输入线程
+    addEncodeTask([this, frame]() { _dev->inputFrame(frame); });
+}
+
+uint64_t AbrRendition::getIdleTime() {
+    if (_dev->totalReaderCount()) {
+        _idle_ticker.resetTime();
+    }
+    return _idle_ticker.elapsedTime();
+}
+
+bool AbrRendition::close(MediaSource &sender) {
+    auto ladder = _ladder.lock();
+    if (!ladder) {
+        return false;
+    }
+    // 不能在DevChannel的回调中销毁自身，切换线程后再移除
+    auto tuple = ladder->getMediaTuple();
+    auto name = _profile.name;
+    EventPollerPool::Instance().getPoller()->async([tuple, name]() { AbrManager::Instance().stopRendition(tuple, name); }, false);
+    return true;
+}
+
+string AbrRendition::getOriginUrl(MediaSource &sender) const {
+    return _origin_url;
+}
+
+////////////////////////////////////////AbrLadder////////////////////////////////////////
+
+AbrLadder::AbrLadder(const MediaTuple &tuple) {
+    _tuple = tuple;
+}
+
+AbrLadder::~AbrLadder() {
+    // 先解绑源流，再停止解码线程，最后释放各档位的编码线程
+    if (_video_delegate) {
+        _video->delDelegate(_video_delegate);
+    }
+    if (_audio_delegate) {
+        _audio->delDelegate(_audio_delegate);
+    }
+    _decoder = nullptr;
+}
+
+bool AbrLadder::start() {
+    auto src = MediaSource::find(_tuple.vhost, _tuple.app, _tuple.stream);
+    if (!src) {
+        return false;
+    }
+    for (auto &track : src->getTracks(true)) {
+        if (track->getTrackType() == TrackVideo && !_video) {
+            _video = track;
+        } else if (track->getTrackType() == TrackAudio && !_audio) {
+            _audio = track;
+        }
+    }
+    if (!_video) {
+        WarnL << "No video track, abr ladder ignored: " << _tuple.shortUrl();
+        return false;
+    }
+    auto video = dynamic_pointer_cast<VideoTrack>(_video);
+    if (video && video->getVideoFps() > 0) {
+        _fps = video->getVideoFps();
+    }
+
+    // 所有档位共享同一个解码器，解码在独立线程中进行
+    _decoder = std::make_shared<FFmpegDecoder>(_video, 0);
+    _decoder->setOnDecode([this](const FFmpegFrame::Ptr &frame) { onDecode(frame); });
+    auto decoder = _decoder.get();
+    _video_delegate = _video->addDelegate([decoder](const Frame::Ptr &frame) { return decoder->inputFrame(frame, true, true); });
+    if (_audio) {
+        _audio_delegate = _audio->addDelegate([this](const Frame::Ptr &frame) {
+            onAudio(frame);
+            return true;
+        });
+    }
+    InfoL << "Abr ladder started: " << _tuple.shortUrl();
+    return true;
+}
+
+AbrRendition::Ptr AbrLadder::addRendition(const AbrProfile &profile) {
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _renditions.find(profile.name);
+        if (it != _renditions.end()) {
+            return it->second;
+        }
+    }
+
+    // 创建DevChannel时会同步切换到其他线程，不能加锁
+    auto tuple = _tuple;
+    tuple.stream += "_" + profile.name;
+    tuple.params.clear();
+    auto rendition = std::make_shared<AbrRendition>(profile, shared_from_this());
+    if (!rendition->start(tuple, _tuple.shortUrl(), _fps, _audio)) {
+        return nullptr;
+    }
+
+    lock_guard<mutex> lck(_mtx);
+    if (_stopped) {
+        // 创建期间所有档位已经被移除
+        return nullptr;
+    }
+    auto &ref = _renditions[profile.name];
+    if (!ref) {
+        ref = rendition;
+        InfoL << "Abr rendition started: " << tuple.shortUrl() << " " << profile.width << "x" << profile.height << " " << profile.bitrate << "kbps";
+    }
+    return ref;
+}
+
+AbrRendition::Ptr AbrLadder::removeRendition(const string &name, bool &stopped) {
+    AbrRendition::Ptr ret;
+    lock_guard<mutex> lck(_mtx);
+    auto it = _renditions.find(name);
+    if (it != _renditions.end()) {
+        ret = std::move(it->second);
+        _renditions.erase(it);
+        _stopped = _renditions.empty();
+    }
+    stopped = _stopped;
+    return ret;
+}
+
+vector<AbrRendition::Ptr> AbrLadder::removeIdleRendition(uint64_t max_idle_ms, bool &stopped) {
+    vector<AbrRendition::Ptr> ret;
+    lock_guard<mutex> lck(_mtx);
+    for (auto it = _renditions.begin(); it != _renditions.end();) {
+        if (it->second->getIdleTime() > max_idle_ms) {
+            InfoL << "Abr rendition stopped for none reader: " << _tuple.shortUrl() << " " << it->first;
+            ret.emplace_back(std::move(it->second));
+            it = _renditions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (!ret.empty()) {
+        _stopped = _renditions.empty();
+    }
+    stopped = _stopped;
+    return ret;
+}
+
+bool AbrLadder::stopIfEmpty() {
+    lock_guard<mutex> lck(_mtx);
+    if (_renditions.empty()) {
+        _stopped = true;
+    }
+    return _stopped;
+}
+
+bool AbrLadder::hasRendition(const string &name) {
+    lock_guard<mutex> lck(_mtx);
+    return _renditions.find(name) != _renditions.end();
+}
+
+void AbrLadder::onDecode(const FFmpegFrame::Ptr &frame) {
+    GET_CONFIG(float, gop_sec, Abr::kGopSec);
+    // 按源流时间戳划分gop，各档位的关键帧位置完全一致
+    auto gop_index = (uint64_t)frame->get()->pts / (uint64_t)(MAX(gop_sec, 0.1f) * 1000);
+    vector<AbrRendition::Ptr> renditions;
+    {
+        lock_guard<mutex> lck(_mtx);
+        renditions.reserve(_renditions.size());
+        for (auto &pr : _renditions) {
+            renditions.emplace_back(pr.second);
+        }
+    }
+    for (auto &rendition : renditions) {
+        rendition->inputYUV(frame, gop_index);
+    }
+}
+
+void AbrLadder::onAudio(const Frame::Ptr &frame) {
+    // 各档位在编码线程中异步输入音频，需要可缓存的帧
+    auto frame_cache = Frame::getCacheAbleFrame(frame);
+    lock_guard<mutex> lck(_mtx);
+    for (auto &pr : _renditions) {
+        pr.second->inputAudio(frame_cache);
+    }
+}
+
+////////////////////////////////////////AbrManager////////////////////////////////////////
+
+bool AbrManager::onStreamNotFound(const MediaInfo &info) {
+    GET_CONFIG_FUNC(vector<AbrProfile>, profiles, Abr::kLadder, [](const string &str) { return parseLadder(str); });
+    auto pos = info.stream.rfind('_');
+    if (profiles.empty() || pos == string::npos) {
+        return false;
+    }
+    auto name = info.stream.substr(pos + 1);
+    auto it = std::find_if(profiles.begin(), profiles.end(), [&](const AbrProfile &profile) { return profile.name == name; });
+    if (it == profiles.end()) {
+        return false;
+    }
+
+    MediaTuple tuple;
+    tuple.vhost = info.vhost;
+    tuple.app = info.app;
+    tuple.stream = info.stream.substr(0, pos);
+
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto base_pos = tuple.stream.rfind('_');
+        if (base_pos != string::npos) {
+            // 不允许对转码档位再次转码
+            auto base_it = _ladders.find(tuple.vhost + '/' + tuple.app + '/' + tuple.stream.substr(0, base_pos));
+            if (base_it != _ladders.end() && base_it->second->hasRendition(tuple.stream.substr(base_pos + 1))) {
+                return false;
+            }
+        }
+        if (!_timer) {
+            _timer = std::make_shared<Timer>(2.0f, []() {
+                AbrManager::Instance().onTimer();
+                return true;
+            }, nullptr);
+        }
+    }
+
+    // 档位创建期间转码可能被停止，此时重新创建
+    for (int i = 0; i < 2; ++i) {
+        AbrLadder::Ptr ladder;
+        {
+            lock_guard<mutex> lck(_mtx);
+            auto &ref = _ladders[tuple.shortUrl()];
+            if (!ref) {
+                auto new_ladder = std::make_shared<AbrLadder>(tuple);
+                if (!new_ladder->start()) {
+                    _ladders.erase(tuple.shortUrl());
+                    return false;
+                }
+                ref = new_ladder;
+            }
+            ladder = ref;
+        }
+        if (ladder->addRendition(*it)) {
+            return true;
+        }
+        lock_guard<mutex> lck(_mtx);
+        if (!ladder->stopIfEmpty()) {
+            // 其他档位还在，仅本档位创建失败
+            return false;
+        }
+        auto ladder_it = _ladders.find(tuple.shortUrl());
+        if (ladder_it != _ladders.end() && ladder_it->second == ladder) {
+            _ladders.erase(ladder_it);
+        }
+    }
+    return false;
+}
+
+void AbrManager::onMediaChanged(bool regist, MediaSource &sender) {
+    if (regist) {
+        return;
+    }
+    auto tuple = sender.getMediaTuple();
+    AbrLadder::Ptr ladder;
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _ladders.find(tuple.shortUrl());
+        if (it == _ladders.end() || MediaSource::find(tuple.vhost, tuple.app, tuple.stream)) {
+            // 不是转码的源流，或者该流的其他协议还在
+            return;
+        }
+        ladder = std::move(it->second);
+        _ladders.erase(it);
+    }
+    InfoL << "Abr ladder stopped for source unregistered: " << tuple.shortUrl();
+}
+
+void AbrManager::stopRendition(const MediaTuple &tuple, const string &name) {
+    // 在锁外释放，释放时会触发媒体注销事件
+    AbrLadder::Ptr ladder;
+    AbrRendition::Ptr rendition;
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _ladders.find(tuple.shortUrl());
+        if (it == _ladders.end()) {
+            return;
+        }
+        bool stopped;
+        rendition = it->second->removeRendition(name, stopped);
+        if (!stopped) {
+            return;
+        }
+        ladder = std::move(it->second);
+        _ladders.erase(it);
+    }
+    InfoL << "Abr ladder stopped: " << tuple.shortUrl();
+}
+
+void AbrManager::onTimer() {
+    GET_CONFIG(uint32_t, stream_none_reader_delay, General::kStreamNoneReaderDelayMS);
+    GET_CONFIG(uint32_t, max_wait_ms, General::kMaxStreamWaitTimeMS);
+    // 刚启动的档位需要等待播放器重新查找到流
+    auto max_idle_ms = MAX(stream_none_reader_delay, max_wait_ms);
+    // 在锁外释放，释放时会触发媒体注销事件
+    vector<AbrLadder::Ptr> removed_ladders;
+    vector<AbrRendition::Ptr> removed_renditions;
+    lock_guard<mutex> lck(_mtx);
+    for (auto it = _ladders.begin(); it != _ladders.end();) {
+        bool stopped;
+        auto renditions = it->second->removeIdleRendition(max_idle_ms, stopped);
+        removed_renditions.insert(removed_renditions.end(), renditions.begin(), renditions.end());
+        if (stopped) {
+            InfoL << "Abr ladder stopped: " << it->first;
+            removed_ladders.emplace_back(std::move(it->second));
+            it = _ladders.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+#endif // defined(ENABLE_FFMPEG) && defined(ENABLE_X264)
@@ -0,0 +1,194 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_ABRLADDER_H
+#define ZLMEDIAKIT_ABRLADDER_H
+
+#if defined(ENABLE_FFMPEG) && defined(ENABLE_X264)
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Poller/Timer.h"
+#include "Util/TimeTicker.h"
+#include "Codec/Transcode.h"
+#include "Codec/H264Encoder.h"
+#include "Common/Device.h"
+
+namespace Abr {
+// 转码档位，格式为 名称:宽x高:码率(kbps)，多个档位以逗号分隔，为空时关闭该功能
+// 播放 app/stream_名称 时按需启动对应档位的转码
+extern const std::string kLadder;
+// 转码输出的关键帧间隔，单位秒；各档位在相同的时间点输出关键帧，方便hls多码率切换
+extern const std::string kGopSec;
+} // namespace Abr
+
+/**
+ * 转码档位
+ */
+struct AbrProfile {
+    std::string name;
+    int width = 0;
+    int height = 0;
+    int bitrate = 0;
+};
+
+class AbrLadder;
+
+/**
+ * 单个转码档位，独立的编码线程，输出到DevChannel
+ */
+class AbrRendition : public mediakit::TaskManager, public mediakit::MediaSourceEvent, public std::enable_shared_from_this<AbrRendition> {
+public:
+    using Ptr = std::shared_ptr<AbrRendition>;
+
+    AbrRendition(const AbrProfile &profile, std::weak_ptr<AbrLadder> ladder);
+    ~AbrRendition() override;
+
+    /**
+     * 创建输出流
+     * @param tuple 输出流的媒体元组
+     * @param origin_url 源流url
+     * @param fps 源视频帧率
+     * @param audio 源音频track，为nullptr时不输出音频
+     */
+    bool start(const mediakit::MediaTuple &tuple, const std::string &origin_url, float fps, const mediakit::Track::Ptr &audio);
+
+    /**
+     * 输入共享的解码帧，在编码线程中缩放和编码
+     * @param gop_index 关键帧序号，变化时强制编码为idr帧
+     */
+    void inputYUV(const mediakit::FFmpegFrame::Ptr &frame, uint64_t gop_index);
+
+    /**
+     * 输入源音频帧，与视频一样在编码线程中输入，帧必须是可缓存的
+     */
+    void inputAudio(const mediakit::Frame::Ptr &frame);
+
+    /**
+     * 获取持续无人观看的时间，单位毫秒
+     */
+    uint64_t getIdleTime();
+
+    const AbrProfile &getProfile() const { return _profile; }
+
+protected:
+    ///////MediaSourceEvent override///////
+    bool close(mediakit::MediaSource &sender) override;
+    std::string getOriginUrl(mediakit::MediaSource &sender) const override;
+
+private:
+    void encode(const mediakit::FFmpegFrame::Ptr &frame, uint64_t gop_index);
+
+private:
+    float _fps = 25;
+    uint64_t _gop_index = 0;
+    AbrProfile _profile;
+    std::string _origin_url;
+    toolkit::Ticker _idle_ticker;
+    std::weak_ptr<AbrLadder> _ladder;
+    mediakit::FFmpegSws::Ptr _sws;
+    std::shared_ptr<mediakit::H264Encoder> _encoder;
+    mediakit::DevChannel::Ptr _dev;
+};
+
+/**
+ * 单个源流的多码率转码，所有档位共享一个解码器
+ */
+class AbrLadder : public std::enable_shared_from_this<AbrLadder> {
+public:
+    using Ptr = std::shared_ptr<AbrLadder>;
+
+    AbrLadder(const mediakit::MediaTuple &tuple);
+    ~AbrLadder();
+
+    /**
+     * 绑定源流的track并开始解码
+     */
+    bool start();
+
+    /**
+     * 添加转码档位，已存在时直接返回
+     * @return 创建失败或已经停止时返回nullptr
+     */
+    AbrRendition::Ptr addRendition(const AbrProfile &profile);
+
+    /**
+     * 移除转码档位，档位全部移除后标记为停止
+     * 返回被移除的档位，由调用者在锁外释放(释放时会触发媒体注销事件)
+     * @param stopped 是否已经停止
+     */
+    AbrRendition::Ptr removeRendition(const std::string &name, bool &stopped);
+
+    /**
+     * 移除无人观看的转码档位，档位全部移除后标记为停止
+     * @param stopped 是否已经停止
+     */
+    std::vector<AbrRendition::Ptr> removeIdleRendition(uint64_t max_idle_ms, bool &stopped);
+
+    /**
+     * 没有转码档位时标记为停止
+     * @return 是否已经停止
+     */
+    bool stopIfEmpty();
+
+    bool hasRendition(const std::string &name);
+
+    const mediakit::MediaTuple &getMediaTuple() const { return _tuple; }
+
+private:
+    void onDecode(const mediakit::FFmpegFrame::Ptr &frame);
+    void onAudio(const mediakit::Frame::Ptr &frame);
+
+private:
+    bool _stopped = false;
+    float _fps = 25;
+    mediakit::MediaTuple _tuple;
+    mediakit::Track::Ptr _video;
+    mediakit::Track::Ptr _audio;
+    mediakit::FrameWriterInterface *_video_delegate = nullptr;
+    mediakit::FrameWriterInterface *_audio_delegate = nullptr;
+    mediakit::FFmpegDecoder::Ptr _decoder;
+    std::mutex _mtx;
+    std::unordered_map<std::string, AbrRendition::Ptr> _renditions;
+};
+
+class AbrManager {
+public:
+    static AbrManager &Instance();
+
+    /**
+     * 播放的流不存在时尝试按需启动转码档位
+     * @return 是否为转码档位的流
+     */
+    bool onStreamNotFound(const mediakit::MediaInfo &info);
+
+    /**
+     * 源流注销时停止转码
+     */
+    void onMediaChanged(bool regist, mediakit::MediaSource &sender);
+
+    /**
+     * 停止转码档位
+     */
+    void stopRendition(const mediakit::MediaTuple &tuple, const std::string &name);
+
+private:
+    AbrManager() = default;
+    void onTimer();
+
+private:
+    std::mutex _mtx;
+    toolkit::Timer::Ptr _timer;
+    std::unordered_map<std::string, AbrLadder::Ptr> _ladders;
+};
+
+#endif // defined(ENABLE_FFMPEG) && defined(ENABLE_X264)
+#endif // ZLMEDIAKIT_ABRLADDER_H
@@ -0,0 +1,351 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(ENABLE_FFMPEG)
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include "Snapshot.h"
+#include "Util/util.h"
+#include "Util/onceToken.h"
+#include "Poller/Timer.h"
+#include "Poller/EventPoller.h"
+#include "Thread/ThreadPool.h"
+#include "Network/sockutil.h"
+#include "Common/config.h"
+#include "Codec/Transcode.h"
+#include "Rtmp/RtmpDemuxer.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+namespace API {
+const string kSnapInProcess = "api.snapInProcess";
+const string kSnapThreadNum = "api.snapThreadNum";
+
+static onceToken token([]() {
+    mINI::Instance()[kSnapInProcess] = 1;
+    mINI::Instance()[kSnapThreadNum] = 2;
+});
+} // namespace API
+
+// 排队中的解码任务上限，超过后截图请求直接失败
+static constexpr size_t kMaxPendingTask = 64;
+
+static ThreadPool &getSnapThreadPool() {
+    GET_CONFIG(int, thread_num, API::kSnapThreadNum);
+    // 不析构，防止进程退出时等待解码线程
+    static auto pool = new ThreadPool(MAX(thread_num, 1), ThreadPool::PRIORITY_LOWEST, true, false, "snap thread");
+    return *pool;
+}
+
+// 截图缓存与等待截图结果的请求
+static mutex s_snap_mtx;
+static unordered_map<string, pair<uint64_t /*expire ms*/, std::shared_ptr<string>>> s_snap_cache;
+static unordered_map<string, vector<Snapshot::onSnap>> s_snap_pending;
+
+static void onSnapResult(const string &key, float expire_sec, const std::shared_ptr<string> &image, const string &err_msg) {
+    vector<Snapshot::onSnap> cbs;
+    {
+        auto now = getCurrentMillisecond();
+        lock_guard<mutex> lck(s_snap_mtx);
+        auto it = s_snap_pending.find(key);
+        if (it != s_snap_pending.end()) {
+            cbs.swap(it->second);
+            s_snap_pending.erase(it);
+        }
+        // 清理过期的截图
+        for (auto it = s_snap_cache.begin(); it != s_snap_cache.end();) {
+            it = it->second.first < now ? s_snap_cache.erase(it) : std::next(it);
+        }
+        if (image && expire_sec > 0) {
+            s_snap_cache[key] = std::make_pair(now + (uint64_t)(expire_sec * 1000), image);
+        }
+    }
+    for (auto &cb : cbs) {
+        cb(image, err_msg);
+    }
+}
+
+/**
+ * 解码关键帧，只解码第一个视频track的第一帧
+ */
+class SnapDecoder : public TrackListener {
+public:
+    FFmpegFrame::Ptr decode(const AMFValue &metadata, const vector<RtmpPacket::Ptr> &packets) {
+        RtmpDemuxer demuxer;
+        demuxer.setTrackListener(this);
+        if (metadata) {
+            demuxer.loadMetaData(metadata);
+        }
+        for (auto &pkt : packets) {
+            demuxer.inputRtmp(pkt);
+        }
+        if (_decoder && !_frame) {
+            // 合帧器与解码器可能缓存了帧
+            _decoder->flush();
+        }
+        return _frame;
+    }
+
+protected:
+    bool addTrack(const Track::Ptr &track) override {
+        if (track->getTrackType() != TrackVideo || _decoder) {
+            return false;
+        }
+        _decoder = std::make_shared<FFmpegDecoder>(track, 1);
+        _decoder->setOnDecode([this](const FFmpegFrame::Ptr &frame) {
+            if (!_frame) {
+                _frame = frame;
+            }
+        });
+        track->addDelegate([this](const Frame::Ptr &frame) { return _decoder->inputFrame(frame, false, false); });
+        return true;
+    }
+
+private:
+    FFmpegFrame::Ptr _frame;
+    FFmpegDecoder::Ptr _decoder;
+};
+
+// 编码为jpeg或webp图片
+static std::shared_ptr<string> encodeImage(const FFmpegFrame::Ptr &frame, const string &format, int width, int height, string &err_msg) {
+    bool webp = format == "webp";
+    auto codec = webp ? avcodec_find_encoder_by_name("libwebp") : avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    if (!codec) {
+        err_msg = "image encoder not found: " + format;
+        return nullptr;
+    }
+
+    auto src_width = frame->get()->width;
+    auto src_height = frame->get()->height;
+    if (width <= 0 && height <= 0) {
+        width = src_width;
+        height = src_height;
+    } else if (width <= 0) {
+        width = src_width * height / MAX(src_height, 1);
+    } else if (height <= 0) {
+        height = src_height * width / MAX(src_width, 1);
+    }
+    // 宽高对齐到偶数
+    width = MAX(width & ~1, 2);
+    height = MAX(height & ~1, 2);
+
+    auto pix_fmt = webp ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_YUVJ420P;
+    FFmpegSws sws(pix_fmt, width, height);
+    auto out = sws.inputFrame(frame);
+    if (!out) {
+        err_msg = "scale frame failed";
+        return nullptr;
+    }
+
+    std::shared_ptr<AVCodecContext> ctx(avcodec_alloc_context3(codec), [](AVCodecContext *ctx) {
+        avcodec_free_context(&ctx);
+    });
+    ctx->width = width;
+    ctx->height = height;
+    ctx->pix_fmt = pix_fmt;
+    ctx->time_base = { 1, 25 };
+    // 固定图片质量
+    ctx->flags |= AV_CODEC_FLAG_QSCALE;
+    ctx->global_quality = FF_QP2LAMBDA * 3;
+    out->get()->quality = ctx->global_quality;
+    out->get()->pts = 0;
+    auto ret = avcodec_open2(ctx.get(), codec, nullptr);
+    if (ret < 0) {
+        err_msg = StrPrinter << "open image encoder failed: " << ret;
+        return nullptr;
+    }
+
+    std::shared_ptr<AVPacket> pkt(av_packet_alloc(), [](AVPacket *pkt) {
+        av_packet_free(&pkt);
+    });
+    ret = avcodec_send_frame(ctx.get(), out->get());
+    if (ret >= 0) {
+        // 刷新编码器
+        avcodec_send_frame(ctx.get(), nullptr);
+        ret = avcodec_receive_packet(ctx.get(), pkt.get());
+    }
+    if (ret < 0) {
+        err_msg = StrPrinter << "encode image failed: " << ret;
+        return nullptr;
+    }
+    return std::make_shared<string>((char *)pkt->data, pkt->size);
+}
+
+/**
+ * 单个流的截图任务，在poller线程中从rtmp环形缓存取最新的关键帧，在截图线程池中解码编码
+ */
+class SnapTask : public std::enable_shared_from_this<SnapTask> {
+public:
+    using Ptr = std::shared_ptr<SnapTask>;
+
+    SnapTask(string key, string format, int width, int height, float expire_sec)
+        : _key(std::move(key)), _format(std::move(format)), _width(width), _height(height), _expire_sec(expire_sec) {}
+
+    void start(const RtmpMediaSource::Ptr &src, float timeout_sec) {
+        auto self = shared_from_this();
+        auto poller = EventPollerPool::Instance().getPoller();
+        poller->async([self, src, poller, timeout_sec]() { self->attach(src, poller, timeout_sec); });
+    }
+
+private:
+    void attach(const RtmpMediaSource::Ptr &src, const EventPoller::Ptr &poller, float timeout_sec) {
+        _poller = poller;
+        src->getMetaData([&](const AMFValue &metadata) { _metadata = metadata; });
+        src->getConfigFrame([&](const RtmpPacket::Ptr &pkt) {
+            if (pkt->type_id == MSG_VIDEO) {
+                _packets.emplace_back(pkt);
+            }
+        });
+
+        // 定时器持有自身强引用，截图结束后释放
+        auto self = shared_from_this();
+        _timer = std::make_shared<Timer>(timeout_sec, [self]() {
+            self->onResult(nullptr, "wait video key frame timeout");
+            return false;
+        }, poller);
+
+        // 绑定时立即回放gop缓存，回放期间只记录最新的关键帧，回放完毕后再解码
+        weak_ptr<SnapTask> weak_self = self;
+        _reader = src->getRing()->attach(poller);
+        _reader->setDetachCB([weak_self]() {
+            if (auto strong_self = weak_self.lock()) {
+                strong_self->onResult(nullptr, "media source released");
+            }
+        });
+        _replaying = true;
+        _reader->setReadCB([weak_self](const RtmpMediaSource::RingDataType &pkt) {
+            if (auto strong_self = weak_self.lock()) {
+                strong_self->onRtmp(pkt);
+            }
+        });
+        _replaying = false;
+        if (_key_frame && !_decoding) {
+            // gop缓存中有关键帧，从最新的关键帧截图
+            decode();
+        }
+    }
+
+    void onRtmp(const RtmpMediaSource::RingDataType &pkt) {
+        if (_decoding) {
+            return;
+        }
+        pkt->for_each([&](const RtmpPacket::Ptr &rtmp) {
+            if (rtmp->type_id == MSG_VIDEO && rtmp->isVideoKeyFrame() && !rtmp->isConfigFrame()) {
+                _key_frame = rtmp;
+            }
+        });
+        if (!_key_frame || _replaying) {
+            return;
+        }
+        // gop缓存中没有关键帧，使用收到的第一个实时关键帧
+        decode();
+    }
+
+    void decode() {
+        _packets.emplace_back(std::move(_key_frame));
+        _decoding = true;
+
+        auto self = shared_from_this();
+        // 已经获取到关键帧，延后释放环形缓存读取器，防止在回调中析构自身
+        _poller->async([self]() { self->_reader = nullptr; }, false);
+
+        auto &pool = getSnapThreadPool();
+        if (pool.size() > kMaxPendingTask) {
+            onResult(nullptr, "too many snap tasks");
+            return;
+        }
+        pool.async([self]() {
+            string err_msg;
+            std::shared_ptr<string> image;
+            try {
+                auto frame = SnapDecoder().decode(self->_metadata, self->_packets);
+                if (frame) {
+                    image = encodeImage(frame, self->_format, self->_width, self->_height, err_msg);
+                } else {
+                    err_msg = "decode video key frame failed";
+                }
+            } catch (std::exception &ex) {
+                err_msg = ex.what();
+            }
+            self->onResult(image, err_msg);
+        });
+    }
+
+    void onResult(const std::shared_ptr<string> &image, const string &err_msg) {
+        if (_done.exchange(true)) {
+            return;
+        }
+        onSnapResult(_key, _expire_sec, image, err_msg);
+        auto self = shared_from_this();
+        _poller->async([self]() {
+            self->_reader = nullptr;
+            self->_timer = nullptr;
+        }, false);
+    }
+
+private:
+    bool _decoding = false;
+    bool _replaying = false;
+    std::atomic<bool> _done { false };
+    string _key;
+    string _format;
+    int _width;
+    int _height;
+    float _expire_sec;
+    AMFValue _metadata;
+    vector<RtmpPacket::Ptr> _packets;
+    RtmpPacket::Ptr _key_frame;
+    Timer::Ptr _timer;
+    EventPoller::Ptr _poller;
+    RtmpMediaSource::RingType::RingReader::Ptr _reader;
+};
+
+RtmpMediaSource::Ptr Snapshot::findSource(const string &play_url) {
+    MediaInfo info(play_url);
+    if (info.app.empty() || info.stream.empty()) {
+        return nullptr;
+    }
+    if (info.host != "127.0.0.1" && info.host != "localhost" && info.host != "::1" && info.host != SockUtil::get_local_ip()) {
+        // 不是本机的流
+        return nullptr;
+    }
+    return dynamic_pointer_cast<RtmpMediaSource>(MediaSource::find(RTMP_SCHEMA, info.vhost, info.app, info.stream));
+}
+
+void Snapshot::makeSnap(const RtmpMediaSource::Ptr &src, const string &format, int width, int height, float expire_sec, float timeout_sec, const onSnap &cb) {
+    string key = StrPrinter << src->getMediaTuple().shortUrl() << "|" << format << "|" << width << "x" << height;
+    std::shared_ptr<string> image;
+    {
+        lock_guard<mutex> lck(s_snap_mtx);
+        auto it = s_snap_cache.find(key);
+        if (it != s_snap_cache.end() && it->second.first > getCurrentMillisecond()) {
+            image = it->second.second;
+        } else {
+            auto &pending = s_snap_pending[key];
+            pending.emplace_back(cb);
+            if (pending.size() > 1) {
+                // 相同的截图任务正在进行中，合并请求
+                return;
+            }
+        }
+    }
+    if (image) {
+        // 命中截图缓存
+        cb(image, "");
+        return;
+    }
+    std::make_shared<SnapTask>(std::move(key), format, width, height, expire_sec)->start(src, timeout_sec);
+}
+
+#endif // ENABLE_FFMPEG
@@ -0,0 +1,61 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_SNAPSHOT_H
+#define ZLMEDIAKIT_SNAPSHOT_H
+
+#if defined(ENABLE_FFMPEG)
+#include <string>
+#include <memory>
+#include <functional>
+#include "Rtmp/RtmpMediaSource.h"
+
+namespace API {
+// 截图的流在本机时，是否在进程内截图，否则启动FFmpeg进程截图
+extern const std::string kSnapInProcess;
+// 进程内截图的解码线程数
+extern const std::string kSnapThreadNum;
+} // namespace API
+
+/**
+ * 进程内截图，从本机rtmp媒体源的gop缓存中取最近的视频关键帧，解码后编码为jpeg/webp图片
+ * 同一个流相同参数的并发截图请求会被合并，截图结果在内存中缓存expire_sec秒
+ */
+class Snapshot {
+public:
+    using onSnap = std::function<void(const std::shared_ptr<std::string> &image, const std::string &err_msg)>;
+
+    /**
+     * 根据播放url查找本机的rtmp媒体源
+     * @param play_url 播放url
+     * @return url不指向本机或流不存在时返回nullptr
+     */
+    static mediakit::RtmpMediaSource::Ptr findSource(const std::string &play_url);
+
+    /**
+     * 创建截图
+     * @param src rtmp媒体源
+     * @param format 图片格式，支持jpeg、webp
+     * @param width 输出宽度，为0时按高度等比缩放，宽高都为0时不缩放
+     * @param height 输出高度，为0时按宽度等比缩放
+     * @param expire_sec 截图缓存时间，单位秒
+     * @param timeout_sec 等待关键帧与解码的超时时间，单位秒
+     * @param cb 截图回调，失败时image为nullptr；在后台线程触发
+     */
+    static void makeSnap(const mediakit::RtmpMediaSource::Ptr &src, const std::string &format, int width, int height,
+                         float expire_sec, float timeout_sec, const onSnap &cb);
+
+private:
+    Snapshot() = delete;
+    ~Snapshot() = delete;
+};
+
+#endif // ENABLE_FFMPEG
+#endif // ZLMEDIAKIT_SNAPSHOT_H
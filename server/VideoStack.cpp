@@ -27,22 +27,10 @@ Param::~Param() { VideoStackManager::Instance().unrefChannel(id, width, height,
 
 Channel::Channel(const std::string& id, int width, int height, AVPixelFormat pixfmt)
     : _id(id), _width(width), _height(height), _pixfmt(pixfmt) {
-    _tmp = std::make_shared<mediakit::FFmpegFrame>();
-
-    _tmp->get()->width = _width;
-    _tmp->get()->height = _height;
-    _tmp->get()->format = _pixfmt;
-
-    av_frame_get_buffer(_tmp->get(), 32);
-
-    memset(_tmp->get()->data[0], 0, _tmp->get()->linesize[0] * _height);
-    memset(_tmp->get()->data[1], 0, _tmp->get()->linesize[1] * _height / 2);
-    memset(_tmp->get()->data[2], 0, _tmp->get()->linesize[2] * _height / 2);
-
-    auto frame = VideoStackManager::Instance().getBgImg();
+    // 每个通道绑定一个工作线程，多个通道的缩放分散在线程池中并行执行
+    _poller = toolkit::WorkThreadPool::Instance().getPoller();
     _sws = std::make_shared<mediakit::FFmpegSws>(_pixfmt, _width, _height);
-
-    _tmp = _sws->inputFrame(frame);
+    _frame = VideoStackManager::Instance().getBgImg();
 }
 
 void Channel::addParam(const std::weak_ptr<Param>& p) {
@@ -51,57 +39,56 @@ void Channel::addParam(const std::weak_ptr<Param>& p) {
 }
 
 void Channel::onFrame(const mediakit::FFmpegFrame::Ptr& frame) {
+    {
+        std::lock_guard<std::mutex> lock(_frame_mx);
+        bool scheduled = _next != nullptr;
+        _next = frame;
+        if (scheduled) {
+            // 上一帧还未绘制，直接替换为最新帧，跳过过期的帧
+            return;
+        }
+    }
     std::weak_ptr<Channel> weakSelf = shared_from_this();
-    _poller = _poller ? _poller : toolkit::WorkThreadPool::Instance().getPoller();
-    _poller->async([weakSelf, frame]() {
+    _poller->async([weakSelf]() {
         auto self = weakSelf.lock();
         if (!self) { return; }
-        self->_tmp = self->_sws->inputFrame(frame);
-
-        self->forEachParam([self](const Param::Ptr& p) { self->fillBuffer(p); });
+        {
+            std::lock_guard<std::mutex> lock(self->_frame_mx);
+            self->_frame = std::move(self->_next);
+            self->_next = nullptr;
+        }
+        self->forEachParam([self](const Param::Ptr& p) { self->drawTo(p); });
     });
 }
 
 void Channel::forEachParam(const std::function<void(const Param::Ptr&)>& func) {
-    for (auto& wp : _params) {
-        if (auto sp = wp.lock()) { func(sp); }
+    std::vector<Param::Ptr> params;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mx);
+        params.reserve(_params.size());
+        for (auto& wp : _params) {
+            if (auto sp = wp.lock()) { params.emplace_back(std::move(sp)); }
+        }
     }
+    for (auto& p : params) { func(p); }
 }
 
 void Channel::fillBuffer(const Param::Ptr& p) {
-    if (auto buf = p->weak_buf.lock()) { copyData(buf, p); }
+    std::weak_ptr<Channel> weakSelf = shared_from_this();
+    std::weak_ptr<Param> weakParam = p;
+    _poller->async([weakSelf, weakParam]() {
+        auto self = weakSelf.lock();
+        auto p = weakParam.lock();
+        if (self && p) { self->drawTo(p); }
+    });
 }
 
-void Channel::copyData(const mediakit::FFmpegFrame::Ptr& buf, const Param::Ptr& p) {
-
-    switch (p->pixfmt) {
-        case AV_PIX_FMT_YUV420P: {
-            for (int i = 0; i < p->height; i++) {
-                memcpy(buf->get()->data[0] + buf->get()->linesize[0] * (i + p->posY) + p->posX,
-                       _tmp->get()->data[0] + _tmp->get()->linesize[0] * i, _tmp->get()->width);
-            }
-            // 确保height为奇数时，也能正确的复制到最后一行uv数据
-            for (int i = 0; i < (p->height + 1) / 2; i++) {
-                // U平面
-                memcpy(buf->get()->data[1] + buf->get()->linesize[1] * (i + p->posY / 2) +
-                           p->posX / 2,
-                       _tmp->get()->data[1] + _tmp->get()->linesize[1] * i, _tmp->get()->width / 2);
-
-                // V平面
-                memcpy(buf->get()->data[2] + buf->get()->linesize[2] * (i + p->posY / 2) +
-                           p->posX / 2,
-                       _tmp->get()->data[2] + _tmp->get()->linesize[2] * i, _tmp->get()->width / 2);
-            }
-            break;
-        }
-        case AV_PIX_FMT_NV12: {
-            // TODO: 待实现
-            break;
-        }
-
-        default: WarnL << "No support pixformat: " << av_get_pix_fmt_name(p->pixfmt); break;
-    }
+void Channel::drawTo(const Param::Ptr& p) {
+    auto buf = p->weak_buf.lock();
+    if (!buf || !_frame) { return; }
+    _sws->inputFrame(_frame, buf, p->posX, p->posY);
 }
+
 void StackPlayer::addChannel(const std::weak_ptr<Channel>& chn) {
     std::lock_guard<std::recursive_mutex> lock(_mx);
     _channels.push_back(chn);
@@ -260,17 +247,22 @@ void VideoStack::setParam(const Params& params) {
 
 void VideoStack::start() {
     _thread = std::thread([&]() {
-        uint64_t pts = 0;
-        int frameInterval = 1000 / _fps;
-        auto lastEncTP = std::chrono::steady_clock::now();
+        toolkit::setThreadName(("stack " + _id).data());
+        uint64_t frames = 0;
+        auto interval = std::chrono::microseconds((int64_t)(1000 * 1000 / _fps));
+        auto next = std::chrono::steady_clock::now();
         while (!_isExit) {
-            if (std::chrono::steady_clock::now() - lastEncTP >
-                std::chrono::milliseconds(frameInterval)) {
-                lastEncTP = std::chrono::steady_clock::now();
-
-                _dev->inputYUV((char**)_buffer->get()->data, _buffer->get()->linesize, pts);
-                pts += frameInterval;
+            // 各通道已经在线程池中把最新帧绘制到画布上，这里只负责按帧率编码
+            _dev->inputYUV((char**)_buffer->get()->data, _buffer->get()->linesize, (uint64_t)(frames++ * 1000 / _fps));
+
+            next += interval;
+            auto now = std::chrono::steady_clock::now();
+            if (next < now - interval) {
+                // 编码太慢，不追赶已经落后的帧
+                next = now;
             }
+            // 休眠到下一帧，避免空转占满一个cpu核心
+            std::this_thread::sleep_until(next);
         }
     });
 }
@@ -53,14 +53,17 @@ public:
 
     void addParam(const std::weak_ptr<Param>& p);
 
+    // 输入新的解码帧，在所属线程中缩放到各画布；处理不过来时只保留最新的一帧
     void onFrame(const mediakit::FFmpegFrame::Ptr& frame);
 
+    // 把当前帧绘制到指定画布区域(画布重置后调用)
     void fillBuffer(const Param::Ptr& p);
 
 protected:
     void forEachParam(const std::function<void(const Param::Ptr&)>& func);
 
-    void copyData(const mediakit::FFmpegFrame::Ptr& buf, const Param::Ptr& p);
+    // 缩放后直接写入画布区域，不经过中间帧拷贝
+    void drawTo(const Param::Ptr& p);
 
 private:
     std::string _id;
@@ -68,7 +71,11 @@ private:
     int _height;
     AVPixelFormat _pixfmt;
 
-    mediakit::FFmpegFrame::Ptr _tmp;
+    // 当前帧，仅在_poller线程中访问
+    mediakit::FFmpegFrame::Ptr _frame;
+    // 等待绘制的最新帧
+    std::mutex _frame_mx;
+    mediakit::FFmpegFrame::Ptr _next;
 
     std::recursive_mutex _mx;
     std::vector<std::weak_ptr<Param>> _params;
@@ -138,7 +145,7 @@ private:
 
     mediakit::DevChannel::Ptr _dev;
 
-    bool _isExit;
+    std::atomic<bool> _isExit;
 
     std::thread _thread;
 };
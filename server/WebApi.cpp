@@ -39,6 +39,7 @@
 #include "WebApi.h"
 #include "WebHook.h"
 #include "FFmpegSource.h"
+#include "Snapshot.h"
 
 #include "Common/config.h"
 #include "Common/MediaSource.h"
@@ -48,6 +49,7 @@
 #include "Pusher/PusherProxy.h"
 #include "Rtp/RtpProcess.h"
 #include "Record/MP4Reader.h"
+#include "Record/RecordIO.h"
 
 #if defined(ENABLE_RTPPROXY)
 #include "Rtp/RtpServer.h"
@@ -67,6 +69,10 @@
 #include "VideoStack.h"
 #endif
 
+#if defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
+#include "AbrLadder.h"
+#endif
+
 using namespace std;
 using namespace Json;
 using namespace toolkit;
@@ -518,6 +524,22 @@ void getStatisticJson(const function<void(Value &val)> &cb) {
 
     val["RtpPacket"] = (Json::UInt64)(ObjectStatistic<RtpPacket>::count());
     val["RtmpPacket"] = (Json::UInt64)(ObjectStatistic<RtmpPacket>::count());
+
+    // 录制写盘统计
+    val["RecordIO"] = Value(arrayValue);
+    RecordIO::Instance().getStatistic([&](const string &group, const RecordIOStat &stat) {
+        Value item;
+        uint64_t count = stat.write_count;
+        item["path"] = group;
+        item["writeCount"] = (Json::UInt64)count;
+        item["writeBytes"] = (Json::UInt64)stat.write_bytes;
+        item["avgLatencyMS"] = count ? stat.write_time_us / count / 1000.0 : 0;
+        item["maxLatencyMS"] = stat.max_time_us / 1000.0;
+        item["errorCount"] = (Json::UInt64)stat.error_count;
+        item["dropBytes"] = (Json::UInt64)stat.drop_bytes;
+        item["pendingBytes"] = (Json::UInt64)stat.pending_bytes;
+        val["RecordIO"].append(item);
+    });
 #ifdef ENABLE_MEM_DEBUG
     auto bytes = getTotalMemUsage();
     val["totalMemUsage"] = (Json::UInt64) bytes;
@@ -728,6 +750,13 @@ void installWebApi() {
         val["data"].append(obj);
     });
 
+    // 获取hook请求统计
+    // 测试url http://127.0.0.1/index/api/getHookStatistic
+    api_regist("/index/api/getHookStatistic", [](API_ARGS_MAP) {
+        CHECK_SECRET();
+        val["data"] = getHookStatistic();
+    });
+
     //设置服务器配置
     //测试url(比如关闭http api调试) http://127.0.0.1/index/api/setServerConfig?api.apiDebug=0
     //你也可以通过http post方式传参，可以通过application/x-www-form-urlencoded或application/json方式传参
@@ -932,6 +961,21 @@ void installWebApi() {
         }
         src->getOwnerPoller()->async([=]() mutable {
             auto val = makeMediaSourceJson(*src);
+            auto muxer = src->getMuxer();
+            if (muxer) {
+                // 开启protocol.parallel_mux_ms时各协议复用阶段的队列深度与延时
+                for (auto &info : muxer->getMuxStageInfo()) {
+                    Value obj;
+                    obj["name"] = info.name;
+                    obj["thread"] = info.thread;
+                    obj["queue_size"] = (Json::UInt64)info.queue_size;
+                    obj["frames"] = (Json::UInt64)info.frames;
+                    obj["drop_frames"] = (Json::UInt64)info.drop_frames;
+                    obj["latency_us"] = (Json::UInt64)info.latency_us;
+                    obj["max_latency_us"] = (Json::UInt64)info.max_latency_us;
+                    val["mux_stages"].append(obj);
+                }
+            }
             val["code"] = API::Success;
             invoker(200, headerOut, val.toStyledString());
         });
@@ -1757,6 +1801,29 @@ void installWebApi() {
         CHECK_ARGS("url", "timeout_sec", "expire_sec");
         GET_CONFIG(string, snap_root, API::kSnapRoot);
 
+#if defined(ENABLE_FFMPEG)
+        GET_CONFIG(bool, snap_in_process, API::kSnapInProcess);
+        string format = allArgs["format"].empty() ? "jpeg" : allArgs["format"];
+        if (format != "jpeg" && format != "webp") {
+            throw InvalidArgsException("format only support jpeg or webp");
+        }
+        auto src = snap_in_process ? Snapshot::findSource(allArgs["url"]) : nullptr;
+        if (src) {
+            //本机的流，直接从gop缓存中截图，不启动FFmpeg进程
+            Snapshot::makeSnap(src, format, allArgs["width"], allArgs["height"], allArgs["expire_sec"], allArgs["timeout_sec"],
+                               [invoker, allArgs, format](const std::shared_ptr<string> &image, const string &err_msg) {
+                if (!image) {
+                    responseSnap("", allArgs.parser.getHeader(), invoker, err_msg);
+                    return;
+                }
+                StrCaseMap headerOut;
+                headerOut["Content-Type"] = HttpFileManager::getContentType(("." + format).data());
+                invoker.responseFile(allArgs.parser.getHeader(), headerOut, *image, false, false);
+            });
+            return;
+        }
+#endif
+
         bool have_old_snap = false, res_old_snap = false;
         int expire_sec = allArgs["expire_sec"];
         auto scan_path = File::absolutePath(MD5(allArgs["url"]).hexdigest(), snap_root) + "/";
@@ -1914,6 +1981,47 @@ void installWebApi() {
         obj->safeShutdown(SockException(Err_shutdown, "deleted by http api"));
         invoker(200, headerOut, "");
     });
+
+    // 获取webrtc会话的发送端带宽估算结果
+    // 测试url http://127.0.0.1/index/api/getWebRtcBandwidth?id=xxx
+    api_regist("/index/api/getWebRtcBandwidth", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        CHECK_ARGS("id");
+        auto obj = WebRtcTransportManager::Instance().getItem(allArgs["id"]);
+        if (!obj) {
+            throw ApiRetException("can not find the webrtc session", API::NotFound);
+        }
+        obj->getPoller()->async([obj, val, headerOut, invoker]() mutable {
+            auto &bwe = obj->getBwe();
+            val["data"]["estimated_bitrate"] = (Json::UInt)obj->getEstimatedBitrate();
+            val["data"]["acked_bitrate"] = (Json::UInt)bwe.getAckedBitrate();
+            val["data"]["loss_rate"] = bwe.getLossRate();
+            val["data"]["bandwidth_usage"] = SendSideBwe::getBandwidthUsageName(bwe.getBandwidthUsage());
+            val["data"]["drop_rtp_count"] = (Json::UInt64)obj->getDropRtpCount();
+            invoker(200, headerOut, val.toStyledString());
+        });
+    });
+
+    // 指定webrtc播放simulcast推流时的层，rid为空时根据带宽估算自动切换
+    // 测试url http://127.0.0.1/index/api/setWebRtcSimulcastLayer?id=xxx&rid=h
+    api_regist("/index/api/setWebRtcSimulcastLayer", [](API_ARGS_MAP_ASYNC) {
+        CHECK_SECRET();
+        CHECK_ARGS("id");
+        auto obj = dynamic_pointer_cast<WebRtcPlayer>(WebRtcTransportManager::Instance().getItem(allArgs["id"]));
+        if (!obj) {
+            throw ApiRetException("can not find the webrtc player", API::NotFound);
+        }
+        std::string rid = allArgs["rid"];
+        obj->getPoller()->async([obj, rid, val, headerOut, invoker]() mutable {
+            if (!obj->setSimulcastLayer(rid)) {
+                val["code"] = API::OtherFailed;
+                val["msg"] = "not simulcast stream or rid not found";
+            }
+            // 切换在目标层的关键帧处进行，此处返回的是当前正在播放的层
+            val["data"]["rid"] = obj->getSimulcastLayer();
+            invoker(200, headerOut, val.toStyledString());
+        });
+    });
 #endif
 
 #if defined(ENABLE_VERSION)
@@ -2044,6 +2152,16 @@ void installWebApi() {
         invoker(200, headerOut, val.toStyledString());
     });
 #endif
+
+#if defined(ENABLE_X264) && defined(ENABLE_FFMPEG)
+    // 播放 app/stream_档位名 时按需启动多码率转码
+    NoticeCenter::Instance().addListener(&web_api_tag, Broadcast::kBroadcastNotFoundStream, [](BroadcastNotFoundStreamArgs) {
+        AbrManager::Instance().onStreamNotFound(args);
+    });
+    NoticeCenter::Instance().addListener(&web_api_tag, Broadcast::kBroadcastMediaChanged, [](BroadcastMediaChangedArgs) {
+        AbrManager::Instance().onMediaChanged(bRegist, sender);
+    });
+#endif
 }
 
 void unInstallWebApi(){
@@ -8,7 +8,10 @@
  * may be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <mutex>
+#include <atomic>
 #include <sstream>
+#include <unordered_map>
 #include "Util/logger.h"
 #include "Util/onceToken.h"
 #include "Util/NoticeCenter.h"
@@ -52,6 +55,9 @@ const string kOnRtpServerTimeout = HOOK_FIELD "on_rtp_server_timeout";
 const string kAliveInterval = HOOK_FIELD "alive_interval";
 const string kRetry = HOOK_FIELD "retry";
 const string kRetryDelay = HOOK_FIELD "retry_delay";
+const string kPoolSize = HOOK_FIELD "pool_size";
+const string kAuthCacheSec = HOOK_FIELD "auth_cache_sec";
+const string kFlowReportBatchMS = HOOK_FIELD "flow_report_batch_ms";
 
 static onceToken token([]() {
     mINI::Instance()[kEnable] = false;
@@ -77,6 +83,9 @@ static onceToken token([]() {
     mINI::Instance()[kAliveInterval] = 30.0;
     mINI::Instance()[kRetry] = 1;
     mINI::Instance()[kRetryDelay] = 3.0;
+    mINI::Instance()[kPoolSize] = 8;
+    mINI::Instance()[kAuthCacheSec] = 0;
+    mINI::Instance()[kFlowReportBatchMS] = 0;
     mINI::Instance()[kStreamChangedSchemas] = "rtsp/rtmp/fmp4/ts/hls/hls.fmp4";
 });
 } // namespace Hook
@@ -166,6 +175,190 @@ string getVhost(const HttpArgs &value) {
     return val != value.end() ? val->second : "";
 }
 
+// hook服务器地址(协议、主机与端口)，用于连接池归类
+static string getHookHost(const string &url) {
+    auto pos = url.find("://");
+    pos = url.find('/', pos == string::npos ? 0 : pos + 3);
+    return pos == string::npos ? url : url.substr(0, pos);
+}
+
+/**
+ * hook http连接池，每个poller线程一个实例，复用到hook服务器的keep-alive连接
+ * 避免每次hook都重新建立tcp(tls)连接
+ */
+class HookRequesterPool {
+public:
+    static HookRequesterPool &Instance() {
+        static auto thread_local instance = new HookRequesterPool;
+        return *instance;
+    }
+
+    HttpRequester::Ptr obtain(const string &host) {
+        auto &idle = _idle[host];
+        while (!idle.empty()) {
+            auto ret = std::move(idle.back());
+            idle.pop_back();
+            if (ret->alive()) {
+                ret->clear();
+                return ret;
+            }
+        }
+        // 新建的连接绑定当前poller线程
+        auto ret = std::make_shared<HttpRequester>();
+        // 空闲连接可能已被对端关闭，此时自动重连并重发请求
+        ret->setAllowResendRequest(true);
+        return ret;
+    }
+
+    void recycle(const string &host, HttpRequester::Ptr requester) {
+        GET_CONFIG(size_t, pool_size, Hook::kPoolSize);
+        auto &idle = _idle[host];
+        if (idle.size() < pool_size && requester->alive()) {
+            idle.emplace_back(std::move(requester));
+        }
+    }
+
+private:
+    HookRequesterPool() = default;
+
+private:
+    unordered_map<string, vector<HttpRequester::Ptr>> _idle;
+};
+
+/**
+ * hook耗时统计，按hook地址统计请求次数、失败次数与耗时分布
+ */
+class HookStatistic {
+public:
+    static HookStatistic &Instance() {
+        static HookStatistic s_instance;
+        return s_instance;
+    }
+
+    void onResult(const string &url, uint64_t ms, bool failed) {
+        lock_guard<mutex> lck(_mtx);
+        auto &item = _items[url];
+        ++item.count;
+        item.failed += failed;
+        item.total_ms += ms;
+        item.max_ms = MAX(item.max_ms, ms);
+        size_t i = 0;
+        while (i < kBucketCount - 1 && ms > kBucketMS[i]) {
+            ++i;
+        }
+        ++item.buckets[i];
+    }
+
+    void onCacheHit(const string &url) {
+        lock_guard<mutex> lck(_mtx);
+        ++_items[url].cache_hit;
+    }
+
+    Value dump() {
+        Value ret(arrayValue);
+        lock_guard<mutex> lck(_mtx);
+        for (auto &pr : _items) {
+            auto &item = pr.second;
+            Value obj;
+            obj["url"] = pr.first;
+            obj["count"] = (Json::UInt64)item.count;
+            obj["failed"] = (Json::UInt64)item.failed;
+            obj["cache_hit"] = (Json::UInt64)item.cache_hit;
+            obj["avg_ms"] = (Json::UInt64)(item.count ? item.total_ms / item.count : 0);
+            obj["max_ms"] = (Json::UInt64)item.max_ms;
+            for (size_t i = 0; i < kBucketCount; ++i) {
+                Value bucket;
+                // 最后一个区间没有上限，置为-1
+                bucket["le_ms"] = i < kBucketCount - 1 ? (Json::Int64)kBucketMS[i] : -1;
+                bucket["count"] = (Json::UInt64)item.buckets[i];
+                obj["histogram"].append(bucket);
+            }
+            ret.append(obj);
+        }
+        return ret;
+    }
+
+private:
+    HookStatistic() = default;
+
+private:
+    enum { kBucketCount = 8 };
+    static constexpr uint64_t kBucketMS[kBucketCount - 1] = { 10, 50, 100, 200, 500, 1000, 3000 };
+
+    struct Item {
+        uint64_t count = 0;
+        uint64_t failed = 0;
+        uint64_t cache_hit = 0;
+        uint64_t total_ms = 0;
+        uint64_t max_ms = 0;
+        uint64_t buckets[kBucketCount] = { 0 };
+    };
+
+    mutex _mtx;
+    unordered_map<string, Item> _items;
+};
+
+constexpr uint64_t HookStatistic::kBucketMS[];
+
+/**
+ * on_play/on_rtsp_auth鉴权成功结果缓存，减少断线重连风暴时的hook请求
+ * 鉴权失败与网络错误不缓存
+ */
+class HookResultCache {
+public:
+    static HookResultCache &Instance() {
+        static HookResultCache s_instance;
+        return s_instance;
+    }
+
+    bool get(const string &key, Value &obj) {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _cache.find(key);
+        if (it == _cache.end()) {
+            return false;
+        }
+        if (it->second.first < getCurrentMillisecond()) {
+            // 已经过期
+            _cache.erase(it);
+            return false;
+        }
+        obj = it->second.second;
+        return true;
+    }
+
+    void set(const string &key, const Value &obj) {
+        GET_CONFIG(float, auth_cache_sec, Hook::kAuthCacheSec);
+        auto now = getCurrentMillisecond();
+        lock_guard<mutex> lck(_mtx);
+        if (_cache.size() >= kMaxSize) {
+            // 清理过期缓存，仍然过多时全部清空
+            for (auto it = _cache.begin(); it != _cache.end();) {
+                it = it->second.first < now ? _cache.erase(it) : std::next(it);
+            }
+            if (_cache.size() >= kMaxSize) {
+                _cache.clear();
+            }
+        }
+        _cache[key] = std::make_pair(now + (uint64_t)(auth_cache_sec * 1000), obj);
+    }
+
+private:
+    HookResultCache() = default;
+
+private:
+    static constexpr size_t kMaxSize = 100 * 1000;
+    mutex _mtx;
+    unordered_map<string, pair<uint64_t /*expire ms*/, Value>> _cache;
+};
+
+static string makeAuthCacheKey(const char *hook, const MediaInfo &args, const string &ip) {
+    return StrPrinter << hook << '|' << args.schema << '|' << args.vhost << '|' << args.app << '|' << args.stream << '|' << args.params << '|' << ip;
+}
+
+Value getHookStatistic() {
+    return HookStatistic::Instance().dump();
+}
+
 static atomic<uint64_t> s_hook_index { 0 };
 
 void do_http_hook(const string &url, const ArgsType &body, const function<void(const Value &, const string &)> &func, uint32_t retry) {
@@ -176,42 +369,51 @@ void do_http_hook(const string &url, const ArgsType &body, const function<void(c
     const_cast<ArgsType &>(body)["mediaServerId"] = mediaServerId;
     const_cast<ArgsType &>(body)["hook_index"] = (Json::UInt64)(s_hook_index++);
 
-    auto requester = std::make_shared<HttpRequester>();
-    requester->setMethod("POST");
     auto bodyStr = to_string(body);
-    requester->setBody(bodyStr);
-    requester->addHeader("Content-Type", getContentType(body));
-    auto vhost = getVhost(body);
-    if (!vhost.empty()) {
-        requester->addHeader("X-VHOST", vhost);
-    }
-    Ticker ticker;
-    requester->startRequester(url, [url, func, bodyStr, body, requester, ticker, retry](const SockException &ex, const Parser &res) mutable {
-        onceToken token(nullptr, [&]() mutable { requester.reset(); });
-        parse_http_response(ex, res, [&](const Value &obj, const string &err, bool should_retry) {
-            if (!err.empty()) {
-                // hook失败
-                WarnL << "hook " << url << " " << ticker.elapsedTime() << "ms,failed" << err << ":" << bodyStr;
-
-                if (retry-- > 0 && should_retry) {
-                    requester->getPoller()->doDelayTask(MAX(retry_delay, 0.0) * 1000, [url, body, func, retry] {
-                        do_http_hook(url, body, func, retry);
-                        return 0;
-                    });
-                    // 重试不需要触发回调
-                    return;
+    // 切换到poller线程发起请求，以便复用该线程连接池中的keep-alive连接
+    EventPollerPool::Instance().getPoller()->async([url, body, func, retry, bodyStr]() {
+        auto host = getHookHost(url);
+        auto requester = HookRequesterPool::Instance().obtain(host);
+        requester->setMethod("POST");
+        requester->setBody(bodyStr);
+        requester->addHeader("Content-Type", getContentType(body));
+        auto vhost = getVhost(body);
+        if (!vhost.empty()) {
+            requester->addHeader("X-VHOST", vhost);
+        }
+        Ticker ticker;
+        requester->startRequester(url, [url, host, func, bodyStr, body, requester, ticker, retry](const SockException &ex, const Parser &res) mutable {
+            onceToken token(nullptr, [&]() mutable {
+                // 延后归还连接池，防止在本回调中被复用
+                requester->getPoller()->async([host, requester]() { HookRequesterPool::Instance().recycle(host, requester); }, false);
+                requester.reset();
+            });
+            parse_http_response(ex, res, [&](const Value &obj, const string &err, bool should_retry) {
+                HookStatistic::Instance().onResult(url, ticker.elapsedTime(), !err.empty());
+                if (!err.empty()) {
+                    // hook失败
+                    WarnL << "hook " << url << " " << ticker.elapsedTime() << "ms,failed" << err << ":" << bodyStr;
+
+                    if (retry-- > 0 && should_retry) {
+                        requester->getPoller()->doDelayTask(MAX(retry_delay, 0.0) * 1000, [url, body, func, retry] {
+                            do_http_hook(url, body, func, retry);
+                            return 0;
+                        });
+                        // 重试不需要触发回调
+                        return;
+                    }
+
+                } else if (ticker.elapsedTime() > 500) {
+                    // hook成功，但是hook响应超过500ms，打印警告日志
+                    DebugL << "hook " << url << " " << ticker.elapsedTime() << "ms,success:" << bodyStr;
                 }
 
-            } else if (ticker.elapsedTime() > 500) {
-                // hook成功，但是hook响应超过500ms，打印警告日志
-                DebugL << "hook " << url << " " << ticker.elapsedTime() << "ms,success:" << bodyStr;
-            }
-
-            if (func) {
-                func(obj, err);
-            }
-        });
-    }, hook_timeoutSec);
+                if (func) {
+                    func(obj, err);
+                }
+            });
+        }, hook_timeoutSec);
+    });
 }
 
 void do_http_hook(const string &url, const ArgsType &body, const function<void(const Value &, const string &)> &func) {
@@ -277,6 +479,63 @@ static void reportServerKeepalive() {
     }, nullptr);
 }
 
+// on_flow_report批量上报
+static mutex s_flow_report_mtx;
+static ArgsType s_flow_report_batch(arrayValue);
+static Timer::Ptr g_flow_report_timer;
+// 当前生效的批量上报间隔，监听器与定时器以此为准，保证二者一致
+static std::atomic<uint32_t> s_flow_report_batch_ms { 0 };
+
+static void flushFlowReport() {
+    GET_CONFIG(string, hook_flowreport, Hook::kOnFlowReport);
+    ArgsType batch(arrayValue);
+    {
+        lock_guard<mutex> lck(s_flow_report_mtx);
+        batch.swap(s_flow_report_batch);
+    }
+    if (batch.empty() || hook_flowreport.empty()) {
+        return;
+    }
+    ArgsType body;
+    body["batch"] = std::move(batch);
+    // 执行hook
+    do_http_hook(hook_flowreport, body, nullptr);
+}
+
+static void inputFlowReport(ArgsType body) {
+    // 单次批量上报的最大条数
+    static constexpr size_t kMaxFlowReportBatch = 1000;
+    bool flush;
+    {
+        lock_guard<mutex> lck(s_flow_report_mtx);
+        s_flow_report_batch.append(std::move(body));
+        flush = s_flow_report_batch.size() >= kMaxFlowReportBatch;
+    }
+    if (flush) {
+        flushFlowReport();
+    }
+}
+
+static void startFlowReportTimer() {
+    // 直接读取配置，不依赖GET_CONFIG热更新监听器的触发顺序
+    auto flow_report_batch_ms = mINI::Instance()[Hook::kFlowReportBatchMS].as<uint32_t>();
+    if (g_flow_report_timer && flow_report_batch_ms == s_flow_report_batch_ms) {
+        // 间隔未变，无需重启定时器
+        return;
+    }
+    s_flow_report_batch_ms = flow_report_batch_ms;
+    g_flow_report_timer.reset();
+    if (!flow_report_batch_ms) {
+        // 关闭批量上报，立即上报残留的数据
+        flushFlowReport();
+        return;
+    }
+    g_flow_report_timer = std::make_shared<Timer>(flow_report_batch_ms / 1000.0f, []() {
+        flushFlowReport();
+        return true;
+    }, nullptr);
+}
+
 static const string kEdgeServerParam = "edge=1";
 
 static string getPullUrl(const string &origin_fmt, const MediaInfo &info) {
@@ -367,12 +626,29 @@ void installWebHook() {
             invoker("");
             return;
         }
+        GET_CONFIG(float, auth_cache_sec, Hook::kAuthCacheSec);
+        string cache_key;
+        if (auth_cache_sec > 0) {
+            Value obj;
+            cache_key = makeAuthCacheKey("on_play", args, sender.get_peer_ip());
+            if (HookResultCache::Instance().get(cache_key, obj)) {
+                // 命中鉴权缓存
+                HookStatistic::Instance().onCacheHit(hook_play);
+                invoker("");
+                return;
+            }
+        }
         auto body = make_json(args);
         body["ip"] = sender.get_peer_ip();
         body["port"] = sender.get_peer_port();
         body["id"] = sender.getIdentifier();
         // 执行hook
-        do_http_hook(hook_play, body, [invoker](const Value &obj, const string &err) { invoker(err); });
+        do_http_hook(hook_play, body, [invoker, cache_key](const Value &obj, const string &err) {
+            if (err.empty() && !cache_key.empty()) {
+                HookResultCache::Instance().set(cache_key, obj);
+            }
+            invoker(err);
+        });
     });
 
     NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastFlowReport, [](BroadcastFlowReportArgs) {
@@ -387,6 +663,11 @@ void installWebHook() {
         body["ip"] = sender.get_peer_ip();
         body["port"] = sender.get_peer_port();
         body["id"] = sender.getIdentifier();
+        if (s_flow_report_batch_ms) {
+            // 批量上报
+            inputFlowReport(std::move(body));
+            return;
+        }
         // 执行hook
         do_http_hook(hook_flowreport, body, nullptr);
     });
@@ -424,6 +705,18 @@ void installWebHook() {
             invoker(false, makeRandStr(12));
             return;
         }
+        GET_CONFIG(float, auth_cache_sec, Hook::kAuthCacheSec);
+        string cache_key;
+        if (auth_cache_sec > 0) {
+            Value obj;
+            cache_key = makeAuthCacheKey("on_rtsp_auth", args, sender.get_peer_ip()) + '|' + user_name + '|' + realm + '|' + (must_no_encrypt ? "1" : "0");
+            if (HookResultCache::Instance().get(cache_key, obj)) {
+                // 命中鉴权缓存
+                HookStatistic::Instance().onCacheHit(hook_rtsp_auth);
+                invoker(obj["encrypted"].asBool(), obj["passwd"].asString());
+                return;
+            }
+        }
         auto body = make_json(args);
         body["ip"] = sender.get_peer_ip();
         body["port"] = sender.get_peer_port();
@@ -432,12 +725,15 @@ void installWebHook() {
         body["must_no_encrypt"] = must_no_encrypt;
         body["realm"] = realm;
         // 执行hook
-        do_http_hook(hook_rtsp_auth, body, [invoker](const Value &obj, const string &err) {
+        do_http_hook(hook_rtsp_auth, body, [invoker, cache_key](const Value &obj, const string &err) {
             if (!err.empty()) {
                 // 认证失败
                 invoker(false, makeRandStr(12));
                 return;
             }
+            if (!cache_key.empty()) {
+                HookResultCache::Instance().set(cache_key, obj);
+            }
             invoker(obj["encrypted"].asBool(), obj["passwd"].asString());
         });
     });
@@ -696,11 +992,22 @@ void installWebHook() {
 
     // 定时上报保活
     reportServerKeepalive();
+
+    // 定时批量上报流量
+    startFlowReportTimer();
+
+    // 配置热更新后按新的间隔启停批量上报定时器
+    NoticeCenter::Instance().addListener(&web_hook_tag, Broadcast::kBroadcastReloadConfig, [](BroadcastReloadConfigArgs) {
+        startFlowReportTimer();
+    });
 }
 
 void unInstallWebHook() {
     g_keepalive_timer.reset();
+    g_flow_report_timer.reset();
+    s_flow_report_batch_ms = 0;
     NoticeCenter::Instance().delListener(&web_hook_tag);
+    flushFlowReport();
 }
 
 void onProcessExited() {
@@ -39,4 +39,9 @@ void onProcessExited();
  * @param func 回调
  */
 void do_http_hook(const std::string &url, const ArgsType &body, const std::function<void(const Json::Value &, const std::string &)> &func = nullptr);
+
+/**
+ * 获取hook请求统计，包括各hook地址的请求次数、失败次数、缓存命中次数与耗时分布
+ */
+Json::Value getHookStatistic();
 #endif //ZLMEDIAKIT_WEBHOOK_H
@@ -35,8 +35,19 @@ public:
     H264Encoder();
     ~H264Encoder();
 
-    bool init(int iWidth, int iHeight, int iFps, int iBitRate);
-    int inputData(char *yuv[3], int linesize[3], int64_t cts, H264Frame **out_frame);
+    /**
+     * 初始化编码器
+     * @param manual_idr 为true时关闭自动关键帧与场景切换检测，关键帧完全由inputData的force_idr参数决定，
+     *                   用于多路编码输出的关键帧对齐
+     */
+    bool init(int iWidth, int iHeight, int iFps, int iBitRate, bool manual_idr = false);
+
+    /**
+     * 编码yuv420p帧
+     * @param force_idr 是否强制编码为idr帧
+     * @return 输出的nal个数
+     */
+    int inputData(char *yuv[3], int linesize[3], int64_t cts, H264Frame **out_frame, bool force_idr = false);
 
 private:
     x264_t *_pX264Handle = nullptr;
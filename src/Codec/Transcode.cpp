@@ -465,13 +465,14 @@ FFmpegDecoder::FFmpegDecoder(const Track::Ptr &track, int thread_num, const std:
 
 FFmpegDecoder::~FFmpegDecoder() {
     stopThread(true);
-    if (_do_merger) {
-        _merger.flush();
-    }
     flush();
 }
 
 void FFmpegDecoder::flush() {
+    if (_do_merger) {
+        // 合帧器中可能还缓存着最后一帧
+        _merger.flush();
+    }
     while (true) {
         auto out_frame = std::make_shared<FFmpegFrame>();
         auto ret = avcodec_receive_frame(_context.get(), out_frame->get());
@@ -648,15 +649,7 @@ FFmpegFrame::Ptr FFmpegSws::inputFrame(const FFmpegFrame::Ptr &frame) {
     return inputFrame(frame, ret, nullptr);
 }
 
-FFmpegFrame::Ptr FFmpegSws::inputFrame(const FFmpegFrame::Ptr &frame, int &ret, uint8_t *data) {
-    ret = -1;
-    TimeTicker2(30, TraceL);
-    auto target_width = _target_width ? _target_width : frame->get()->width;
-    auto target_height = _target_height ? _target_height : frame->get()->height;
-    if (frame->get()->format == _target_format && frame->get()->width == target_width && frame->get()->height == target_height) {
-        //不转格式
-        return frame;
-    }
+SwsContext *FFmpegSws::getContext(const FFmpegFrame::Ptr &frame, int target_width, int target_height) {
     if (_ctx && (_src_width != frame->get()->width || _src_height != frame->get()->height || _src_format != (enum AVPixelFormat) frame->get()->format)) {
         //输入分辨率发生变化了
         sws_freeContext(_ctx);
@@ -669,7 +662,64 @@ FFmpegFrame::Ptr FFmpegSws::inputFrame(const FFmpegFrame::Ptr &frame, int &ret,
         _ctx = sws_getContext(frame->get()->width, frame->get()->height, (enum AVPixelFormat) frame->get()->format, target_width, target_height, _target_format, SWS_FAST_BILINEAR, NULL, NULL, NULL);
         InfoL << "sws_getContext:" << av_get_pix_fmt_name((enum AVPixelFormat) frame->get()->format) << " -> " << av_get_pix_fmt_name(_target_format);
     }
-    if (_ctx) {
+    return _ctx;
+}
+
+int FFmpegSws::inputFrame(const FFmpegFrame::Ptr &frame, const FFmpegFrame::Ptr &canvas, int x, int y) {
+    TimeTicker2(30, TraceL);
+    auto target_width = _target_width ? _target_width : frame->get()->width;
+    auto target_height = _target_height ? _target_height : frame->get()->height;
+    auto dst_frame = canvas->get();
+    auto desc = av_pix_fmt_desc_get(_target_format);
+    if (!desc || dst_frame->format != _target_format || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+        WarnL << "Unsupported canvas pixel format: " << av_get_pix_fmt_name((enum AVPixelFormat) dst_frame->format);
+        return -1;
+    }
+    if (x < 0 || y < 0 || x + target_width > dst_frame->width || y + target_height > dst_frame->height) {
+        WarnL << "Region out of canvas: " << x << "," << y << " " << target_width << "x" << target_height;
+        return -1;
+    }
+
+    // 计算区域在画布各平面中的起始地址，色度平面按采样比例偏移
+    uint8_t *dst[4] = { nullptr };
+    int dst_linesize[4] = { 0 };
+    for (int i = 0; i < desc->nb_components; ++i) {
+        auto &comp = desc->comp[i];
+        if (dst[comp.plane]) {
+            continue;
+        }
+        bool chroma = i == 1 || i == 2;
+        auto plane_x = chroma ? (x >> desc->log2_chroma_w) : x;
+        auto plane_y = chroma ? (y >> desc->log2_chroma_h) : y;
+        dst[comp.plane] = dst_frame->data[comp.plane] + plane_y * dst_frame->linesize[comp.plane] + plane_x * comp.step;
+        dst_linesize[comp.plane] = dst_frame->linesize[comp.plane];
+    }
+
+    if (frame->get()->format == _target_format && frame->get()->width == target_width && frame->get()->height == target_height) {
+        //不转格式，直接拷贝
+        av_image_copy(dst, dst_linesize, (const uint8_t **)frame->get()->data, frame->get()->linesize, _target_format, target_width, target_height);
+        return target_height;
+    }
+    if (!getContext(frame, target_width, target_height)) {
+        return -1;
+    }
+    auto ret = sws_scale(_ctx, frame->get()->data, frame->get()->linesize, 0, frame->get()->height, dst, dst_linesize);
+    if (ret <= 0) {
+        WarnL << "sws_scale failed:" << ffmpeg_err(ret);
+    }
+    return ret;
+}
+
+FFmpegFrame::Ptr FFmpegSws::inputFrame(const FFmpegFrame::Ptr &frame, int &ret, uint8_t *data) {
+    ret = -1;
+    TimeTicker2(30, TraceL);
+    auto target_width = _target_width ? _target_width : frame->get()->width;
+    auto target_height = _target_height ? _target_height : frame->get()->height;
+    if (frame->get()->format == _target_format && frame->get()->width == target_width && frame->get()->height == target_height) {
+        //不转格式
+        return frame;
+    }
+    if (getContext(frame, target_width, target_height)) {
         auto out = std::make_shared<FFmpegFrame>();
         if (!out->get()->data[0]) {
             if (data) {
@@ -105,6 +105,9 @@ public:
 
     bool inputFrame(const Frame::Ptr &frame, bool live, bool async, bool enable_merge = true);
     void setOnDecode(onDec cb);
+    /**
+     * 输出合帧器与解码器中缓存的帧，同步解码时调用
+     */
     void flush();
     const AVCodecContext *getContext() const;
 
@@ -130,8 +133,18 @@ public:
     FFmpegFrame::Ptr inputFrame(const FFmpegFrame::Ptr &frame);
     int inputFrame(const FFmpegFrame::Ptr &frame, uint8_t *data);
 
+    /**
+     * 缩放后直接写入画布的指定区域，不产生中间帧
+     * @param canvas 目标画布，像素格式必须与输出格式一致
+     * @param x 区域左上角在画布中的横坐标
+     * @param y 区域左上角在画布中的纵坐标
+     * @return 输出的行数，失败时小于等于0
+     */
+    int inputFrame(const FFmpegFrame::Ptr &frame, const FFmpegFrame::Ptr &canvas, int x, int y);
+
 private:
     FFmpegFrame::Ptr inputFrame(const FFmpegFrame::Ptr &frame, int &ret, uint8_t *data);
+    SwsContext *getContext(const FFmpegFrame::Ptr &frame, int target_width, int target_height);
 
 private:
     int _target_width = 0;
@@ -28,12 +28,57 @@ namespace toolkit {
 
 namespace mediakit {
 
-static recursive_mutex s_media_source_mtx;
-using StreamMap = unordered_map<string/*strema_id*/, weak_ptr<MediaSource> >;
-using AppStreamMap = unordered_map<string/*app*/, StreamMap>;
-using VhostAppStreamMap = unordered_map<string/*vhost*/, AppStreamMap>;
-using SchemaVhostAppStreamMap = unordered_map<string/*schema*/, VhostAppStreamMap>;
-static SchemaVhostAppStreamMap s_media_source_map;
+/**
+ * 媒体源注册表
+ * 按(vhost, app, stream)的哈希值分片，每个分片独立加锁，避免所有流的查找与注册竞争同一把全局锁
+ * 同一个流的不同协议位于同一个分片，这样按协议优先级查找时只需加锁一次
+ */
+class MediaSourceKey {
+public:
+    MediaSourceKey(const string &schema, const string &vhost, const string &app, const string &stream)
+        : schema(schema), vhost(vhost), app(app), stream(stream) {
+        std::hash<string> hasher;
+        tuple_hash = hashCombine(hashCombine(hasher(vhost), hasher(app)), hasher(stream));
+        hash = hashCombine(tuple_hash, hasher(schema));
+    }
+
+    bool operator==(const MediaSourceKey &that) const {
+        return hash == that.hash && stream == that.stream && app == that.app && vhost == that.vhost && schema == that.schema;
+    }
+
+    static size_t hashCombine(size_t seed, size_t value) { return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2)); }
+
+public:
+    string schema;
+    string vhost;
+    string app;
+    string stream;
+    // 不含schema的哈希值，用于选择分片
+    size_t tuple_hash;
+    // 完整哈希值
+    size_t hash;
+};
+
+struct MediaSourceKeyHash {
+    size_t operator()(const MediaSourceKey &key) const { return key.hash; }
+};
+
+struct MediaSourceShard {
+    // 媒体源析构时会反注册，可能在持有锁时触发，所以采用递归锁
+    recursive_mutex mtx;
+    unordered_map<MediaSourceKey, weak_ptr<MediaSource>, MediaSourceKeyHash> map;
+};
+
+static constexpr size_t kMediaSourceShardCount = 64;
+
+static MediaSourceShard *getMediaSourceShards() {
+    static MediaSourceShard s_shards[kMediaSourceShardCount];
+    return s_shards;
+}
+
+static MediaSourceShard &getMediaSourceShard(size_t tuple_hash) {
+    return getMediaSourceShards()[tuple_hash % kMediaSourceShardCount];
+}
 
 string getOriginTypeString(MediaOriginType type){
 #define SWITCH_CASE(type) case MediaOriginType::type : return #type
@@ -291,39 +336,31 @@ bool MediaSource::stopSendRtp(const string &ssrc) {
     return listener->stopSendRtp(*this, ssrc);
 }
 
-template<typename MAP, typename LIST, typename First, typename ...KeyTypes>
-static void for_each_media_l(const MAP &map, LIST &list, const First &first, const KeyTypes &...keys) {
-    if (first.empty()) {
-        for (auto &pr : map) {
-            for_each_media_l(pr.second, list, keys...);
-        }
-        return;
-    }
-    auto it = map.find(first);
-    if (it != map.end()) {
-        for_each_media_l(it->second, list, keys...);
-    }
-}
-
-template<typename LIST, typename Ptr>
-static void emplace_back(LIST &list, const Ptr &ptr) {
-    auto src = ptr.lock();
-    if (src) {
-        list.emplace_back(std::move(src));
-    }
+static bool matchMediaSource(const MediaSourceKey &key, const string &schema, const string &vhost, const string &app, const string &stream) {
+    return (schema.empty() || key.schema == schema) && (vhost.empty() || key.vhost == vhost) && (app.empty() || key.app == app)
+        && (stream.empty() || key.stream == stream);
 }
 
-template<typename MAP, typename LIST, typename First>
-static void for_each_media_l(const MAP &map, LIST &list, const First &first) {
-    if (first.empty()) {
-        for (auto &pr : map) {
-            emplace_back(list, pr.second);
+template<typename LIST>
+static void for_each_media_l(MediaSourceShard &shard, LIST &list, const string &schema, const string &vhost, const string &app, const string &stream) {
+    lock_guard<recursive_mutex> lock(shard.mtx);
+    if (!schema.empty() && !vhost.empty() && !app.empty() && !stream.empty()) {
+        // 精确查找
+        auto it = shard.map.find(MediaSourceKey(schema, vhost, app, stream));
+        if (it != shard.map.end()) {
+            if (auto src = it->second.lock()) {
+                list.emplace_back(std::move(src));
+            }
         }
         return;
     }
-    auto it = map.find(first);
-    if (it != map.end()) {
-        emplace_back(list, it->second);
+    for (auto &pr : shard.map) {
+        if (!matchMediaSource(pr.first, schema, vhost, app, stream)) {
+            continue;
+        }
+        if (auto src = pr.second.lock()) {
+            list.emplace_back(std::move(src));
+        }
     }
 }
 
@@ -333,21 +370,31 @@ void MediaSource::for_each_media(const function<void(const Ptr &src)> &cb,
                                  const string &app,
                                  const string &stream) {
     deque<Ptr> src_list;
-    {
-        lock_guard<recursive_mutex> lock(s_media_source_mtx);
-        for_each_media_l(s_media_source_map, src_list, schema, vhost, app, stream);
+    if (!vhost.empty() && !app.empty() && !stream.empty()) {
+        // 指定了流，只需查找其所在分片
+        MediaSourceKey key(schema, vhost, app, stream);
+        for_each_media_l(getMediaSourceShard(key.tuple_hash), src_list, schema, vhost, app, stream);
+    } else {
+        auto shards = getMediaSourceShards();
+        for (size_t i = 0; i < kMediaSourceShardCount; ++i) {
+            for_each_media_l(shards[i], src_list, schema, vhost, app, stream);
+        }
     }
     for (auto &src : src_list) {
         cb(src);
     }
 }
 
-static MediaSource::Ptr find_l(const string &schema, const string &vhost_in, const string &app, const string &id, bool from_mp4) {
-    string vhost = vhost_in;
+static string getVhost(const string &vhost) {
     GET_CONFIG(bool, enableVhost, General::kEnableVhost);
-    if(vhost.empty() || !enableVhost){
-        vhost = DEFAULT_VHOST;
+    if (vhost.empty() || !enableVhost) {
+        return DEFAULT_VHOST;
     }
+    return vhost;
+}
+
+static MediaSource::Ptr find_l(const string &schema, const string &vhost_in, const string &app, const string &id, bool from_mp4) {
+    string vhost = getVhost(vhost_in);
 
     if (app.empty() || id.empty()) {
         //如果未指定app与stream id，那么就是遍历而非查找，所以应该返回查找失败
@@ -441,28 +488,52 @@ MediaSource::Ptr MediaSource::find(const string &schema, const string &vhost, co
     return find_l(schema, vhost, app, id, from_mp4);
 }
 
-MediaSource::Ptr MediaSource::find(const string &vhost, const string &app, const string &stream_id, bool from_mp4) {
-    auto src = MediaSource::find(RTMP_SCHEMA, vhost, app, stream_id, from_mp4);
+MediaSource::Ptr MediaSource::find(const string &vhost_in, const string &app, const string &stream_id, bool from_mp4) {
+    static const string s_schemas[] = { RTMP_SCHEMA, RTSP_SCHEMA, TS_SCHEMA, FMP4_SCHEMA, HLS_SCHEMA, HLS_FMP4_SCHEMA };
+    if (app.empty() || stream_id.empty()) {
+        return nullptr;
+    }
+    {
+        // 所有协议位于同一分片，加锁一次按优先级查找
+        auto vhost = getVhost(vhost_in);
+        auto &shard = getMediaSourceShard(MediaSourceKey("", vhost, app, stream_id).tuple_hash);
+        MediaSource::Ptr ret;
+        {
+            lock_guard<recursive_mutex> lock(shard.mtx);
+            for (auto &schema : s_schemas) {
+                auto it = shard.map.find(MediaSourceKey(schema, vhost, app, stream_id));
+                if (it != shard.map.end() && (ret = it->second.lock())) {
+                    break;
+                }
+            }
+        }
+        if (ret || !from_mp4) {
+            return ret;
+        }
+    }
+
+    // 未找到，按原有顺序尝试从mp4文件创建
+    auto src = MediaSource::find(RTMP_SCHEMA, vhost_in, app, stream_id, from_mp4);
     if (src) {
         return src;
     }
-    src = MediaSource::find(RTSP_SCHEMA, vhost, app, stream_id, from_mp4);
+    src = MediaSource::find(RTSP_SCHEMA, vhost_in, app, stream_id, from_mp4);
     if (src) {
         return src;
     }
-    src = MediaSource::find(TS_SCHEMA, vhost, app, stream_id, from_mp4);
+    src = MediaSource::find(TS_SCHEMA, vhost_in, app, stream_id, from_mp4);
     if (src) {
         return src;
     }
-    src = MediaSource::find(FMP4_SCHEMA, vhost, app, stream_id, from_mp4);
+    src = MediaSource::find(FMP4_SCHEMA, vhost_in, app, stream_id, from_mp4);
     if (src) {
         return src;
     }
-    src = MediaSource::find(HLS_SCHEMA, vhost, app, stream_id, from_mp4);
+    src = MediaSource::find(HLS_SCHEMA, vhost_in, app, stream_id, from_mp4);
     if (src) {
         return src;
     }
-    return MediaSource::find(HLS_FMP4_SCHEMA, vhost, app, stream_id, from_mp4);
+    return MediaSource::find(HLS_FMP4_SCHEMA, vhost_in, app, stream_id, from_mp4);
 }
 
 void MediaSource::emitEvent(bool regist){
@@ -479,8 +550,10 @@ void MediaSource::emitEvent(bool regist){
 void MediaSource::regist() {
     {
         //减小互斥锁临界区
-        lock_guard<recursive_mutex> lock(s_media_source_mtx);
-        auto &ref = s_media_source_map[_schema][_tuple.vhost][_tuple.app][_tuple.stream];
+        MediaSourceKey key(_schema, _tuple.vhost, _tuple.app, _tuple.stream);
+        auto &shard = getMediaSourceShard(key.tuple_hash);
+        lock_guard<recursive_mutex> lock(shard.mtx);
+        auto &ref = shard.map[std::move(key)];
         auto src = ref.lock();
         if (src) {
             if (src.get() == this) {
@@ -494,36 +567,23 @@ void MediaSource::regist() {
     emitEvent(true);
 }
 
-template<typename MAP, typename First, typename ...KeyTypes>
-static bool erase_media_source(bool &hit, const MediaSource *thiz, MAP &map, const First &first, const KeyTypes &...keys) {
-    auto it = map.find(first);
-    if (it != map.end() && erase_media_source(hit, thiz, it->second, keys...)) {
-        map.erase(it);
-    }
-    return map.empty();
-}
-
-template<typename MAP, typename First>
-static bool erase_media_source(bool &hit, const MediaSource *thiz, MAP &map, const First &first) {
-    auto it = map.find(first);
-    if (it != map.end()) {
-        auto src = it->second.lock();
-        if (!src || src.get() == thiz) {
-            //对象已经销毁或者对象就是自己，那么移除之
-            map.erase(it);
-            hit = true;
-        }
-    }
-    return map.empty();
-}
-
 //反注册该源
 bool MediaSource::unregist() {
     bool ret = false;
     {
         //减小互斥锁临界区
-        lock_guard<recursive_mutex> lock(s_media_source_mtx);
-        erase_media_source(ret, this, s_media_source_map, _schema, _tuple.vhost, _tuple.app, _tuple.stream);
+        MediaSourceKey key(_schema, _tuple.vhost, _tuple.app, _tuple.stream);
+        auto &shard = getMediaSourceShard(key.tuple_hash);
+        lock_guard<recursive_mutex> lock(shard.mtx);
+        auto it = shard.map.find(key);
+        if (it != shard.map.end()) {
+            auto src = it->second.lock();
+            if (!src || src.get() == this) {
+                //对象已经销毁或者对象就是自己，那么移除之
+                shard.map.erase(it);
+                ret = true;
+            }
+        }
     }
 
     if (ret) {
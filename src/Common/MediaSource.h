@@ -196,6 +196,10 @@ public:
     // 该配置开启后可以解决一些流发送不平滑导致zlmediakit转发也不平滑的问题
     uint32_t paced_sender_ms;
 
+    // 多协议并行复用的最大积压时长，单位毫秒，置0则关闭(所有协议在流的归属线程中串行复用)
+    // 开启后各协议的复用在各自的线程中执行，积压超过该时长时丢帧直到下一个关键帧
+    uint32_t parallel_mux_ms;
+
     //是否开启转换为hls(mpegts)
     bool enable_hls;
     //是否开启转换为hls(fmp4)
@@ -252,6 +256,7 @@ public:
         GET_OPT_VALUE(auto_close);
         GET_OPT_VALUE(continue_push_ms);
         GET_OPT_VALUE(paced_sender_ms);
+        GET_OPT_VALUE(parallel_mux_ms);
 
         GET_OPT_VALUE(enable_hls);
         GET_OPT_VALUE(enable_hls_fmp4);
@@ -9,7 +9,12 @@
 */
 
 #include <math.h>
+#include <atomic>
+#include <thread>
 #include "Common/config.h"
+#include "Thread/semaphore.h"
+#include "Thread/ThreadPool.h"
+#include "Rtp/RtpCache.h"
 #include "MultiMediaSourceMuxer.h"
 
 using namespace std;
@@ -117,6 +122,218 @@ private:
     std::list<std::pair<uint64_t, Frame::Ptr>> _cache;
 };
 
+/**
+ * 并行复用专用线程池
+ * 这些线程不会成为任何流的归属线程，且阶段任务中从不阻塞等待其他线程，
+ * 所以归属线程在sync中等待阶段线程不会形成交叉死锁
+ */
+class MuxerStagePool : public TaskExecutorGetterImp {
+public:
+    using Ptr = std::shared_ptr<MuxerStagePool>;
+
+    static MuxerStagePool &Instance();
+
+    EventPoller::Ptr getPoller() { return static_pointer_cast<EventPoller>(getExecutor()); }
+
+private:
+    MuxerStagePool() {
+        auto size = addPoller("mux stage", thread::hardware_concurrency(), ThreadPool::PRIORITY_HIGHEST, false, false);
+        InfoL << "Mux stage thread size: " << size;
+    }
+};
+
+INSTANCE_IMP(MuxerStagePool)
+
+/**
+ * 并行复用的单个协议阶段
+ * 归属线程通过单生产者单消费者无锁队列按顺序把帧交给该阶段的线程复用，
+ * 积压超过上限时丢帧直到下一个视频关键帧(纯音频时直到积压恢复)；
+ * 协议对应的媒体源注册前在归属线程中直接复用，保证注册事件仍在归属线程触发
+ */
+class MuxerStage : public std::enable_shared_from_this<MuxerStage> {
+public:
+    using Ptr = std::shared_ptr<MuxerStage>;
+    using OnFrame = std::function<bool(const Frame::Ptr &frame)>;
+    using IsActive = std::function<bool()>;
+    using IsRegisted = std::function<bool()>;
+    // 队列长度，必须为2的幂
+    static constexpr size_t kQueueSize = 256;
+
+    MuxerStage(std::string name, uint32_t max_lag_ms, IsActive is_active, IsRegisted is_registed, OnFrame on_frame) : _slots(kQueueSize), _stamps(kQueueSize) {
+        _name = std::move(name);
+        _max_lag_us = max_lag_ms * 1000ULL;
+        _is_active = std::move(is_active);
+        _is_registed = std::move(is_registed);
+        _on_frame = std::move(on_frame);
+        _poller = MuxerStagePool::Instance().getPoller();
+    }
+
+    const std::string &getName() const { return _name; }
+
+    const EventPoller::Ptr &getPoller() const { return _poller; }
+
+    /**
+     * 输入帧，在归属线程调用，帧必须是可缓存的
+     */
+    bool inputFrame(const Frame::Ptr &frame) {
+        if (!_is_active()) {
+            return false;
+        }
+        if (!_parallel) {
+            // 媒体源尚未注册(注册可能触发广播或抛异常)，在归属线程中直接复用；此时队列为空，不影响帧序
+            if (!_is_registed()) {
+                return _on_frame(frame);
+            }
+            _parallel = true;
+        }
+        auto is_video = frame->getTrackType() == TrackVideo;
+        _have_video = is_video || _have_video;
+        auto now = getCurrentMicrosecond();
+        auto head = _head.load(std::memory_order_acquire);
+        auto depth = _tail.load(std::memory_order_relaxed) - head;
+        // 积压时长为队首数据的排队时长
+        auto lag = depth ? now - _stamps[head & (kQueueSize - 1)] : 0;
+        if (!_dropping && (depth >= kQueueSize || lag > _max_lag_us)) {
+            _dropping = true;
+            WarnL << "Mux stage " << _name << " overloaded, queue: " << depth << ", lag: " << lag / 1000 << "ms, drop frames until next key frame";
+        }
+        if (_dropping) {
+            auto recovered = depth < kQueueSize / 2 && lag <= _max_lag_us / 2;
+            auto key_pos = _have_video ? is_video && (frame->keyFrame() || frame->configFrame()) : true;
+            if (!recovered || !key_pos) {
+                ++_drop_frames;
+                return false;
+            }
+            _dropping = false;
+            InfoL << "Mux stage " << _name << " recovered, dropped frames: " << _drop_frames.load();
+        }
+        Item item;
+        item.frame = frame;
+        item.stamp = now;
+        push(std::move(item));
+        return true;
+    }
+
+    /**
+     * 等待已经输入的帧复用完毕，在归属线程调用
+     * 返回后直到下次inputFrame之前，该阶段的线程不会访问复用器
+     */
+    void sync() {
+        // 复用器可能被修改(例如重新创建录制器)，下次输入时重新检查媒体源是否已注册
+        _parallel = false;
+        if (_poller->isCurrentThread()) {
+            onDrain();
+            return;
+        }
+        semaphore sem;
+        Item item;
+        item.task = [&sem]() { sem.post(); };
+        item.stamp = getCurrentMicrosecond();
+        push(std::move(item));
+        sem.wait();
+    }
+
+    MultiMediaSourceMuxer::MuxStageInfo getInfo() {
+        MultiMediaSourceMuxer::MuxStageInfo info;
+        info.name = _name;
+        info.thread = _poller->getThreadName();
+        info.queue_size = size();
+        info.frames = _frames.load();
+        info.drop_frames = _drop_frames.load();
+        // 延时统计为两次查询之间的平均值与最大值
+        auto latency_us = _latency_us.exchange(0);
+        auto latency_frames = _latency_frames.exchange(0);
+        info.latency_us = latency_frames ? latency_us / latency_frames : 0;
+        info.max_latency_us = _max_latency_us.exchange(0);
+        return info;
+    }
+
+private:
+    struct Item {
+        Frame::Ptr frame;
+        std::function<void()> task;
+        // 入队时间，单位微秒
+        uint64_t stamp = 0;
+    };
+
+    size_t size() const { return _tail.load() - _head.load(); }
+
+    // 生产者线程调用
+    void push(Item item) {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        while (tail - _head.load(std::memory_order_acquire) >= kQueueSize) {
+            // 只有sync时可能走到这里(inputFrame在队列满时丢帧)，等待消费者腾出空间
+            std::this_thread::yield();
+        }
+        _stamps[tail & (kQueueSize - 1)] = item.stamp;
+        _slots[tail & (kQueueSize - 1)] = std::move(item);
+        _tail.store(tail + 1);
+        if (!_scheduled.exchange(true)) {
+            std::weak_ptr<MuxerStage> weak_self = shared_from_this();
+            _poller->async([weak_self]() {
+                if (auto strong_self = weak_self.lock()) {
+                    strong_self->onDrain();
+                }
+            });
+        }
+    }
+
+    // 消费者线程调用
+    void onDrain() {
+        while (true) {
+            auto head = _head.load(std::memory_order_relaxed);
+            while (head != _tail.load(std::memory_order_acquire)) {
+                auto item = std::move(_slots[head & (kQueueSize - 1)]);
+                _head.store(++head, std::memory_order_release);
+                if (item.task) {
+                    item.task();
+                    continue;
+                }
+                try {
+                    _on_frame(item.frame);
+                } catch (std::exception &ex) {
+                    WarnL << "Mux stage " << _name << " input frame failed: " << ex.what();
+                }
+                auto latency = getCurrentMicrosecond() - item.stamp;
+                ++_frames;
+                ++_latency_frames;
+                _latency_us += latency;
+                if (latency > _max_latency_us.load()) {
+                    _max_latency_us = latency;
+                }
+            }
+            // 先清除调度标记再检查队列，防止丢失生产者的唤醒
+            _scheduled = false;
+            if (_tail.load() == _head.load() || _scheduled.exchange(true)) {
+                break;
+            }
+        }
+    }
+
+private:
+    bool _dropping = false;
+    bool _have_video = false;
+    // 是否已交给阶段线程复用，只在归属线程访问
+    bool _parallel = false;
+    uint64_t _max_lag_us;
+    std::string _name;
+    IsActive _is_active;
+    IsRegisted _is_registed;
+    OnFrame _on_frame;
+    EventPoller::Ptr _poller;
+    std::vector<Item> _slots;
+    // 各数据的入队时间，只在生产者线程访问
+    std::vector<uint64_t> _stamps;
+    std::atomic<size_t> _head { 0 };
+    std::atomic<size_t> _tail { 0 };
+    std::atomic<bool> _scheduled { false };
+    std::atomic<uint64_t> _frames { 0 };
+    std::atomic<uint64_t> _drop_frames { 0 };
+    std::atomic<uint64_t> _latency_us { 0 };
+    std::atomic<uint64_t> _latency_frames { 0 };
+    std::atomic<uint64_t> _max_latency_us { 0 };
+};
+
 static std::shared_ptr<MediaSinkInterface> makeRecorder(MediaSource &sender, const vector<Track::Ptr> &tracks, Recorder::type type, const ProtocolOption &option){
     auto recorder = Recorder::createRecorder(type, sender.getMediaTuple(), option);
     for (auto &track : tracks) {
@@ -211,12 +428,28 @@ MultiMediaSourceMuxer::MultiMediaSourceMuxer(const MediaTuple& tuple, float dur_
     if (option.enable_fmp4) {
         _fmp4 = dynamic_pointer_cast<FMP4MediaSourceMuxer>(Recorder::createRecorder(Recorder::type_fmp4, _tuple, option));
     }
+    if (_ts || _hls) {
+        createTSMuxerIfNeed();
+    }
 
     //音频相关设置
     enableAudio(option.enable_audio);
     enableMuteAudio(option.add_mute_audio);
 }
 
+MultiMediaSourceMuxer::~MultiMediaSourceMuxer() {
+    waitMuxStages();
+    _stages.clear();
+    if (_ts_muxer) {
+        try {
+            // 输出最后一帧缓存的ts数据
+            _ts_muxer->flush();
+        } catch (std::exception &ex) {
+            WarnL << ex.what();
+        }
+    }
+}
+
 void MultiMediaSourceMuxer::setMediaListener(const std::weak_ptr<MediaSourceEvent> &listener) {
     setDelegate(listener);
 
@@ -254,10 +487,12 @@ int MultiMediaSourceMuxer::totalReaderCount() const {
            (_mp4 ? _option.mp4_as_player : 0) +
            (_hls ? _hls->readerCount() : 0) +
            (_hls_fmp4 ? _hls_fmp4->readerCount() : 0) +
-           (_ring ? _ring->readerCount() : 0);
+           (_ring ? _ring->readerCount() : 0) +
+           (_ts_ring ? _ts_ring->readerCount() : 0);
 }
 
 void MultiMediaSourceMuxer::setTimeStamp(uint32_t stamp) {
+    waitMuxStages();
     if (_rtmp) {
         _rtmp->setTimeStamp(stamp);
     }
@@ -282,6 +517,8 @@ int MultiMediaSourceMuxer::totalReaderCount(MediaSource &sender) {
 //此函数可能跨线程调用
 bool MultiMediaSourceMuxer::setupRecord(MediaSource &sender, Recorder::type type, bool start, const string &custom_path, size_t max_second) {
     CHECK(getOwnerPoller(MediaSource::NullMediaSource())->isCurrentThread(), "Can only call setupRecord in it's owner poller");
+    // 并行复用时，等待各阶段空闲后才能修改复用器
+    waitMuxStages();
     onceToken token(nullptr, [&]() {
         if (_option.mp4_as_player && type == Recorder::type_mp4) {
             //开启关闭mp4录制，触发观看人数变化相关事件
@@ -293,10 +530,12 @@ bool MultiMediaSourceMuxer::setupRecord(MediaSource &sender, Recorder::type type
             if (start && !_hls) {
                 //开始录制
                 _option.hls_save_path = custom_path;
-                auto hls = dynamic_pointer_cast<HlsRecorder>(makeRecorder(sender, getTracks(), type, _option));
+                // 输入数据来自共享ts复用器，无需添加track
+                auto hls = dynamic_pointer_cast<HlsRecorder>(Recorder::createRecorder(type, sender.getMediaTuple(), _option));
                 if (hls) {
                     //设置HlsMediaSource的事件监听器
                     hls->setListener(shared_from_this());
+                    createTSMuxerIfNeed();
                 }
                 _hls = hls;
             } else if (!start && _hls) {
@@ -347,9 +586,11 @@ bool MultiMediaSourceMuxer::setupRecord(MediaSource &sender, Recorder::type type
         }
         case Recorder::type_ts: {
             if (start && !_ts) {
-                auto ts = dynamic_pointer_cast<TSMediaSourceMuxer>(makeRecorder(sender, getTracks(), type, _option));
+                // 输入数据来自共享ts复用器，无需添加track
+                auto ts = dynamic_pointer_cast<TSMediaSourceMuxer>(Recorder::createRecorder(type, sender.getMediaTuple(), _option));
                 if (ts) {
                     ts->setListener(shared_from_this());
+                    createTSMuxerIfNeed();
                 }
                 _ts = ts;
             } else if (!start && _ts) {
@@ -375,9 +616,20 @@ bool MultiMediaSourceMuxer::isRecording(MediaSource &sender, Recorder::type type
 
 void MultiMediaSourceMuxer::startSendRtp(MediaSource &sender, const MediaSourceEvent::SendRtpArgs &args, const std::function<void(uint16_t, const toolkit::SockException &)> cb) {
 #if defined(ENABLE_RTPPROXY)
-    createGopCacheIfNeed();
+    // ts rtp推流直接打包共享ts复用器的输出，不再单独复用(仅推音频时仍需单独复用)
+    auto share_ts = args.data_type == MediaSourceEvent::SendRtpArgs::kRtpTS && !args.only_audio;
+    if (share_ts) {
+        waitMuxStages();
+        createTSMuxerIfNeed();
+        createTSRingIfNeed();
+    } else {
+        createGopCacheIfNeed();
+    }
 
+    // ps/es推流由打包格式相同的推流共享一个打包器，见attachSharedRtp
+    auto share_rtp = RtpCacheShared::isSupported(args);
     auto ring = _ring;
+    auto ts_ring = _ts_ring;
     auto ssrc = args.ssrc;
     auto ssrc_multi_send = args.ssrc_multi_send;
     auto tracks = getTracks(false);
@@ -397,29 +649,43 @@ void MultiMediaSourceMuxer::startSendRtp(MediaSource &sender, const MediaSourceE
         }
     });
 
-    rtp_sender->startSend(args, [ssrc,ssrc_multi_send, weak_self, rtp_sender, cb, tracks, ring, poller](uint16_t local_port, const SockException &ex) mutable {
+    rtp_sender->startSend(args, [args, ssrc,ssrc_multi_send, weak_self, rtp_sender, cb, tracks, ring, ts_ring, share_ts, share_rtp, poller](uint16_t local_port, const SockException &ex) mutable {
         cb(local_port, ex);
         auto strong_self = weak_self.lock();
         if (!strong_self || ex) {
             return;
         }
 
-        for (auto &track : tracks) {
-            rtp_sender->addTrack(track);
+        if (!share_ts && !share_rtp) {
+            for (auto &track : tracks) {
+                rtp_sender->addTrack(track);
+            }
+            rtp_sender->addTrackCompleted();
         }
-        rtp_sender->addTrackCompleted();
 
-        auto reader = ring->attach(poller);
-        reader->setReadCB([rtp_sender](const Frame::Ptr &frame) {
-            rtp_sender->inputFrame(frame);
-        });
+        std::shared_ptr<void> reader;
+        if (share_ts) {
+            auto ts_reader = ts_ring->attach(poller);
+            ts_reader->setReadCB([rtp_sender](const std::pair<TSPacket::Ptr, bool> &pr) {
+                rtp_sender->inputMpeg(pr.first, pr.first->time_stamp, pr.second);
+            });
+            reader = std::move(ts_reader);
+        } else if (!share_rtp) {
+            auto frame_reader = ring->attach(poller);
+            frame_reader->setReadCB([rtp_sender](const Frame::Ptr &frame) {
+                rtp_sender->inputFrame(frame);
+            });
+            reader = std::move(frame_reader);
+        }
 
         // 可能归属线程发生变更
         strong_self->getOwnerPoller(MediaSource::NullMediaSource())->async([=]() {
+            // 共享打包器在归属线程中创建与读取
+            auto rtp_reader = share_rtp ? strong_self->attachSharedRtp(args, rtp_sender) : reader;
             if(!ssrc_multi_send) {
                 strong_self->_rtp_sender.erase(ssrc);
             }
-            strong_self->_rtp_sender.emplace(ssrc,reader);
+            strong_self->_rtp_sender.emplace(ssrc, std::move(rtp_reader));
         });
     });
 #else
@@ -427,6 +693,41 @@ void MultiMediaSourceMuxer::startSendRtp(MediaSource &sender, const MediaSourceE
 #endif//ENABLE_RTPPROXY
 }
 
+#if defined(ENABLE_RTPPROXY)
+std::shared_ptr<void> MultiMediaSourceMuxer::attachSharedRtp(const MediaSourceEvent::SendRtpArgs &args, const std::shared_ptr<RtpSender> &rtp_sender) {
+    auto poller = getOwnerPoller(MediaSource::NullMediaSource());
+    auto key = RtpCacheShared::getKey(args);
+    auto &encoder = _rtp_encoders[key];
+    if (!encoder.first) {
+        weak_ptr<MultiMediaSourceMuxer> weak_self = shared_from_this();
+        auto shared = std::make_shared<RtpCacheShared>(args, [weak_self, key](int size) {
+            if (auto strong_self = weak_self.lock()) {
+                // 切换到归属线程
+                strong_self->getOwnerPoller(MediaSource::NullMediaSource())->async([=]() {
+                    auto it = strong_self->_rtp_encoders.find(key);
+                    if (it != strong_self->_rtp_encoders.end() && !it->second.first->getRing()->readerCount()) {
+                        // 所有推流目标都已停止，释放共享打包器
+                        strong_self->_rtp_encoders.erase(it);
+                    }
+                });
+            }
+        });
+        for (auto &track : getTracks(false)) {
+            shared->addTrack(track);
+        }
+        shared->addTrackCompleted();
+        // 共享打包器作为帧环形缓存的一个读取者(先读取gop缓存)，每帧只打包一次
+        auto frame_reader = _ring->attach(poller);
+        frame_reader->setReadCB([shared](const Frame::Ptr &frame) { shared->inputFrame(frame); });
+        encoder = std::make_pair(std::move(shared), std::move(frame_reader));
+        InfoL << "stream: " << shortUrl() << ", create shared rtp encoder: " << key;
+    }
+    auto reader = encoder.first->getRing()->attach(poller);
+    reader->setReadCB([rtp_sender](const RtpCacheShared::RingDataType &rtp_list) { rtp_sender->inputSharedRtp(rtp_list); });
+    return reader;
+}
+#endif
+
 bool MultiMediaSourceMuxer::stopSendRtp(MediaSource &sender, const string &ssrc) {
 #if defined(ENABLE_RTPPROXY)
     if (ssrc.empty()) {
@@ -472,6 +773,7 @@ std::shared_ptr<MultiMediaSourceMuxer> MultiMediaSourceMuxer::getMuxer(MediaSour
 }
 
 bool MultiMediaSourceMuxer::onTrackReady(const Track::Ptr &track) {
+    waitMuxStages();
     auto &stamp = _stamps[track->getIndex()];
     if (_dur_sec > 0.01) {
         // 点播
@@ -485,15 +787,12 @@ bool MultiMediaSourceMuxer::onTrackReady(const Track::Ptr &track) {
     if (_rtsp) {
         ret = _rtsp->addTrack(track) ? true : ret;
     }
-    if (_ts) {
-        ret = _ts->addTrack(track) ? true : ret;
+    if (_ts_muxer) {
+        ret = _ts_muxer->addTrack(track) ? true : ret;
     }
     if (_fmp4) {
         ret = _fmp4->addTrack(track) ? true : ret;
     }
-    if (_hls) {
-        ret = _hls->addTrack(track) ? true : ret;
-    }
     if (_hls_fmp4) {
         ret = _hls_fmp4->addTrack(track) ? true : ret;
     }
@@ -516,6 +815,7 @@ void MultiMediaSourceMuxer::onAllTrackReady() {
     }
 
     setMediaListener(getDelegate());
+    waitMuxStages();
 
     if (_rtmp) {
         _rtmp->addTrackCompleted();
@@ -523,8 +823,8 @@ void MultiMediaSourceMuxer::onAllTrackReady() {
     if (_rtsp) {
         _rtsp->addTrackCompleted();
     }
-    if (_ts) {
-        _ts->addTrackCompleted();
+    if (_ts_muxer) {
+        _ts_muxer->addTrackCompleted();
     }
     if (_mp4) {
         _mp4->addTrackCompleted();
@@ -532,9 +832,6 @@ void MultiMediaSourceMuxer::onAllTrackReady() {
     if (_fmp4) {
         _fmp4->addTrackCompleted();
     }
-    if (_hls) {
-        _hls->addTrackCompleted();
-    }
     if (_hls_fmp4) {
         _hls_fmp4->addTrackCompleted();
     }
@@ -550,6 +847,7 @@ void MultiMediaSourceMuxer::onAllTrackReady() {
         createGopCacheIfNeed();
     }
 #endif
+    createMuxStages();
 
     Stamp *first = nullptr;
     for (auto &pr : _stamps) {
@@ -578,7 +876,58 @@ void MultiMediaSourceMuxer::createGopCacheIfNeed() {
     });
 }
 
+void MultiMediaSourceMuxer::createTSMuxerIfNeed() {
+    if (_ts_muxer) {
+        return;
+    }
+    // 复用器与本对象生命周期一致，回调不必持有强引用
+    _ts_muxer = std::make_shared<MpegMuxerImp>([this](const Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos) {
+        onTSWrite(buffer, timestamp, key_pos);
+    });
+    if (!isAllTrackReady()) {
+        // 尚未就绪的track由onTrackReady添加
+        return;
+    }
+    for (auto &track : getTracks()) {
+        _ts_muxer->addTrack(track);
+    }
+    _ts_muxer->addTrackCompleted();
+}
+
+void MultiMediaSourceMuxer::createTSRingIfNeed() {
+    if (_ts_ring) {
+        return;
+    }
+    weak_ptr<MultiMediaSourceMuxer> weak_self = shared_from_this();
+    auto src = std::make_shared<MediaSourceForMuxer>(weak_self.lock());
+    _ts_ring = std::make_shared<TSRingType>(1024, [weak_self, src](int size) {
+        if (auto strong_self = weak_self.lock()) {
+            // 切换到归属线程
+            strong_self->getOwnerPoller(MediaSource::NullMediaSource())->async([=]() {
+                strong_self->onReaderChanged(*src, strong_self->totalReaderCount());
+            });
+        }
+    });
+}
+
+void MultiMediaSourceMuxer::onTSWrite(const Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos) {
+    // buffer为空时代表track重置
+    if (_ts) {
+        _ts->inputTS(buffer, timestamp, key_pos);
+    }
+    if (_hls) {
+        _hls->inputTS(buffer, timestamp, key_pos);
+    }
+    if (_ts_ring && buffer) {
+        auto packet = std::make_shared<TSPacket>(buffer);
+        packet->time_stamp = timestamp;
+        // 没有视频时，设置is_key为true，目的是关闭gop缓存
+        _ts_ring->write(std::make_pair(std::move(packet), key_pos), key_pos || !haveVideo());
+    }
+}
+
 void MultiMediaSourceMuxer::resetTracks() {
+    waitMuxStages();
     MediaSink::resetTracks();
 
     if (_rtmp) {
@@ -587,8 +936,8 @@ void MultiMediaSourceMuxer::resetTracks() {
     if (_rtsp) {
         _rtsp->resetTracks();
     }
-    if (_ts) {
-        _ts->resetTracks();
+    if (_ts_muxer) {
+        _ts_muxer->resetTracks();
     }
     if (_fmp4) {
         _fmp4->resetTracks();
@@ -596,9 +945,6 @@ void MultiMediaSourceMuxer::resetTracks() {
     if (_hls_fmp4) {
         _hls_fmp4->resetTracks();
     }
-    if (_hls) {
-        _hls->resetTracks();
-    }
     if (_mp4) {
         _mp4->resetTracks();
     }
@@ -616,29 +962,31 @@ bool MultiMediaSourceMuxer::onTrackFrame(const Frame::Ptr &frame_in) {
 bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
     auto frame = frame_in;
     bool ret = false;
-    if (_rtmp) {
-        ret = _rtmp->inputFrame(frame) ? true : ret;
-    }
-    if (_rtsp) {
-        ret = _rtsp->inputFrame(frame) ? true : ret;
-    }
-    if (_ts) {
-        ret = _ts->inputFrame(frame) ? true : ret;
-    }
-
-    if (_hls) {
-        ret = _hls->inputFrame(frame) ? true : ret;
-    }
-
-    if (_hls_fmp4) {
-        ret = _hls_fmp4->inputFrame(frame) ? true : ret;
-    }
-
-    if (_mp4) {
-        ret = _mp4->inputFrame(frame) ? true : ret;
-    }
-    if (_fmp4) {
-        ret = _fmp4->inputFrame(frame) ? true : ret;
+    if (!_stages.empty()) {
+        // 并行复用，各协议在各自的线程中复用，所以需要CacheAbleFrame
+        frame = Frame::getCacheAbleFrame(frame);
+        for (auto &stage : _stages) {
+            ret = stage->inputFrame(frame) ? true : ret;
+        }
+    } else {
+        if (_rtmp) {
+            ret = _rtmp->inputFrame(frame) ? true : ret;
+        }
+        if (_rtsp) {
+            ret = _rtsp->inputFrame(frame) ? true : ret;
+        }
+        if (_ts_muxer) {
+            ret = inputTSFrame(frame) ? true : ret;
+        }
+        if (_hls_fmp4) {
+            ret = _hls_fmp4->inputFrame(frame) ? true : ret;
+        }
+        if (_mp4) {
+            ret = _mp4->inputFrame(frame) ? true : ret;
+        }
+        if (_fmp4) {
+            ret = _fmp4->inputFrame(frame) ? true : ret;
+        }
     }
     if (_ring) {
         // 此场景由于直接转发，可能存在切换线程引起的数据被缓存在管道，所以需要CacheAbleFrame
@@ -658,6 +1006,57 @@ bool MultiMediaSourceMuxer::onTrackFrame_l(const Frame::Ptr &frame_in) {
     return ret;
 }
 
+bool MultiMediaSourceMuxer::inputTSFrame(const Frame::Ptr &frame) {
+    // ts直播、hls与ts rtp推流共用一个ts复用器，有任意一个需要ts数据时才复用
+    // prepareInput可能清空缓存，所以每个都要调用
+    auto need_ts = _ts ? _ts->prepareInput() : false;
+    need_ts = (_hls ? _hls->prepareInput() : false) || need_ts;
+    // ts rtp推流在连接成功后才attach，_ts_ring存在时一直复用，保证其gop缓存有数据，推流从关键帧开始
+    need_ts = !!_ts_ring || need_ts;
+    return need_ts ? _ts_muxer->inputFrame(frame) : false;
+}
+
+void MultiMediaSourceMuxer::createMuxStages() {
+    if (!_option.parallel_mux_ms || !_stages.empty()) {
+        return;
+    }
+    auto add_stage = [&](const char *name, MuxerStage::IsActive is_active, MuxerStage::IsRegisted is_registed, MuxerStage::OnFrame on_frame) {
+        auto stage = std::make_shared<MuxerStage>(name, _option.parallel_mux_ms, std::move(is_active), std::move(is_registed), std::move(on_frame));
+        InfoL << "stream: " << shortUrl() << ", mux stage " << name << " run in " << stage->getPoller()->getThreadName();
+        _stages.emplace_back(std::move(stage));
+    };
+    // is_active与is_registed在归属线程执行，on_frame在各阶段的线程中执行；
+    // 复用器的创建、销毁与track变更只在waitMuxStages之后(各阶段空闲时)由归属线程进行；
+    // 唯一例外是归属线程中onReaderChanged修改的按需复用开关(_enabled/_clear_cache)，它们为原子变量
+    add_stage("rtmp", [this]() { return !!_rtmp; }, [this]() { return _rtmp->isRegisted(); },
+              [this](const Frame::Ptr &frame) { return _rtmp ? _rtmp->inputFrame(frame) : false; });
+    add_stage("rtsp", [this]() { return !!_rtsp; }, [this]() { return _rtsp->isRegisted(); },
+              [this](const Frame::Ptr &frame) { return _rtsp ? _rtsp->inputFrame(frame) : false; });
+    add_stage("ts", [this]() { return !!_ts_muxer; }, [this]() { return (!_ts || _ts->isRegisted()) && (!_hls || _hls->isRegisted()); },
+              [this](const Frame::Ptr &frame) { return _ts_muxer ? inputTSFrame(frame) : false; });
+    add_stage("hls_fmp4", [this]() { return !!_hls_fmp4; }, [this]() { return _hls_fmp4->isRegisted(); },
+              [this](const Frame::Ptr &frame) { return _hls_fmp4 ? _hls_fmp4->inputFrame(frame) : false; });
+    // mp4录制没有对应的媒体源
+    add_stage("mp4", [this]() { return !!_mp4; }, []() { return true; },
+              [this](const Frame::Ptr &frame) { return _mp4 ? _mp4->inputFrame(frame) : false; });
+    add_stage("fmp4", [this]() { return !!_fmp4; }, [this]() { return _fmp4->isRegisted(); },
+              [this](const Frame::Ptr &frame) { return _fmp4 ? _fmp4->inputFrame(frame) : false; });
+}
+
+void MultiMediaSourceMuxer::waitMuxStages() {
+    for (auto &stage : _stages) {
+        stage->sync();
+    }
+}
+
+std::vector<MultiMediaSourceMuxer::MuxStageInfo> MultiMediaSourceMuxer::getMuxStageInfo() const {
+    std::vector<MuxStageInfo> ret;
+    for (auto &stage : _stages) {
+        ret.emplace_back(stage->getInfo());
+    }
+    return ret;
+}
+
 bool MultiMediaSourceMuxer::isEnabled(){
     GET_CONFIG(uint32_t, stream_none_reader_delay_ms, General::kStreamNoneReaderDelayMS);
     if (!_is_enable || _last_check.elapsedTime() > stream_none_reader_delay_ms) {
@@ -668,6 +1067,7 @@ bool MultiMediaSourceMuxer::isEnabled(){
                      (_ts ? _ts->isEnabled() : false) ||
                      (_fmp4 ? _fmp4->isEnabled() : false) ||
                      (_ring ? (bool)_ring->readerCount() : false)  ||
+                     (_ts_ring ? (bool)_ts_ring->readerCount() : false)  ||
                      (_hls ? _hls->isEnabled() : false) ||
                      (_hls_fmp4 ? _hls_fmp4->isEnabled() : false) ||
                      _mp4;
@@ -29,6 +29,8 @@ class MultiMediaSourceMuxer : public MediaSourceEventInterceptor, public MediaSi
 public:
     using Ptr = std::shared_ptr<MultiMediaSourceMuxer>;
     using RingType = toolkit::RingBuffer<Frame::Ptr>;
+    // 共享ts复用器输出的ts数据及其是否为关键帧起始位置，用于ts rtp推流
+    using TSRingType = toolkit::RingBuffer<std::pair<TSPacket::Ptr, bool> >;
 
     class Listener {
     public:
@@ -36,7 +38,21 @@ public:
         virtual void onAllTrackReady() = 0;
     };
 
+    // 并行复用单个协议阶段的统计信息
+    struct MuxStageInfo {
+        std::string name;
+        std::string thread;
+        // 排队中的帧数
+        size_t queue_size = 0;
+        uint64_t frames = 0;
+        uint64_t drop_frames = 0;
+        // 上次查询以来的平均与最大排队加复用耗时，单位微秒
+        uint64_t latency_us = 0;
+        uint64_t max_latency_us = 0;
+    };
+
     MultiMediaSourceMuxer(const MediaTuple& tuple, float dur_sec = 0.0,const ProtocolOption &option = ProtocolOption());
+    ~MultiMediaSourceMuxer() override;
 
     /**
      * 设置事件监听器
@@ -135,6 +151,12 @@ public:
 
     void forEachRtpSender(const std::function<void(const std::string &ssrc)> &cb) const;
 
+    /**
+     * 获取并行复用各协议阶段的统计信息，未开启protocol.parallel_mux_ms时为空
+     * 应该在归属线程调用
+     */
+    std::vector<MuxStageInfo> getMuxStageInfo() const;
+
 protected:
     /////////////////////////////////MediaSink override/////////////////////////////////
 
@@ -159,6 +181,13 @@ protected:
 
 private:
     void createGopCacheIfNeed();
+    void createMuxStages();
+    void waitMuxStages();
+    bool inputTSFrame(const Frame::Ptr &frame);
+    void createTSMuxerIfNeed();
+    void createTSRingIfNeed();
+    void onTSWrite(const toolkit::Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos);
+    std::shared_ptr<void> attachSharedRtp(const MediaSourceEvent::SendRtpArgs &args, const std::shared_ptr<class RtpSender> &rtp_sender);
 
 private:
     bool _is_enable = false;
@@ -166,12 +195,17 @@ private:
     bool _video_key_pos = false;
     float _dur_sec;
     std::shared_ptr<class FramePacedSender> _paced_sender;
+    // 并行复用时各协议的复用阶段
+    std::vector<std::shared_ptr<class MuxerStage> > _stages;
     MediaTuple _tuple;
     ProtocolOption _option;
     toolkit::Ticker _last_check;
     std::unordered_map<int, Stamp> _stamps;
     std::weak_ptr<Listener> _track_listener;
-    std::unordered_multimap<std::string, RingType::RingReader::Ptr> _rtp_sender;
+    // 值为_ring、_ts_ring或共享打包器环形缓存的RingReader
+    std::unordered_multimap<std::string, std::shared_ptr<void> > _rtp_sender;
+    // ps/es推流的共享打包器及其读取帧的RingReader，键为打包格式
+    std::unordered_map<std::string, std::pair<std::shared_ptr<class RtpCacheShared>, RingType::RingReader::Ptr> > _rtp_encoders;
     FMP4MediaSourceMuxer::Ptr _fmp4;
     RtmpMediaSourceMuxer::Ptr _rtmp;
     RtspMediaSourceMuxer::Ptr _rtsp;
@@ -181,6 +215,9 @@ private:
     HlsFMP4Recorder::Ptr _hls_fmp4;
     toolkit::EventPoller::Ptr _poller;
     RingType::Ptr _ring;
+    // ts直播、hls与ts rtp推流共享的ts复用器
+    MpegMuxerImp::Ptr _ts_muxer;
+    TSRingType::Ptr _ts_ring;
 
     //对象个数统计
     toolkit::ObjectStatistic<MultiMediaSourceMuxer> _statistic;
@@ -112,6 +112,7 @@ const string kAddMuteAudio = string(kFieldName) + "add_mute_audio";
 const string kAutoClose = string(kFieldName) + "auto_close";
 const string kContinuePushMS = string(kFieldName) + "continue_push_ms";
 const string kPacedSenderMS = string(kFieldName) + "paced_sender_ms";
+const string kParallelMuxMS = string(kFieldName) + "parallel_mux_ms";
 
 const string kEnableHls = string(kFieldName) + "enable_hls";
 const string kEnableHlsFmp4 = string(kFieldName) + "enable_hls_fmp4";
@@ -139,6 +140,7 @@ static onceToken token([]() {
     mINI::Instance()[kAddMuteAudio] = 1;
     mINI::Instance()[kContinuePushMS] = 15000;
     mINI::Instance()[kPacedSenderMS] = 0;
+    mINI::Instance()[kParallelMuxMS] = 0;
     mINI::Instance()[kAutoClose] = 0;
 
     mINI::Instance()[kEnableHls] = 1;
@@ -223,6 +225,7 @@ const string kKeepAliveSecond = RTSP_FIELD "keepAliveSecond";
 const string kDirectProxy = RTSP_FIELD "directProxy";
 const string kLowLatency = RTSP_FIELD"lowLatency";
 const string kRtpTransportType = RTSP_FIELD"rtpTransportType";
+const string kRtpBlockKB = RTSP_FIELD "rtpBlockKB";
 
 static onceToken token([]() {
     // 默认Md5方式认证
@@ -232,6 +235,7 @@ static onceToken token([]() {
     mINI::Instance()[kDirectProxy] = 1;
     mINI::Instance()[kLowLatency] = 0;
     mINI::Instance()[kRtpTransportType] = -1;
+    mINI::Instance()[kRtpBlockKB] = 64;
 });
 } // namespace Rtsp
 
@@ -297,6 +301,11 @@ const string kFileBufSize = RECORD_FIELD "fileBufSize";
 const string kFastStart = RECORD_FIELD "fastStart";
 const string kFileRepeat = RECORD_FIELD "fileRepeat";
 const string kEnableFmp4 = RECORD_FIELD "enableFmp4";
+const string kIndexCacheMB = RECORD_FIELD "indexCacheMB";
+const string kReadAheadKB = RECORD_FIELD "readAheadKB";
+const string kIOThreadNum = RECORD_FIELD "ioThreadNum";
+const string kIOQueueMB = RECORD_FIELD "ioQueueMB";
+const string kIODropOnFull = RECORD_FIELD "ioDropOnFull";
 
 static onceToken token([]() {
     mINI::Instance()[kAppName] = "record";
@@ -305,6 +314,11 @@ static onceToken token([]() {
     mINI::Instance()[kFastStart] = false;
     mINI::Instance()[kFileRepeat] = false;
     mINI::Instance()[kEnableFmp4] = false;
+    mINI::Instance()[kIndexCacheMB] = 256;
+    mINI::Instance()[kReadAheadKB] = 1024;
+    mINI::Instance()[kIOThreadNum] = 2;
+    mINI::Instance()[kIOQueueMB] = 32;
+    mINI::Instance()[kIODropOnFull] = false;
 });
 } // namespace Record
 
@@ -320,6 +334,8 @@ const string kFileBufSize = HLS_FIELD "fileBufSize";
 const string kBroadcastRecordTs = HLS_FIELD "broadcastRecordTs";
 const string kDeleteDelaySec = HLS_FIELD "deleteDelaySec";
 const string kFastRegister = HLS_FIELD "fastRegister";
+const string kSegmentInMemory = HLS_FIELD "segInMemory";
+const string kPartDuration = HLS_FIELD "partDur";
 
 static onceToken token([]() {
     mINI::Instance()[kSegmentDuration] = 2;
@@ -331,6 +347,8 @@ static onceToken token([]() {
     mINI::Instance()[kBroadcastRecordTs] = false;
     mINI::Instance()[kDeleteDelaySec] = 10;
     mINI::Instance()[kFastRegister] = false;
+    mINI::Instance()[kSegmentInMemory] = false;
+    mINI::Instance()[kPartDuration] = 0;
 });
 } // namespace Hls
 
@@ -347,6 +365,7 @@ const string kOpusPT = RTP_PROXY_FIELD "opus_pt";
 const string kGopCache = RTP_PROXY_FIELD "gop_cache";
 const string kRtpG711DurMs = RTP_PROXY_FIELD "rtp_g711_dur_ms";
 const string kUdpRecvSocketBuffer = RTP_PROXY_FIELD "udp_recv_socket_buffer";
+const string kPSFastDemux = RTP_PROXY_FIELD "ps_fast_demux";
 
 static onceToken token([]() {
     mINI::Instance()[kDumpDir] = "";
@@ -359,6 +378,7 @@ static onceToken token([]() {
     mINI::Instance()[kGopCache] = 1;
     mINI::Instance()[kRtpG711DurMs] = 100;
     mINI::Instance()[kUdpRecvSocketBuffer] = 4 * 1024 * 1024;
+    mINI::Instance()[kPSFastDemux] = 1;
 });
 } // namespace RtpProxy
 
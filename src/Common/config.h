@@ -223,6 +223,9 @@ extern const std::string kContinuePushMS;
 // 平滑发送定时器间隔，单位毫秒，置0则关闭；开启后影响cpu性能同时增加内存
 // 该配置开启后可以解决一些流发送不平滑导致zlmediakit转发也不平滑的问题
 extern const std::string kPacedSenderMS;
+// 多协议并行复用的最大积压时长，单位毫秒，置0则关闭
+// 开启后各协议的复用在各自的线程中执行，积压超过该时长时丢帧直到下一个关键帧
+extern const std::string kParallelMuxMS;
 
 //是否开启转换为hls(mpegts)
 extern const std::string kEnableHls;
@@ -313,6 +316,10 @@ extern const std::string kLowLatency;
 //当客户端发起RTSP SETUP的时候如果传输类型和此配置不一致则返回461 Unsupport Transport
 //迫使客户端重新SETUP并切换到对应协议。目前支持FFMPEG和VLC
 extern const std::string kRtpTransportType;
+
+// rtp接收内存块大小，单位KB；收到的rtp包依次存放在同一内存块中，不再每包分配内存，
+// 直接代理转发给rtsp/tcp播放器时也无需再合并拷贝；设置为0时每个rtp包单独分配内存
+extern const std::string kRtpBlockKB;
 } // namespace Rtsp
 
 ////////////RTMP服务器配置///////////
@@ -365,6 +372,16 @@ extern const std::string kFastStart;
 extern const std::string kFileRepeat;
 // mp4录制文件是否采用fmp4格式
 extern const std::string kEnableFmp4;
+// mp4点播采样索引缓存的内存上限，单位MB，为0时不缓存
+extern const std::string kIndexCacheMB;
+// mp4点播后台预读的数据量，单位KB，为0时不预读
+extern const std::string kReadAheadKB;
+// 录制(mp4/hls)写盘线程数
+extern const std::string kIOThreadNum;
+// 每个录制文件排队等待写盘的数据量上限，单位MB
+extern const std::string kIOQueueMB;
+// 写盘队列满时是否丢弃数据(文件将不完整)，否则阻塞媒体线程等待写盘
+extern const std::string kIODropOnFull;
 } // namespace Record
 
 ////////////HLS相关配置///////////
@@ -387,6 +404,10 @@ extern const std::string kBroadcastRecordTs;
 extern const std::string kDeleteDelaySec;
 // 如果设置为1，则第一个切片长度强制设置为1个GOP
 extern const std::string kFastRegister;
+// 直播hls(segNum>0且segKeep=0)的切片与m3u8是否只保存在内存中，不写磁盘
+extern const std::string kSegmentInMemory;
+// LL-HLS part时长,单位秒，大于0时开启LL-HLS(仅直播)
+extern const std::string kPartDuration;
 } // namespace Hls
 
 ////////////Rtp代理相关配置///////////
@@ -413,6 +434,8 @@ extern const std::string kGopCache;
 extern const std::string kRtpG711DurMs;
 // udp recv socket buffer size
 extern const std::string kUdpRecvSocketBuffer;
+// 是否使用内置的ps快速解析流程，关闭后使用libmpeg解析ps
+extern const std::string kPSFastDemux;
 } // namespace RtpProxy
 
 /**
@@ -35,10 +35,7 @@ bool CommonRtpDecoder::inputRtp(const RtpPacket::Ptr &rtp, bool){
 
     if (_last_stamp != stamp || _frame->_buffer.size() > _max_frame_size) {
         //时间戳发生变化或者缓存超过MAX_FRAME_SIZE，则清空上帧数据
-        if (!_frame->_buffer.empty()) {
-            //有有效帧，则输出
-            RtpCodec::inputFrame(_frame);
-        }
+        outputFrame();
 
         //新的一帧数据
         obtainFrame();
@@ -50,16 +47,41 @@ bool CommonRtpDecoder::inputRtp(const RtpPacket::Ptr &rtp, bool){
         WarnL << "rtp丢包:" << _last_seq << " -> " << seq;
         _drop_flag = true;
         _frame->_buffer.clear();
+        _first_rtp = nullptr;
     }
 
     if (!_drop_flag) {
-        _frame->_buffer.append((char *)payload, payload_size);
+        if (!_first_rtp && _frame->_buffer.empty()) {
+            //帧的第一个rtp包，先引用之，帧由多个rtp包组成时才需要拷贝合并
+            _first_rtp = rtp;
+        } else {
+            if (_first_rtp) {
+                _frame->_buffer.append((char *)_first_rtp->getPayload(), _first_rtp->getPayloadSize());
+                _first_rtp = nullptr;
+            }
+            _frame->_buffer.append((char *)payload, payload_size);
+        }
     }
 
     _last_seq = seq;
     return false;
 }
 
+void CommonRtpDecoder::outputFrame() {
+    if (_first_rtp) {
+        //该帧只有一个rtp包，直接引用rtp负载，无内存拷贝
+        auto offset = _first_rtp->getPayload() - (uint8_t *)_first_rtp->data();
+        auto size = _first_rtp->getPayloadSize();
+        auto buffer = std::make_shared<toolkit::BufferOffset<toolkit::Buffer::Ptr> >(std::move(_first_rtp), offset, size);
+        RtpCodec::inputFrame(std::make_shared<FrameFromBuffer<FrameFromPtr> >(_codec, std::move(buffer), _frame->_dts, 0));
+        return;
+    }
+    if (!_frame->_buffer.empty()) {
+        //有有效帧，则输出
+        RtpCodec::inputFrame(_frame);
+    }
+}
+
 ////////////////////////////////////////////////////////////////
 
 bool CommonRtpEncoder::inputFrame(const Frame::Ptr &frame){
@@ -39,6 +39,7 @@ public:
 
 private:
     void obtainFrame();
+    void outputFrame();
 
 private:
     bool _drop_flag = false;
@@ -47,6 +48,8 @@ private:
     size_t _max_frame_size;
     CodecId _codec;
     FrameImp::Ptr _frame;
+    // 帧的第一个rtp包，只有一个rtp包的帧直接引用rtp负载，不拷贝
+    RtpPacket::Ptr _first_rtp;
 };
 
 /**
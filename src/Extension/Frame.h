@@ -12,7 +12,10 @@
 #define ZLMEDIAKIT_FRAME_H
 
 #include <map>
+#include <vector>
 #include <mutex>
+#include <atomic>
+#include <thread>
 #include <functional>
 #include "Util/List.h"
 #include "Util/TimeTicker.h"
@@ -215,22 +218,24 @@ class FrameImp : public Frame {
 public:
     using Ptr = std::shared_ptr<FrameImp>;
 
+    /**
+     * 创建帧对象
+     * 帧对象在每个线程(即每个poller)独立的对象池中复用，无需加锁；回收时按内存大小分级缓存并保留内存，
+     * 组帧时无需重新申请内存，也避免了追加数据时扩容引起的内存拷贝；
+     * 在其他线程释放的帧对象归还到创建它的线程的对象池，线程退出时释放其对象池
+     * @param capacity 预计的帧大小，用于选取内存大小合适的帧对象，0表示未知
+     */
     template <typename C = FrameImp>
-    static std::shared_ptr<C> create() {
-#if 0
-        static ResourcePool<C> packet_pool;
-        static onceToken token([]() {
-            packet_pool.setSize(1024);
-        });
-        auto ret = packet_pool.obtain2();
-        ret->_buffer.clear();
-        ret->_prefix_size = 0;
-        ret->_dts = 0;
-        ret->_pts = 0;
-        return ret;
-#else
-        return std::shared_ptr<C>(new C());
-#endif
+    static std::shared_ptr<C> create(size_t capacity = 0) {
+        auto &pool = getPool<C>();
+        auto ptr = pool->obtain(getObtainClass(capacity));
+        if (!ptr) {
+            ptr = new C();
+        }
+        if (ptr->_buffer.capacity() < capacity) {
+            ptr->_buffer.reserve(capacity);
+        }
+        return std::shared_ptr<C>(ptr, [pool](C *ptr) { pool->recycle(ptr); });
     }
 
     char *data() const override { return (char *)_buffer.data(); }
@@ -249,6 +254,163 @@ public:
     size_t _prefix_size = 0;
     toolkit::BufferLikeString _buffer;
 
+private:
+    // 内存大小等级个数，各等级最小内存分别为0、2K、8K、32K、128K、512K
+    enum { kSizeClassCount = 6 };
+    // 最高等级的内存没有上限，超过该大小的帧对象不缓存
+    static constexpr size_t kMaxRetainCapacity = 1024 * 1024;
+    // 每个等级缓存的内存总量上限(包括其他线程归还的对象)，防止空闲的对象池长期占用大量内存
+    static constexpr size_t kMaxRetainBytes = 2 * 1024 * 1024;
+
+    template <typename C>
+    class FramePool {
+    public:
+        using Ptr = std::shared_ptr<FramePool>;
+
+        FramePool() : _owner(std::this_thread::get_id()) {}
+
+        ~FramePool() { clear(); }
+
+        /**
+         * 获取等级不低于index的空闲对象，本等级没有时尝试使用高一级的对象，在创建对象池的线程调用
+         */
+        C *obtain(size_t index) {
+            for (auto i = index; i < index + 2 && i < kSizeClassCount; ++i) {
+                auto &objs = _objs[i];
+                if (objs.empty() && _returned_count) {
+                    // 取回其他线程归还的对象
+                    std::lock_guard<std::mutex> lck(_mtx);
+                    objs.swap(_returned[i]);
+                    _returned_count -= objs.size();
+                }
+                if (!objs.empty()) {
+                    auto ptr = objs.back();
+                    objs.pop_back();
+                    _retained_bytes[i] -= ptr->_buffer.capacity();
+                    return ptr;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * 回收对象，可在任意线程调用
+         */
+        void recycle(C *ptr) {
+            auto capacity = ptr->_buffer.capacity();
+            if (capacity > kMaxRetainCapacity || _closed) {
+                delete ptr;
+                return;
+            }
+            auto index = getRecycleClass(capacity);
+            // 内存越大的等级缓存的对象越少，同时限制缓存的内存总量
+            auto max_size = 256u >> index;
+            if (_retained_bytes[index] + capacity > kMaxRetainBytes) {
+                delete ptr;
+                return;
+            }
+            ptr->_buffer.clear();
+            ptr->_dts = 0;
+            ptr->_pts = 0;
+            ptr->_prefix_size = 0;
+            ptr->setIndex(-1);
+            if (std::this_thread::get_id() == _owner) {
+                auto &objs = _objs[index];
+                if (objs.size() >= max_size) {
+                    delete ptr;
+                    return;
+                }
+                objs.emplace_back(ptr);
+                _retained_bytes[index] += capacity;
+                return;
+            }
+            // 其他线程释放的对象归还到创建它的线程，防止生产者线程的对象池一直为空而消费者线程的对象池一直增长
+            std::lock_guard<std::mutex> lck(_mtx);
+            auto &objs = _returned[index];
+            if (_closed || objs.size() >= max_size) {
+                delete ptr;
+                return;
+            }
+            objs.emplace_back(ptr);
+            _retained_bytes[index] += capacity;
+            ++_returned_count;
+        }
+
+        /**
+         * 创建对象池的线程退出时调用，释放缓存的对象，此后回收的对象直接释放
+         */
+        void close() {
+            _closed = true;
+            clear();
+        }
+
+    private:
+        void clear() {
+            for (auto &objs : _objs) {
+                for (auto ptr : objs) {
+                    delete ptr;
+                }
+                objs.clear();
+            }
+            std::lock_guard<std::mutex> lck(_mtx);
+            for (auto &objs : _returned) {
+                for (auto ptr : objs) {
+                    delete ptr;
+                }
+                objs.clear();
+            }
+            _returned_count = 0;
+            for (auto &bytes : _retained_bytes) {
+                bytes = 0;
+            }
+        }
+
+    private:
+        std::thread::id _owner;
+        std::atomic<bool> _closed { false };
+        // 只在创建对象池的线程访问
+        std::vector<C *> _objs[kSizeClassCount];
+        // 其他线程归还的对象
+        std::mutex _mtx;
+        std::atomic<size_t> _returned_count { 0 };
+        std::vector<C *> _returned[kSizeClassCount];
+        // 各等级缓存的内存总量
+        std::atomic<size_t> _retained_bytes[kSizeClassCount] {};
+    };
+
+    template <typename C>
+    struct FramePoolHolder {
+        typename FramePool<C>::Ptr pool = std::make_shared<FramePool<C> >();
+        // 线程退出时关闭对象池，尚未释放的帧对象持有对象池的引用，释放时直接删除
+        ~FramePoolHolder() { pool->close(); }
+    };
+
+    static size_t getClassCapacity(size_t index) { return index ? (size_t)512 << (2 * index) : 0; }
+
+    // 获取内存不小于capacity的等级
+    static size_t getObtainClass(size_t capacity) {
+        size_t index = 0;
+        while (index + 1 < kSizeClassCount && getClassCapacity(index) < capacity) {
+            ++index;
+        }
+        return index;
+    }
+
+    // 获取内存为capacity的帧对象回收到哪个等级
+    static size_t getRecycleClass(size_t capacity) {
+        size_t index = kSizeClassCount - 1;
+        while (index && getClassCapacity(index) > capacity) {
+            --index;
+        }
+        return index;
+    }
+
+    template <typename C>
+    static const typename FramePool<C>::Ptr &getPool() {
+        static thread_local FramePoolHolder<C> holder;
+        return holder.pool;
+    }
+
 private:
     //对象个数统计
     toolkit::ObjectStatistic<FrameImp> _statistic;
@@ -11,6 +11,7 @@
 #ifndef ZLMEDIAKIT_FMP4MEDIASOURCEMUXER_H
 #define ZLMEDIAKIT_FMP4MEDIASOURCEMUXER_H
 
+#include <atomic>
 #include "FMP4MediaSource.h"
 #include "Record/MP4Muxer.h"
 
@@ -43,6 +44,13 @@ public:
         return _media_src->readerCount();
     }
 
+    /**
+     * 媒体源是否已经注册，媒体源在第一次写入数据时注册
+     */
+    bool isRegisted() const {
+        return _media_src->getRing() && !_media_src->getInitSegment().empty();
+    }
+
     void onReaderChanged(MediaSource &sender, int size) override {
         _enabled = _option.fmp4_demand ? size : true;
         if (!size && _option.fmp4_demand) {
@@ -52,8 +60,7 @@ public:
     }
 
     bool inputFrame(const Frame::Ptr &frame) override {
-        if (_clear_cache && _option.fmp4_demand) {
-            _clear_cache = false;
+        if (_option.fmp4_demand && _clear_cache.exchange(false)) {
             _media_src->clearCache();
         }
         if (_enabled || !_option.fmp4_demand) {
@@ -64,7 +71,7 @@ public:
 
     bool isEnabled() {
         //缓存尚未清空时，还允许触发inputFrame函数，以便及时清空缓存
-        return _option.fmp4_demand ? (_clear_cache ? true : _enabled) : true;
+        return _option.fmp4_demand ? (_clear_cache || _enabled) : true;
     }
 
     void addTrackCompleted() override {
@@ -83,8 +90,9 @@ protected:
     }
 
 private:
-    bool _enabled = true;
-    bool _clear_cache = false;
+    // 按需复用开关，在归属线程(onReaderChanged)中修改，并行复用时在复用线程中读取
+    std::atomic<bool> _enabled { true };
+    std::atomic<bool> _clear_cache { false };
     ProtocolOption _option;
     FMP4MediaSource::Ptr _media_src;
 };
@@ -328,6 +328,28 @@ public:
     uint16_t _peer_port;
 };
 
+/**
+ * 获取用户唯一id(即url参数)
+ * LL-HLS的_HLS_msn/_HLS_part/_HLS_skip参数每次请求都不同，需要移除
+ */
+static string getUserUid(const Parser &parser) {
+    auto &params = parser.params();
+    if (params.find("_HLS_") == string::npos) {
+        return params;
+    }
+    string ret;
+    for (auto &item : split(params, "&")) {
+        if (item.empty() || start_with(item, "_HLS_")) {
+            continue;
+        }
+        if (!ret.empty()) {
+            ret += '&';
+        }
+        ret += item;
+    }
+    return ret;
+}
+
 /**
  * 判断http客户端是否有权限访问文件的逻辑步骤
  * 1、根据http请求头查找cookie，找到进入步骤3
@@ -339,7 +361,7 @@ public:
 static void canAccessPath(Session &sender, const Parser &parser, const MediaInfo &media_info, bool is_dir,
                           const function<void(const string &err_msg, const HttpServerCookie::Ptr &cookie)> &callback) {
     //获取用户唯一id
-    auto uid = parser.params();
+    auto uid = getUserUid(parser);
     auto path = parser.url();
 
     //先根据http头中的cookie字段获取cookie
@@ -367,7 +389,7 @@ static void canAccessPath(Session &sender, const Parser &parser, const MediaInfo
                 return;
             }
             //上次鉴权失败，但是如果url参数发生变更，那么也重新鉴权下
-            if (parser.params().empty() || parser.params() == cookie->getUid()) {
+            if (uid.empty() || uid == cookie->getUid()) {
                 //url参数未变，或者本来就没有url参数，那么判断本次请求为重复请求，无访问权限
                 callback(attach._err_msg, update_cookie ? cookie : nullptr);
                 return;
@@ -437,6 +459,34 @@ static void sendNotFound(const HttpFileManager::invoker &cb) {
     cb(404, "text/html", StrCaseMap(), std::make_shared<HttpStringBody>(notFound));
 }
 
+/**
+ * 回复只保存在内存中的文件，零拷贝，支持分节下载
+ */
+static void responseBuffer(const Parser &parser, StrCaseMap &httpHeader, const Buffer::Ptr &buffer, const HttpSession::HttpResponseInvoker &invoker) {
+    auto it = parser.getHeader().find("Range");
+    if (it == parser.getHeader().end() || it->second.empty()) {
+        invoker(200, httpHeader, buffer);
+        return;
+    }
+    //分节下载
+    auto &strRange = it->second;
+    auto size = (int64_t)buffer->size();
+    auto iRangeStart = atoll(findSubString(strRange.data(), "bytes=", "-").data());
+    auto iRangeEnd = atoll(findSubString(strRange.data(), "-", nullptr).data());
+    if (iRangeEnd == 0 || iRangeEnd >= size) {
+        iRangeEnd = size - 1;
+    }
+    if (iRangeStart < 0 || iRangeStart > iRangeEnd) {
+        //请求范围不合法
+        httpHeader.emplace("Content-Range", StrPrinter << "bytes */" << size << endl);
+        invoker(416, httpHeader, std::make_shared<HttpStringBody>(""));
+        return;
+    }
+    //分节下载返回Content-Range头
+    httpHeader.emplace("Content-Range", StrPrinter << "bytes " << iRangeStart << "-" << iRangeEnd << "/" << size << endl);
+    invoker(206, httpHeader, std::make_shared<BufferOffset<Buffer::Ptr> >(buffer, iRangeStart, iRangeEnd - iRangeStart + 1));
+}
+
 /**
  * 拼接文件路径
  */
@@ -457,8 +507,47 @@ static string pathCat(const string &a, const string &b){
  */
 static void accessFile(Session &sender, const Parser &parser, const MediaInfo &media_info, const string &file_path, const HttpFileManager::invoker &cb) {
     bool is_hls = end_with(file_path, kHlsSuffix) || end_with(file_path, kHlsFMP4Suffix);
-    if (!is_hls && !File::fileExist(file_path)) {
-        //文件不存在且不是hls,那么直接返回404
+    // 只保存在内存中的切片，只查找一次
+    auto mem_buffer = is_hls ? nullptr : HlsMemoryStore::Instance().get(file_path);
+    if (!is_hls && !mem_buffer && !File::fileExist(file_path)) {
+        GET_CONFIG(float, partDuration, Hls::kPartDuration);
+        if (partDuration > 0 && file_path.find(".part") != string::npos && (end_with(file_path, ".ts") || end_with(file_path, ".mp4"))) {
+            // LL-HLS预加载提示的part尚未生成，先鉴权再挂起请求直到其生成
+            weak_ptr<Session> weak_session = static_pointer_cast<Session>(sender.shared_from_this());
+            canAccessPath(sender, parser, media_info, false, [weak_session, parser, media_info, file_path, cb](const string &err_msg, const HttpServerCookie::Ptr &cookie) {
+                if (!err_msg.empty()) {
+                    StrCaseMap headerOut;
+                    if (cookie) {
+                        headerOut["Set-Cookie"] = cookie->getCookie(cookie->getAttach<HttpCookieAttachment>()._path);
+                    }
+                    cb(401, "text/html", headerOut, std::make_shared<HttpStringBody>(err_msg));
+                    return;
+                }
+                if (weak_session.expired()) {
+                    // http客户端已经断开，不需要挂起
+                    return;
+                }
+                GET_CONFIG(float, segDuration, Hls::kSegmentDuration);
+                HlsMemoryStore::Instance().getAsync(file_path, 3 * 1000 * segDuration, [weak_session, parser, media_info, file_path, cb](const Buffer::Ptr &buf) {
+                    if (!buf) {
+                        sendNotFound(cb);
+                        return;
+                    }
+                    auto strong_session = weak_session.lock();
+                    if (!strong_session) {
+                        return;
+                    }
+                    strong_session->async([weak_session, parser, media_info, file_path, cb]() {
+                        auto strong_session = weak_session.lock();
+                        if (strong_session) {
+                            accessFile(*strong_session, parser, media_info, file_path, cb);
+                        }
+                    });
+                });
+            });
+            return;
+        }
+        //文件不存在(内存中也不存在)且不是hls,那么直接返回404
         sendNotFound(cb);
         return;
     }
@@ -475,7 +564,7 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
 
     weak_ptr<Session> weakSession = static_pointer_cast<Session>(sender.shared_from_this());
     //判断是否有权限访问该文件
-    canAccessPath(sender, parser, media_info, false, [cb, file_path, parser, is_hls, media_info, weakSession](const string &err_msg, const HttpServerCookie::Ptr &cookie) {
+    canAccessPath(sender, parser, media_info, false, [cb, file_path, parser, is_hls, media_info, weakSession, mem_buffer](const string &err_msg, const HttpServerCookie::Ptr &cookie) {
         auto strongSession = weakSession.lock();
         if (!strongSession) {
             // http客户端已经断开，不需要回复
@@ -491,7 +580,8 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
             return;
         }
 
-        auto response_file = [is_hls](const HttpServerCookie::Ptr &cookie, const HttpFileManager::invoker &cb, const string &file_path, const Parser &parser, const string &file_content = "") {
+        auto response_file = [is_hls](const HttpServerCookie::Ptr &cookie, const HttpFileManager::invoker &cb, const string &file_path, const Parser &parser,
+                                      const string &file_content = "", const Buffer::Ptr &mem_buffer = nullptr) {
             StrCaseMap httpHeader;
             if (cookie) {
                 httpHeader["Set-Cookie"] = cookie->getCookie(cookie->getAttach<HttpCookieAttachment>()._path);
@@ -505,6 +595,14 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
                 }
                 cb(code, HttpFileManager::getContentType(file_path.data()), headerOut, body);
             };
+            if (file_content.empty()) {
+                auto buffer = mem_buffer ? mem_buffer : HlsMemoryStore::Instance().get(file_path);
+                if (buffer) {
+                    // 只保存在内存中的hls切片或m3u8，零拷贝回复
+                    responseBuffer(parser, httpHeader, buffer, invoker);
+                    return;
+                }
+            }
             GET_CONFIG_FUNC(vector<string>, forbidCacheSuffix, Http::kForbidCacheSuffix, [](const string &str) {
                 return split(str, ",");
             });
@@ -520,7 +618,7 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
 
         if (!is_hls || !cookie) {
             //不是hls或访问m3u8文件不带cookie, 直接回复文件或404
-            response_file(cookie, cb, file_path, parser);
+            response_file(cookie, cb, file_path, parser, "", mem_buffer);
             if (is_hls) {
                 WarnL << "access m3u8 file without cookie:" << file_path;
             }
@@ -530,6 +628,20 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
         auto &attach = cookie->getAttach<HttpCookieAttachment>();
         auto src = attach._hls_data->getMediaSource();
         if (src) {
+            auto &args = parser.getUrlArgs();
+            auto msn = args.find("_HLS_msn");
+            auto skip = args.find("_HLS_skip");
+            if (msn != args.end() || skip != args.end()) {
+                // LL-HLS阻塞式或增量m3u8请求
+                auto part = args.find("_HLS_part");
+                src->getIndexFile(msn == args.end() ? 0 : strtoull(msn->second.data(), nullptr, 10),
+                                  part == args.end() ? (msn == args.end() ? 0 : -1) : atoi(part->second.data()),
+                                  skip != args.end() && skip->second == "YES",
+                                  [response_file, cookie, cb, file_path, parser](const string &file) {
+                                      response_file(cookie, cb, file_path, parser, file);
+                                  });
+                return;
+            }
             // 直接从内存获取m3u8索引文件(而不是从文件系统)
             response_file(cookie, cb, file_path, parser, src->getIndexFile());
             return;
@@ -8,6 +8,7 @@
  * may be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <cmath>
 #include <iomanip>
 #include "HlsMaker.h"
 #include "Common/config.h"
@@ -25,8 +26,16 @@ HlsMaker::HlsMaker(bool is_fmp4, float seg_duration, uint32_t seg_number, bool s
 }
 
 void HlsMaker::makeIndexFile(bool include_delay, bool eof) {
-    GET_CONFIG(uint32_t, segDelay, Hls::kSegmentDelay);
-    GET_CONFIG(uint32_t, segRetain, Hls::kSegmentRetain);
+    if (!include_delay && isLowLatency()) {
+        // LL-HLS需要同时生成增量m3u8，并且告知当前生成到哪个part了
+        auto msn = _last_file_name.empty() ? _file_index : _file_index - 1;
+        onWriteLowLatencyHls(makeIndexString(false, eof, true), msn, _cur_parts.size());
+    }
+    onWriteHls(makeIndexString(include_delay, eof, false), include_delay);
+}
+
+std::string HlsMaker::makeIndexString(bool include_delay, bool eof, bool skip) {
+    GET_CONFIG(float, partDuration, Hls::kPartDuration);
     std::deque<std::tuple<int, std::string>> temp(_seg_dur_list);
     if (!include_delay && _seg_number) {
         while (temp.size() > _seg_number) {
@@ -40,50 +49,90 @@ void HlsMaker::makeIndexFile(bool include_delay, bool eof) {
             maxSegmentDuration = dur;
         }
     }
-    uint64_t index_seq;
+    uint64_t index_seq = 0;
     if (_seg_number) {
-        if (include_delay) {
-            if (_file_index > _seg_number + segDelay) {
-                index_seq = _file_index - _seg_number - segDelay;
-            } else {
-                index_seq = 0LL;
-            }
-        } else {
-            if (_file_index > _seg_number) {
-                index_seq = _file_index - _seg_number;
-            } else {
-                index_seq = 0LL;
-            }
+        // 按已完成的切片计算序号，part更新m3u8时正在生成的切片已经占用了_file_index，需要排除
+        uint64_t completed = _last_file_name.empty() ? _file_index : _file_index - 1;
+        if (completed > temp.size()) {
+            index_seq = completed - temp.size();
         }
-    } else {
-        index_seq = 0LL;
+    }
+
+    bool low_latency = !include_delay && isLowLatency();
+    auto target_duration = (maxSegmentDuration + 999) / 1000;
+    if (low_latency && target_duration < _seg_duration) {
+        // LL-HLS下m3u8可能还没有完整切片，但是客户端需要根据TARGETDURATION计算各种超时
+        target_duration = (int)std::ceil(_seg_duration);
     }
 
     string index_str;
     index_str.reserve(2048);
     index_str += "#EXTM3U\n";
-    index_str += (_is_fmp4 ? "#EXT-X-VERSION:7\n" : "#EXT-X-VERSION:4\n");
+    index_str += low_latency ? "#EXT-X-VERSION:9\n" : (_is_fmp4 ? "#EXT-X-VERSION:7\n" : "#EXT-X-VERSION:4\n");
     if (_seg_number == 0) {
         index_str += "#EXT-X-PLAYLIST-TYPE:EVENT\n";
     } else {
         index_str += "#EXT-X-ALLOW-CACHE:NO\n";
     }
-    index_str += "#EXT-X-TARGETDURATION:" + std::to_string((maxSegmentDuration + 999) / 1000) + "\n";
-    index_str += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(index_seq) + "\n";
+    index_str += "#EXT-X-TARGETDURATION:" + std::to_string(target_duration) + "\n";
+
+    stringstream ss;
+    if (low_latency) {
+        ss << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" << std::setprecision(3) << 3 * partDuration
+           << ",CAN-SKIP-UNTIL=" << 6 * target_duration << "\n";
+        ss << "#EXT-X-PART-INF:PART-TARGET=" << std::setprecision(3) << partDuration << "\n";
+    }
+    ss << "#EXT-X-MEDIA-SEQUENCE:" << index_seq << "\n";
     if (_is_fmp4) {
-        index_str += "#EXT-X-MAP:URI=\"init.mp4\"\n";
+        ss << "#EXT-X-MAP:URI=\"init.mp4\"\n";
     }
 
-    stringstream ss;
+    size_t skipped = 0;
+    if (skip && low_latency) {
+        // 跳过开始时间早于CAN-SKIP-UNTIL的切片
+        int64_t remain = 0;
+        for (auto &tp : temp) {
+            remain += std::get<0>(tp);
+        }
+        while (!temp.empty() && remain > 6 * 1000 * target_duration) {
+            remain -= std::get<0>(temp.front());
+            temp.pop_front();
+            ++skipped;
+        }
+        if (skipped) {
+            ss << "#EXT-X-SKIP:SKIPPED-SEGMENTS=" << skipped << "\n";
+        }
+    }
+
+    auto dump_parts = [&](const std::vector<HlsPart> &parts) {
+        for (auto &part : parts) {
+            ss << "#EXT-X-PART:DURATION=" << std::setprecision(3) << part.duration / 1000.0 << ",URI=\"" << part.uri << "\""
+               << (part.independent ? ",INDEPENDENT=YES" : "") << "\n";
+        }
+    };
+
+    size_t i = 0;
     for (auto &tp : temp) {
+        if (low_latency && ++i == temp.size()) {
+            // 只有最近一个完整切片需要列出其part
+            dump_parts(_last_seg_parts);
+        }
         ss << "#EXTINF:" << std::setprecision(3) << std::get<0>(tp) / 1000.0 << ",\n" << std::get<1>(tp) << "\n";
     }
+
+    if (low_latency && !eof) {
+        // 正在生成的切片的part以及下一个part的预加载提示
+        dump_parts(_cur_parts);
+        if (!_last_part_name.empty()) {
+            ss << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << _last_part_name << "\"\n";
+        }
+    }
     index_str += ss.str();
 
     if (eof) {
         index_str += "#EXT-X-ENDLIST\n";
     }
-    onWriteHls(index_str, include_delay);
+    return index_str;
 }
 
 void HlsMaker::inputInitSegment(const char *data, size_t len) {
@@ -105,6 +154,10 @@ void HlsMaker::inputData(const char *data, size_t len, uint64_t timestamp, bool
             addNewSegment(timestamp);
         }
         if (!_last_file_name.empty()) {
+            if (isLowLatency()) {
+                // LL-HLS按需切分part
+                addNewPart(timestamp, is_idr_fast_packet);
+            }
             // 存在切片才写入ts数据
             onWriteSegment(data, len);
             _last_timestamp = timestamp;
@@ -156,6 +209,10 @@ void HlsMaker::flushLastSegment(bool eof){
         //不存在上个切片
         return;
     }
+    // 关闭切片的最后一个part
+    flushLastPart(_last_timestamp);
+    _last_seg_parts = std::move(_cur_parts);
+    _cur_parts.clear();
     //文件创建到最后一次数据写入的时间即为切片长度
     auto seg_dur = _last_timestamp - _last_seg_timestamp;
     if (seg_dur <= 0) {
@@ -185,12 +242,52 @@ bool HlsMaker::isFmp4() const {
     return _is_fmp4;
 }
 
+bool HlsMaker::isLowLatency() const {
+    GET_CONFIG(float, partDuration, Hls::kPartDuration);
+    return partDuration > 0 && isLive();
+}
+
+void HlsMaker::addNewPart(uint64_t timestamp, bool independent) {
+    GET_CONFIG(float, partDuration, Hls::kPartDuration);
+    bool flushed = false;
+    if (!_last_part_name.empty()) {
+        // 预估下一次写入数据的时间戳，确保part时长不超过PART-TARGET
+        auto gap = timestamp > _last_timestamp ? timestamp - _last_timestamp : 0;
+        if (timestamp <= _last_part_timestamp || timestamp + gap - _last_part_timestamp <= partDuration * 1000) {
+            return;
+        }
+        flushLastPart(timestamp);
+        flushed = true;
+    }
+    _part_independent = independent;
+    _last_part_timestamp = timestamp;
+    _last_part_name = onOpenPart(_cur_parts.size());
+    if (flushed) {
+        // 生成part后更新m3u8(此时已包含下一个part的预加载提示)，以便唤醒阻塞的m3u8请求
+        makeIndexFile(false);
+    }
+}
+
+void HlsMaker::flushLastPart(uint64_t timestamp) {
+    if (_last_part_name.empty()) {
+        return;
+    }
+    int duration = timestamp > _last_part_timestamp ? timestamp - _last_part_timestamp : 1;
+    _cur_parts.emplace_back(HlsPart { duration, std::move(_last_part_name), _part_independent });
+    _last_part_name.clear();
+    onFlushPart();
+}
+
 void HlsMaker::clear() {
     _file_index = 0;
     _last_timestamp = 0;
     _last_seg_timestamp = 0;
     _seg_dur_list.clear();
     _last_file_name.clear();
+    _last_part_timestamp = 0;
+    _last_part_name.clear();
+    _cur_parts.clear();
+    _last_seg_parts.clear();
 }
 
 }//namespace mediakit
@@ -14,6 +14,7 @@
 #include <string>
 #include <deque>
 #include <tuple>
+#include <vector>
 #include <cstdint>
 
 namespace mediakit {
@@ -60,6 +61,11 @@ public:
      */
     bool isFmp4() const;
 
+    /**
+     * 是否开启了LL-HLS(hls.partDur大于0且为直播)
+     */
+    bool isLowLatency() const;
+
     /**
      * 清空记录
      */
@@ -104,6 +110,26 @@ protected:
      */
     virtual void onFlushLastSegment(uint64_t duration_ms) {};
 
+    /**
+     * 开始生成LL-HLS part回调，之后onWriteSegment写入的数据同时属于该part
+     * @param index part在当前切片中的序号
+     * @return part的url
+     */
+    virtual std::string onOpenPart(uint32_t index) { return ""; }
+
+    /**
+     * 当前LL-HLS part写入完毕回调
+     */
+    virtual void onFlushPart() {}
+
+    /**
+     * LL-HLS状态更新回调，每次生成m3u8前触发
+     * @param delta 跳过旧切片的增量m3u8(对应_HLS_skip=YES请求)
+     * @param msn 正在生成的切片的序号(media sequence number)
+     * @param parts 该切片已经生成完毕的part个数
+     */
+    virtual void onWriteLowLatencyHls(const std::string &delta, uint64_t msn, uint32_t parts) {}
+
     /**
      * 关闭上个ts切片并且写入m3u8索引
      * @param eof HLS直播是否已结束
@@ -117,6 +143,25 @@ private:
      */
     void makeIndexFile(bool include_delay, bool eof = false);
 
+    /**
+     * 生成m3u8文件内容
+     * @param skip 是否跳过旧切片(LL-HLS增量m3u8)
+     */
+    std::string makeIndexString(bool include_delay, bool eof, bool skip);
+
+    /**
+     * 按需切分LL-HLS part
+     * @param timestamp 本次写入数据的时间戳
+     * @param independent 本次写入的数据是否以关键帧开始
+     */
+    void addNewPart(uint64_t timestamp, bool independent);
+
+    /**
+     * 关闭当前LL-HLS part
+     * @param timestamp part结束时间戳
+     */
+    void flushLastPart(uint64_t timestamp);
+
     /**
      * 删除旧的ts切片
      */
@@ -138,6 +183,22 @@ private:
     uint64_t _file_index = 0;
     std::string _last_file_name;
     std::deque<std::tuple<int,std::string> > _seg_dur_list;
+
+    struct HlsPart {
+        int duration;
+        std::string uri;
+        bool independent;
+    };
+    // 当前part的起始时间戳
+    uint64_t _last_part_timestamp = 0;
+    // 当前part是否以关键帧开始
+    bool _part_independent = false;
+    // 当前正在写入的part的url，为空表示没有正在写入的part
+    std::string _last_part_name;
+    // 当前切片已经生成完毕的part
+    std::vector<HlsPart> _cur_parts;
+    // 上一个切片的part
+    std::vector<HlsPart> _last_seg_parts;
 };
 
 }//namespace mediakit
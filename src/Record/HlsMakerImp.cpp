@@ -12,7 +12,6 @@
 #include <sys/stat.h>
 #include "HlsMakerImp.h"
 #include "Util/util.h"
-#include "Util/uv_errno.h"
 #include "Util/File.h"
 #include "Common/config.h"
 
@@ -37,8 +36,11 @@ HlsMakerImp::HlsMakerImp(bool is_fmp4, const string &m3u8_file, const string &pa
     _path_hls_delay = getDelayPath(m3u8_file);
     _params = params;
     _buf_size = bufSize;
-    _file_buf.reset(new char[bufSize], [](char *ptr) { delete[] ptr; });
     _info.folder = _path_prefix;
+
+    GET_CONFIG(bool, in_memory, Hls::kSegmentInMemory);
+    // 只有直播且不保留切片时才能只保存在内存中
+    _in_memory = in_memory && isLive() && !isKeep();
 }
 
 HlsMakerImp::~HlsMakerImp() {
@@ -56,6 +58,7 @@ void HlsMakerImp::clearCache() {
 
 static void clearHls(const std::list<std::string> &files) {
     for (auto &file : files) {
+        HlsMemoryStore::Instance().del(file);
         File::delete_file(file);
     }
     File::deleteEmptyDir(File::parentDir(files.back()));
@@ -78,22 +81,35 @@ void HlsMakerImp::clearCache(bool immediately, bool eof) {
         for (auto &pr : _segment_file_paths) {
             lst.emplace_back(std::move(pr.second));
         }
+        for (auto &pr : _segment_part_paths) {
+            for (auto &part : pr.second) {
+                lst.emplace_back(std::move(part));
+            }
+        }
 
-        // hls直播才删除文件
+        // hls直播才删除文件，在录制io线程中删除，确保文件已经写盘完毕
         GET_CONFIG(uint32_t, delay, Hls::kDeleteDelaySec);
+        auto group = _path_prefix;
         if (!delay || immediately) {
-            clearHls(lst);
+            RecordIO::Instance().async(group, [lst]() { clearHls(lst); });
         } else {
-            _poller->doDelayTask(delay * 1000, [lst]() {
-                clearHls(lst);
+            _poller->doDelayTask(delay * 1000, [lst, group]() {
+                RecordIO::Instance().async(group, [lst]() { clearHls(lst); });
                 return 0;
             });
         }
     }
 
     clear();
-    _file = nullptr;
+    if (_file) {
+        _file->close();
+        _file = nullptr;
+    }
+    _segment_data.clear();
     _segment_file_paths.clear();
+    _part_path.clear();
+    _part_data.clear();
+    _segment_part_paths.clear();
 }
 
 string HlsMakerImp::onOpenSegment(uint64_t index) {
@@ -107,8 +123,13 @@ string HlsMakerImp::onOpenSegment(uint64_t index) {
         if (isLive()) {
             _segment_file_paths.emplace(index, segment_path);
         }
+        _segment_index = index;
+    }
+    if (_in_memory) {
+        _segment_data.clear();
+    } else {
+        _file = makeFile(segment_path);
     }
-    _file = makeFile(segment_path, true);
 
     // 保存本切片的元数据
     _info.start_time = ::time(NULL);
@@ -116,9 +137,6 @@ string HlsMakerImp::onOpenSegment(uint64_t index) {
     _info.file_path = segment_path;
     _info.url = _info.app + "/" + _info.stream + "/" + segment_name;
 
-    if (!_file) {
-        WarnL << "Create file failed," << segment_path << " " << get_uv_errmsg();
-    }
     if (_params.empty()) {
         return segment_name;
     }
@@ -126,30 +144,48 @@ string HlsMakerImp::onOpenSegment(uint64_t index) {
 }
 
 void HlsMakerImp::onDelSegment(uint64_t index) {
+    auto parts = _segment_part_paths.find(index);
+    if (parts != _segment_part_paths.end()) {
+        for (auto &part : parts->second) {
+            HlsMemoryStore::Instance().del(part);
+        }
+        _segment_part_paths.erase(parts);
+    }
     auto it = _segment_file_paths.find(index);
     if (it == _segment_file_paths.end()) {
         return;
     }
-    File::delete_file(it->second.data(), true);
+    if (_in_memory) {
+        HlsMemoryStore::Instance().del(it->second);
+    } else {
+        // 在录制io线程中删除，确保切片已经写盘完毕
+        auto path = it->second;
+        RecordIO::Instance().async(_path_prefix, [path]() { File::delete_file(path.data(), true); });
+    }
     _segment_file_paths.erase(it);
 }
 
 void HlsMakerImp::onWriteInitSegment(const char *data, size_t len) {
     string init_seg_path = _path_prefix + "/init.mp4";
-    _file = makeFile(init_seg_path);
-
-    if (_file) {
-        fwrite(data, len, 1, _file.get());
+    if (_in_memory) {
+        HlsMemoryStore::Instance().set(init_seg_path, std::make_shared<BufferString>(string(data, len)));
         _path_init = std::move(init_seg_path);
-        _file = nullptr;
-    } else {
-        WarnL << "Create file failed," << init_seg_path << " " << get_uv_errmsg();
+        return;
     }
+    auto file = makeFile(init_seg_path);
+    file->write(data, len);
+    file->close();
+    _path_init = std::move(init_seg_path);
 }
 
 void HlsMakerImp::onWriteSegment(const char *data, size_t len) {
-    if (_file) {
-        fwrite(data, len, 1, _file.get());
+    if (_in_memory) {
+        _segment_data.append(data, len);
+    } else if (_file) {
+        _file->write(data, len);
+    }
+    if (!_part_path.empty()) {
+        _part_data.append(data, len);
     }
     if (_media_src) {
         _media_src->onSegmentSize(len);
@@ -158,41 +194,103 @@ void HlsMakerImp::onWriteSegment(const char *data, size_t len) {
 
 void HlsMakerImp::onWriteHls(const std::string &data, bool include_delay) {
     auto path = include_delay ? _path_hls_delay : _path_hls;
-    auto hls = makeFile(path);
-    if (hls) {
-        fwrite(data.data(), data.size(), 1, hls.get());
-        hls.reset();
+    if (_in_memory) {
+        HlsMemoryStore::Instance().set(path, std::make_shared<BufferString>(data));
         if (_media_src && !include_delay) {
             _media_src->setIndexFile(data);
         }
-    } else {
-        WarnL << "Create hls file failed," << path << " " << get_uv_errmsg();
+        return;
     }
+    auto hls = makeFile(path);
+    hls->write(data.data(), data.size());
+    hls->close();
+    if (!_media_src || include_delay) {
+        return;
+    }
+    // m3u8及其引用的切片写盘完毕后再更新索引，防止播放器访问到未写完的切片
+    weak_ptr<HlsMediaSource> weak_src = _media_src;
+    auto poller = _poller;
+    RecordIO::Instance().async(_path_prefix, [weak_src, poller, data]() {
+        poller->async([weak_src, data]() {
+            if (auto src = weak_src.lock()) {
+                src->setIndexFile(data);
+            }
+        }, false);
+    });
 }
 
 void HlsMakerImp::onFlushLastSegment(uint64_t duration_ms) {
-    // 关闭并flush文件到磁盘
-    _file = nullptr;
-
     GET_CONFIG(bool, broadcastRecordTs, Hls::kBroadcastRecordTs);
-    if (broadcastRecordTs) {
-        _info.time_len = duration_ms / 1000.0f;
-        _info.file_size = File::fileSize(_info.file_path.data());
-        NOTICE_EMIT(BroadcastRecordTsArgs, Broadcast::kBroadcastRecordTs, _info);
+    if (_in_memory) {
+        // 切片完成后再发布到内存仓库，防止访问到未写完的切片
+        auto segment = std::make_shared<BufferString>(std::move(_segment_data));
+        _segment_data = string();
+        HlsMemoryStore::Instance().set(_info.file_path, segment);
+        if (!broadcastRecordTs) {
+            return;
+        }
+        // 需要录制通知时，一次性写入磁盘，写盘完毕后再触发切片生成事件
+        auto info = _info;
+        info.time_len = duration_ms / 1000.0f;
+        auto poller = _poller;
+        auto file = makeFile(_info.file_path);
+        file->write(segment->data(), segment->size());
+        file->close([info, poller](bool ok, uint64_t file_size) mutable {
+            if (!ok) {
+                return;
+            }
+            info.file_size = file_size;
+            poller->async([info]() { NOTICE_EMIT(BroadcastRecordTsArgs, Broadcast::kBroadcastRecordTs, info); }, false);
+        });
+        return;
     }
-}
 
-std::shared_ptr<FILE> HlsMakerImp::makeFile(const string &file, bool setbuf) {
-    auto file_buf = _file_buf;
-    auto ret = shared_ptr<FILE>(File::create_file(file.data(), "wb"), [file_buf](FILE *fp) {
-        if (fp) {
-            fclose(fp);
+    if (!_file) {
+        return;
+    }
+    // 关闭文件，写盘完毕后再触发切片生成事件
+    auto info = _info;
+    info.time_len = duration_ms / 1000.0f;
+    auto poller = _poller;
+    _file->close([info, poller, broadcastRecordTs](bool ok, uint64_t file_size) mutable {
+        if (!ok || !broadcastRecordTs) {
+            return;
         }
+        info.file_size = file_size;
+        poller->async([info]() { NOTICE_EMIT(BroadcastRecordTsArgs, Broadcast::kBroadcastRecordTs, info); }, false);
     });
-    if (ret && setbuf) {
-        setvbuf(ret.get(), _file_buf.get(), _IOFBF, _buf_size);
+    _file = nullptr;
+}
+
+string HlsMakerImp::onOpenPart(uint32_t index) {
+    // part命名规则: 切片名去掉后缀 + .part序号 + 后缀，例如 30-05_12.part3.ts
+    string ext = isFmp4() ? ".mp4" : ".ts";
+    auto part_name = _info.file_name.substr(0, _info.file_name.size() - ext.size()) + ".part" + to_string(index) + ext;
+    _part_path = _path_prefix + "/" + part_name;
+    _part_data.clear();
+    if (_params.empty()) {
+        return part_name;
+    }
+    return part_name + "?" + _params;
+}
+
+void HlsMakerImp::onFlushPart() {
+    // part很小且生命周期很短，只保存在内存中
+    HlsMemoryStore::Instance().set(_part_path, std::make_shared<BufferString>(std::move(_part_data)));
+    _segment_part_paths[_segment_index].emplace_back(std::move(_part_path));
+    _part_path.clear();
+    _part_data = string();
+}
+
+void HlsMakerImp::onWriteLowLatencyHls(const std::string &delta, uint64_t msn, uint32_t parts) {
+    if (_media_src) {
+        _media_src->setLowLatencyState(delta, msn, parts);
     }
-    return ret;
+}
+
+RecordFile::Ptr HlsMakerImp::makeFile(const string &file) {
+    // 同一个流的切片与m3u8在同一个录制io线程中按顺序写盘
+    return RecordFile::create(file, _path_prefix, _buf_size);
 }
 
 void HlsMakerImp::setMediaSource(const MediaTuple& tuple) {
@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include "HlsMaker.h"
 #include "HlsMediaSource.h"
+#include "RecordIO.h"
 
 namespace mediakit {
 
@@ -48,12 +49,17 @@ protected:
     void onWriteSegment(const char *data, size_t len) override;
     void onWriteHls(const std::string &data, bool include_delay) override;
     void onFlushLastSegment(uint64_t duration_ms) override;
+    std::string onOpenPart(uint32_t index) override;
+    void onFlushPart() override;
+    void onWriteLowLatencyHls(const std::string &delta, uint64_t msn, uint32_t parts) override;
 
 private:
-    std::shared_ptr<FILE> makeFile(const std::string &file,bool setbuf = false);
+    RecordFile::Ptr makeFile(const std::string &file);
     void clearCache(bool immediately, bool eof);
 
 private:
+    // 切片与m3u8是否只保存在内存中
+    bool _in_memory = false;
     int _buf_size;
     std::string _params;
     std::string _path_hls;
@@ -61,8 +67,15 @@ private:
     std::string _path_init;
     std::string _path_prefix;
     RecordInfo _info;
-    std::shared_ptr<FILE> _file;
-    std::shared_ptr<char> _file_buf;
+    RecordFile::Ptr _file;
+    // 内存模式下当前切片的数据
+    std::string _segment_data;
+    // 当前切片序号
+    uint64_t _segment_index = 0;
+    // 当前LL-HLS part的路径与数据
+    std::string _part_path;
+    std::string _part_data;
+    std::map<uint64_t/*index*/, std::vector<std::string>/*part_paths*/> _segment_part_paths;
     HlsMediaSource::Ptr _media_src;
     toolkit::EventPoller::Ptr _poller;
     std::map<uint64_t/*index*/,std::string/*file_path*/> _segment_file_paths;
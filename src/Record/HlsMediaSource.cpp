@@ -75,6 +75,19 @@ HlsMediaSource::Ptr HlsCookieData::getMediaSource() const {
     return _src.lock();
 }
 
+HlsMediaSource::~HlsMediaSource() {
+    // 流注销时回复所有挂起的LL-HLS阻塞请求，避免其等待超时
+    decltype(_block_requests) block_requests;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_index);
+        block_requests.swap(_block_requests);
+    }
+    // 在锁外回复，防止回调中再次访问本对象引起死锁
+    for (auto &pr : block_requests) {
+        pr.second.cb(pr.second.skip && !_delta_file.empty() ? _delta_file : _index_file);
+    }
+}
+
 void HlsMediaSource::setIndexFile(std::string index_file)
 {
     if (!_ring) {
@@ -98,6 +111,60 @@ void HlsMediaSource::setIndexFile(std::string index_file)
         _list_cb.for_each([&](const std::function<void(const std::string& str)>& cb) { cb(_index_file); });
         _list_cb.clear();
     }
+
+    // 唤醒已经就绪的LL-HLS阻塞请求
+    for (auto it = _block_requests.begin(); it != _block_requests.end();) {
+        if (_index_file.empty() || !isPartReady(it->second.msn, it->second.part)) {
+            ++it;
+            continue;
+        }
+        it->second.cb(it->second.skip && !_delta_file.empty() ? _delta_file : _index_file);
+        it = _block_requests.erase(it);
+    }
+}
+
+void HlsMediaSource::setLowLatencyState(std::string delta, uint64_t msn, uint32_t parts) {
+    std::lock_guard<std::mutex> lck(_mtx_index);
+    _delta_file = std::move(delta);
+    _msn = msn;
+    _parts = parts;
+}
+
+bool HlsMediaSource::isPartReady(uint64_t msn, int part) const {
+    if (part < 0) {
+        // 未指定part时，要求该切片已经完整生成
+        return msn < _msn;
+    }
+    return msn < _msn || (msn == _msn && (uint32_t)part < _parts);
+}
+
+void HlsMediaSource::getIndexFile(uint64_t msn, int part, bool skip, std::function<void(const std::string &str)> cb) {
+    std::lock_guard<std::mutex> lck(_mtx_index);
+    // 请求的切片超前太多时不挂起，直接回复
+    if (!_index_file.empty() && (isPartReady(msn, part) || msn > _msn + 2)) {
+        cb(skip && !_delta_file.empty() ? _delta_file : _index_file);
+        return;
+    }
+    auto id = _block_id++;
+    _block_requests.emplace(id, BlockRequest { msn, part, skip, std::move(cb) });
+
+    GET_CONFIG(float, segDuration, Hls::kSegmentDuration);
+    // 超时时间为3倍切片时长
+    std::weak_ptr<HlsMediaSource> weak_self = std::static_pointer_cast<HlsMediaSource>(shared_from_this());
+    EventPollerPool::Instance().getPoller()->doDelayTask(3 * 1000 * segDuration, [weak_self, id]() {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lck(strong_self->_mtx_index);
+        auto it = strong_self->_block_requests.find(id);
+        if (it != strong_self->_block_requests.end()) {
+            auto &req = it->second;
+            req.cb(req.skip && !strong_self->_delta_file.empty() ? strong_self->_delta_file : strong_self->_index_file);
+            strong_self->_block_requests.erase(it);
+        }
+        return 0;
+    });
 }
 
 void HlsMediaSource::getIndexFile(std::function<void(const std::string& str)> cb)
@@ -111,4 +178,72 @@ void HlsMediaSource::getIndexFile(std::function<void(const std::string& str)> cb
     _list_cb.emplace_back(std::move(cb));
 }
 
+INSTANCE_IMP(HlsMemoryStore)
+
+void HlsMemoryStore::set(const std::string &path, Buffer::Ptr data) {
+    std::list<std::function<void(const Buffer::Ptr &)>> waiters;
+    {
+        std::lock_guard<std::mutex> lck(_mtx);
+        _files[path] = data;
+        auto range = _waiters.equal_range(path);
+        for (auto it = range.first; it != range.second; ++it) {
+            waiters.emplace_back(std::move(it->second.second));
+        }
+        _waiters.erase(range.first, range.second);
+    }
+    for (auto &cb : waiters) {
+        cb(data);
+    }
+}
+
+void HlsMemoryStore::getAsync(const std::string &path, uint64_t timeout_ms, std::function<void(const Buffer::Ptr &)> cb) {
+    Buffer::Ptr data;
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lck(_mtx);
+        auto it = _files.find(path);
+        if (it != _files.end()) {
+            data = it->second;
+        } else {
+            id = ++_waiter_id;
+            _waiters.emplace(path, std::make_pair(id, std::move(cb)));
+        }
+    }
+    if (data) {
+        // 文件已经存在，在锁外回调
+        cb(data);
+        return;
+    }
+    EventPollerPool::Instance().getPoller()->doDelayTask(timeout_ms, [this, path, id]() {
+        std::function<void(const Buffer::Ptr &)> cb;
+        {
+            std::lock_guard<std::mutex> lck(_mtx);
+            auto range = _waiters.equal_range(path);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second.first == id) {
+                    cb = std::move(it->second.second);
+                    _waiters.erase(it);
+                    break;
+                }
+            }
+        }
+        if (cb) {
+            // 等待超时
+            cb(nullptr);
+        }
+        return 0;
+    });
+}
+
+Buffer::Ptr HlsMemoryStore::get(const std::string &path) const {
+    std::lock_guard<std::mutex> lck(_mtx);
+    auto it = _files.find(path);
+    return it == _files.end() ? nullptr : it->second;
+}
+
+void HlsMemoryStore::del(const std::string &path) {
+    std::lock_guard<std::mutex> lck(_mtx);
+    _files.erase(path);
+}
+
 } // namespace mediakit
@@ -15,6 +15,7 @@
 #include "Util/TimeTicker.h"
 #include "Util/RingBuffer.h"
 #include <atomic>
+#include <unordered_map>
 
 namespace mediakit {
 
@@ -26,6 +27,7 @@ public:
     using Ptr = std::shared_ptr<HlsMediaSource>;
 
     HlsMediaSource(const std::string &schema, const MediaTuple &tuple) : MediaSource(schema, tuple) {}
+    ~HlsMediaSource() override;
 
     /**
      * 	获取媒体源的环形缓冲
@@ -55,6 +57,24 @@ public:
         return _index_file;
     }
 
+    /**
+     * 更新LL-HLS状态，需在setIndexFile之前调用
+     * @param delta 跳过旧切片的增量m3u8
+     * @param msn 正在生成的切片的序号
+     * @param parts 该切片已经生成完毕的part个数
+     */
+    void setLowLatencyState(std::string delta, uint64_t msn, uint32_t parts);
+
+    /**
+     * 异步获取LL-HLS m3u8文件(blocking playlist reload)
+     * 在指定的切片或part生成前会挂起请求，超时后回复当前m3u8
+     * @param msn _HLS_msn参数
+     * @param part _HLS_part参数，小于0表示未指定
+     * @param skip 是否请求增量m3u8(_HLS_skip=YES)
+     * @param cb 回调
+     */
+    void getIndexFile(uint64_t msn, int part, bool skip, std::function<void(const std::string &str)> cb);
+
     void onSegmentSize(size_t bytes) { _speed[TrackVideo] += bytes; }
 
     void getPlayerList(const std::function<void(const std::list<toolkit::Any> &info_list)> &cb,
@@ -62,11 +82,71 @@ public:
         _ring->getInfoList(cb, on_change);
     }
 
+private:
+    // 判断LL-HLS阻塞请求的切片或part是否已经生成
+    bool isPartReady(uint64_t msn, int part) const;
+
 private:
     RingType::Ptr _ring;
     std::string _index_file;
     mutable std::mutex _mtx_index;
     toolkit::List<std::function<void(const std::string &)>> _list_cb;
+
+    // LL-HLS相关
+    std::string _delta_file;
+    uint64_t _msn = 0;
+    uint32_t _parts = 0;
+    uint64_t _block_id = 0;
+    struct BlockRequest {
+        uint64_t msn;
+        int part;
+        bool skip;
+        std::function<void(const std::string &)> cb;
+    };
+    std::unordered_map<uint64_t/*id*/, BlockRequest> _block_requests;
+};
+
+/**
+ * hls内存切片仓库，按绝对路径保存直播hls的切片、init.mp4以及m3u8内容
+ * 开启hls.segInMemory后，直播hls不再写磁盘，http服务器直接从此处零拷贝回复
+ */
+class HlsMemoryStore {
+public:
+    static HlsMemoryStore &Instance();
+
+    /**
+     * 添加或覆盖文件
+     * @param path 文件绝对路径
+     * @param data 文件内容
+     */
+    void set(const std::string &path, toolkit::Buffer::Ptr data);
+
+    /**
+     * 获取文件内容，不存在时返回nullptr
+     */
+    toolkit::Buffer::Ptr get(const std::string &path) const;
+
+    /**
+     * 删除文件
+     */
+    void del(const std::string &path);
+
+    /**
+     * 异步获取文件内容，文件尚未生成时等待其生成(用于LL-HLS预加载提示的part)
+     * @param path 文件绝对路径
+     * @param timeout_ms 等待超时时间，超时回调nullptr
+     * @param cb 回调，可能在其他线程触发
+     */
+    void getAsync(const std::string &path, uint64_t timeout_ms, std::function<void(const toolkit::Buffer::Ptr &)> cb);
+
+private:
+    HlsMemoryStore() = default;
+
+private:
+    mutable std::mutex _mtx;
+    uint64_t _waiter_id = 0;
+    std::unordered_map<std::string, toolkit::Buffer::Ptr> _files;
+    std::unordered_multimap<std::string, std::pair<uint64_t, std::function<void(const toolkit::Buffer::Ptr &)>>> _waiters;
 };
 
 class HlsCookieData {
@@ -11,6 +11,7 @@
 #ifndef HLSRECORDER_H
 #define HLSRECORDER_H
 
+#include <atomic>
 #include "HlsMakerImp.h"
 #include "MPEG.h"
 #include "MP4Muxer.h"
@@ -44,6 +45,11 @@ public:
 
     int readerCount() { return _hls->getMediaSource()->readerCount(); }
 
+    /**
+     * 媒体源是否已经注册，媒体源在第一次生成m3u8索引时注册
+     */
+    bool isRegisted() const { return !!_hls->getMediaSource()->getRing(); }
+
     void onReaderChanged(MediaSource &sender, int size) override {
         // hls保留切片个数为0时代表为hls录制(不删除切片)，那么不管有无观看者都一直生成hls
         _enabled = _option.hls_demand ? (_hls->isLive() ? size : true) : true;
@@ -55,26 +61,31 @@ public:
     }
 
     bool inputFrame(const Frame::Ptr &frame) override {
-        if (_clear_cache && _option.hls_demand) {
-            _clear_cache = false;
+        return prepareInput() ? Muxer::inputFrame(frame) : false;
+    }
+
+    /**
+     * 使用共享复用器时，每帧调用一次以代替inputFrame
+     * @return 是否需要切片数据
+     */
+    bool prepareInput() {
+        if (_option.hls_demand && _clear_cache.exchange(false)) {
             //清空旧的m3u8索引文件于ts切片
             _hls->clearCache();
             _hls->getMediaSource()->setIndexFile("");
         }
-        if (_enabled || !_option.hls_demand) {
-            return Muxer::inputFrame(frame);
-        }
-        return false;
+        return _enabled || !_option.hls_demand;
     }
 
     bool isEnabled() {
         //缓存尚未清空时，还允许触发inputFrame函数，以便及时清空缓存
-        return _option.hls_demand ? (_clear_cache ? true : _enabled) : true;
+        return _option.hls_demand ? (_clear_cache || _enabled) : true;
     }
 
 protected:
-    bool _enabled = true;
-    bool _clear_cache = false;
+    // 按需复用开关，在归属线程(onReaderChanged)中修改，并行复用时在复用线程中读取
+    std::atomic<bool> _enabled { true };
+    std::atomic<bool> _clear_cache { false };
     ProtocolOption _option;
     std::shared_ptr<HlsMakerImp> _hls;
 };
@@ -92,6 +103,15 @@ public:
         }
     }
 
+    /**
+     * 输入共享ts复用器产生的ts数据
+     */
+    void inputTS(const toolkit::Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos) {
+        if (!buffer || _enabled || !_option.hls_demand) {
+            onWrite(buffer, timestamp, key_pos);
+        }
+    }
+
 private:
     void onWrite(std::shared_ptr<toolkit::Buffer> buffer, uint64_t timestamp, bool key_pos) override {
         if (!buffer) {
@@ -10,6 +10,7 @@
 
 #if defined(ENABLE_MP4)
 
+#include <cstring>
 #include "MP4.h"
 #include "Util/File.h"
 #include "Util/logger.h"
@@ -79,15 +80,25 @@ MP4FileIO::Reader MP4FileIO::createReader(){
     #define ftell64 ftell
 #endif
 
-void MP4FileDisk::openFile(const char *file, const char *mode) {
+MP4FileDisk::~MP4FileDisk() {
+    closeFile();
+}
+
+void MP4FileDisk::openFile(const char *file, const char *mode, const string &group) {
+    GET_CONFIG(uint32_t,mp4BufSize,Record::kFileBufSize);
+
+    if (strchr(mode, 'w')) {
+        //写文件在录制io线程中进行，避免阻塞poller线程
+        _record_file = RecordFile::create(file, group.empty() ? File::parentDir(file) : group, mp4BufSize);
+        return;
+    }
+
     //创建文件
     auto fp = File::create_file(file, mode);
     if(!fp){
         throw std::runtime_error(string("打开文件失败:") + file);
     }
 
-    GET_CONFIG(uint32_t,mp4BufSize,Record::kFileBufSize);
-
     //新建文件io缓存
     std::shared_ptr<char> file_buf(new char[mp4BufSize],[](char *ptr){
         if(ptr){
@@ -107,11 +118,19 @@ void MP4FileDisk::openFile(const char *file, const char *mode) {
     });
 }
 
-void MP4FileDisk::closeFile() {
+void MP4FileDisk::closeFile(const RecordFile::onClosed &cb) {
+    if (_record_file) {
+        _record_file->close(cb);
+        _record_file = nullptr;
+        return;
+    }
     _file = nullptr;
 }
 
 int MP4FileDisk::onRead(void *data, size_t bytes) {
+    if (_record_file) {
+        return _record_file->read(data, bytes);
+    }
     if (bytes == fread(data, 1, bytes, _file.get())){
         return 0;
     }
@@ -119,14 +138,24 @@ int MP4FileDisk::onRead(void *data, size_t bytes) {
 }
 
 int MP4FileDisk::onWrite(const void *data, size_t bytes) {
+    if (_record_file) {
+        return _record_file->write(data, bytes) ? 0 : -1;
+    }
     return bytes == fwrite(data, 1, bytes, _file.get()) ? 0 : ferror(_file.get());
 }
 
 int MP4FileDisk::onSeek(uint64_t offset) {
+    if (_record_file) {
+        _record_file->seek(offset);
+        return 0;
+    }
     return fseek64(_file.get(), offset, SEEK_SET);
 }
 
 uint64_t MP4FileDisk::onTell() {
+    if (_record_file) {
+        return _record_file->tell();
+    }
     return ftell64(_file.get());
 }
 
@@ -23,6 +23,7 @@
 #include "mpeg4-aac.h"
 #include "mov-buffer.h"
 #include "mov-format.h"
+#include "RecordIO.h"
 
 namespace mediakit {
 
@@ -83,17 +84,22 @@ class MP4FileDisk : public MP4FileIO {
 public:
     using Ptr = std::shared_ptr<MP4FileDisk>;
 
+    ~MP4FileDisk() override;
+
     /**
      * 打开磁盘文件
+     * 写文件时通过录制io线程异步写盘
      * @param file 文件路径
      * @param mode fopen的方式
+     * @param group 录制io分组，一般为流的录制目录
      */
-    void openFile(const char *file, const char *mode);
+    void openFile(const char *file, const char *mode, const std::string &group = "");
 
     /**
      * 关闭磁盘文件
+     * @param cb 写文件时，数据全部写盘并关闭文件后在录制io线程中回调
      */
-    void closeFile();
+    void closeFile(const RecordFile::onClosed &cb = nullptr);
 
 protected:
     uint64_t onTell() override;
@@ -103,6 +109,7 @@ protected:
 
 private:
     std::shared_ptr<FILE> _file;
+    RecordFile::Ptr _record_file;
 };
 
 class MP4FileMemory : public MP4FileIO{
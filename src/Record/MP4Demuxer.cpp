@@ -25,6 +25,21 @@ MP4Demuxer::~MP4Demuxer() {
 void MP4Demuxer::openMP4(const string &file) {
     closeMP4();
 
+    _index = MP4Index::get(file);
+    if (_index) {
+        _sample_reader = std::make_shared<MP4SampleReader>(_index, file);
+        for (auto &track : _index->getTracks()) {
+            if (track.video) {
+                onVideoTrack(track.track_id, track.object, track.width, track.height, track.extra.data(), track.extra.size());
+            } else {
+                onAudioTrack(track.track_id, track.object, track.channel_count, track.bit_per_sample, track.sample_rate, track.extra.data(), track.extra.size());
+            }
+        }
+        _duration_ms = _index->getDurationMS();
+        return;
+    }
+
+    // 分片mp4，使用mov_reader解复用
     _mp4_file = std::make_shared<MP4FileDisk>();
     _mp4_file->openFile(file.data(), "rb+");
     _mov_reader = _mp4_file->createReader();
@@ -33,6 +48,9 @@ void MP4Demuxer::openMP4(const string &file) {
 }
 
 void MP4Demuxer::closeMP4() {
+    _sample_reader.reset();
+    _index.reset();
+    _sample_pos = 0;
     _mov_reader.reset();
     _mp4_file.reset();
 }
@@ -81,6 +99,12 @@ void MP4Demuxer::onAudioTrack(uint32_t track, uint8_t object, int channel_count,
 }
 
 int64_t MP4Demuxer::seekTo(int64_t stamp_ms) {
+    if (_index) {
+        // 通过关键帧索引定位
+        _sample_pos = _index->seekTo(stamp_ms);
+        _sample_reader->reset(_sample_pos);
+        return stamp_ms;
+    }
     if(0 != mov_reader_seek(_mov_reader.get(),&stamp_ms)){
         return -1;
     }
@@ -101,6 +125,10 @@ Frame::Ptr MP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
     keyFrame = false;
     eof = false;
 
+    if (_index) {
+        return readIndexedFrame(keyFrame, eof);
+    }
+
     static mov_reader_onread2 mov_onalloc = [](void *param, uint32_t track_id, size_t bytes, int64_t pts, int64_t dts, int flags) -> void * {
         Context *ctx = (Context *) param;
         ctx->pts = pts;
@@ -135,6 +163,23 @@ Frame::Ptr MP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
     }
 }
 
+Frame::Ptr MP4Demuxer::readIndexedFrame(bool &keyFrame, bool &eof) {
+    auto &samples = _index->getSamples();
+    if (_sample_pos >= samples.size()) {
+        eof = true;
+        return nullptr;
+    }
+    auto index = _sample_pos++;
+    auto buf = _sample_reader->read(index);
+    if (!buf) {
+        eof = true;
+        return nullptr;
+    }
+    auto &sample = samples[index];
+    keyFrame = sample.key;
+    return makeFrame(sample.track_id, buf, sample.dts + sample.cts, sample.dts);
+}
+
 Frame::Ptr MP4Demuxer::makeFrame(uint32_t track_id, const Buffer::Ptr &buf, int64_t pts, int64_t dts) {
     auto it = _tracks.find(track_id);
     if (it == _tracks.end()) {
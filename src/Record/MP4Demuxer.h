@@ -12,6 +12,7 @@
 #define ZLMEDIAKIT_MP4DEMUXER_H
 #ifdef ENABLE_MP4
 #include "MP4.h"
+#include "MP4Index.h"
 #include "Extension/Track.h"
 #include "Util/ResourcePool.h"
 namespace mediakit {
@@ -66,10 +67,15 @@ private:
     void onVideoTrack(uint32_t track_id, uint8_t object, int width, int height, const void *extra, size_t bytes);
     void onAudioTrack(uint32_t track_id, uint8_t object, int channel_count, int bit_per_sample, int sample_rate, const void *extra, size_t bytes);
     Frame::Ptr makeFrame(uint32_t track_id, const toolkit::Buffer::Ptr &buf, int64_t pts, int64_t dts);
+    Frame::Ptr readIndexedFrame(bool &keyFrame, bool &eof);
 
 private:
     MP4FileDisk::Ptr _mp4_file;
     MP4FileDisk::Reader _mov_reader;
+    // 采样索引，非分片mp4按索引读取，不再使用mov_reader
+    size_t _sample_pos = 0;
+    MP4Index::Ptr _index;
+    MP4SampleReader::Ptr _sample_reader;
     uint64_t _duration_ms = 0;
     std::unordered_map<int, Track::Ptr> _tracks;
     toolkit::ResourcePool<toolkit::BufferRaw> _buffer_pool;
@@ -0,0 +1,625 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(_FILE_OFFSET_BITS)
+// 32位系统下off_t与stat也使用64位，以支持超过2GB的mp4文件
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#ifdef ENABLE_MP4
+#include <list>
+#include <functional>
+#include <algorithm>
+#include <unordered_map>
+#include <sys/stat.h>
+#include "MP4Index.h"
+#include "MP4.h"
+#include "Util/File.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Thread/ThreadPool.h"
+#include "Common/config.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #define fseek64 _fseeki64
+#else
+    #define fseek64(fp, offset, whence) fseeko(fp, (off_t)(offset), whence)
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+static constexpr uint32_t boxType(const char *type) {
+    return ((uint32_t)(uint8_t)type[0] << 24) | ((uint32_t)(uint8_t)type[1] << 16) | ((uint32_t)(uint8_t)type[2] << 8) | (uint32_t)(uint8_t)type[3];
+}
+
+static inline uint32_t readBE32(const uint8_t *ptr) {
+    return ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) | ((uint32_t)ptr[2] << 8) | (uint32_t)ptr[3];
+}
+
+static inline uint64_t readBE64(const uint8_t *ptr) {
+    return ((uint64_t)readBE32(ptr) << 32) | readBE32(ptr + 4);
+}
+
+// 遍历box的所有子box，box大小非法时返回false
+template <typename FUNC>
+static bool forEachBox(const uint8_t *data, size_t size, FUNC &&func) {
+    size_t offset = 0;
+    while (offset + 8 <= size) {
+        uint64_t box_size = readBE32(data + offset);
+        auto type = readBE32(data + offset + 4);
+        size_t header = 8;
+        if (box_size == 1) {
+            if (offset + 16 > size) {
+                return false;
+            }
+            box_size = readBE64(data + offset + 8);
+            header = 16;
+        } else if (box_size == 0) {
+            // 直到父box结尾
+            box_size = size - offset;
+        }
+        if (box_size < header || box_size > size - offset) {
+            return false;
+        }
+        if (!func(type, data + offset + header, (size_t)box_size - header)) {
+            return false;
+        }
+        offset += (size_t)box_size;
+    }
+    return true;
+}
+
+// 读取文件顶层的moov box，分片mp4返回false
+static bool readMoov(FILE *fp, uint64_t file_size, string &moov) {
+    uint64_t offset = 0;
+    while (offset + 8 <= file_size) {
+        uint8_t header[16];
+        if (0 != fseek64(fp, offset, SEEK_SET) || 8 != fread(header, 1, 8, fp)) {
+            return false;
+        }
+        uint64_t box_size = readBE32(header);
+        auto type = readBE32(header + 4);
+        size_t header_size = 8;
+        if (box_size == 1) {
+            if (8 != fread(header + 8, 1, 8, fp)) {
+                return false;
+            }
+            box_size = readBE64(header + 8);
+            header_size = 16;
+        } else if (box_size == 0) {
+            box_size = file_size - offset;
+        }
+        if (box_size < header_size || box_size > file_size - offset) {
+            return false;
+        }
+        if (type == boxType("moof")) {
+            return false;
+        }
+        if (type == boxType("moov")) {
+            moov.resize((size_t)box_size - header_size);
+            return moov.size() == fread((char *)moov.data(), 1, moov.size(), fp);
+        }
+        offset += box_size;
+    }
+    return false;
+}
+
+struct Table {
+    const uint8_t *data;
+    size_t size;
+    // 采样表的版本、标记之后的条目数
+    uint32_t count(size_t entry_size, size_t header = 8) const {
+        if (size < header) {
+            return 0;
+        }
+        auto ret = readBE32(data + header - 4);
+        return (size - header) / entry_size < ret ? 0 : ret;
+    }
+};
+
+struct Trak {
+    uint32_t track_id = 0;
+    uint32_t timescale = 0;
+    int64_t delay_ms = 0;
+    Table stts {}, ctts {}, stss {}, stsz {}, stz2 {}, stsc {}, stco {}, co64 {};
+};
+
+static bool parseTrak(const uint8_t *data, size_t size, uint32_t movie_timescale, Trak &trak) {
+    function<bool(uint32_t, const uint8_t *, size_t)> on_box = [&](uint32_t type, const uint8_t *ptr, size_t bytes) -> bool {
+        switch (type) {
+            case boxType("mdia"):
+            case boxType("minf"):
+            case boxType("stbl"):
+            case boxType("edts"): return forEachBox(ptr, bytes, on_box);
+            case boxType("tkhd"): {
+                size_t pos = ptr[0] ? 20 : 12;
+                if (bytes >= pos + 4) {
+                    trak.track_id = readBE32(ptr + pos);
+                }
+                return true;
+            }
+            case boxType("mdhd"): {
+                size_t pos = ptr[0] ? 20 : 12;
+                if (bytes >= pos + 4) {
+                    trak.timescale = readBE32(ptr + pos);
+                }
+                return true;
+            }
+            case boxType("elst"): {
+                // 只处理开头的空白编辑(延时播放)，与mov_reader保持一致
+                bool v1 = bytes && ptr[0];
+                Table elst { ptr, bytes };
+                auto entry_size = v1 ? 20 : 12;
+                auto count = elst.count(entry_size);
+                for (uint32_t i = 0; i < count && movie_timescale; ++i) {
+                    auto entry = ptr + 8 + i * entry_size;
+                    uint64_t duration = v1 ? readBE64(entry) : readBE32(entry);
+                    int64_t media_time = v1 ? (int64_t)readBE64(entry + 8) : (int32_t)readBE32(entry + 4);
+                    if (media_time != -1) {
+                        break;
+                    }
+                    trak.delay_ms += duration * 1000 / movie_timescale;
+                }
+                return true;
+            }
+            case boxType("stts"): trak.stts = { ptr, bytes }; return true;
+            case boxType("ctts"): trak.ctts = { ptr, bytes }; return true;
+            case boxType("stss"): trak.stss = { ptr, bytes }; return true;
+            case boxType("stsz"): trak.stsz = { ptr, bytes }; return true;
+            case boxType("stz2"): trak.stz2 = { ptr, bytes }; return true;
+            case boxType("stsc"): trak.stsc = { ptr, bytes }; return true;
+            case boxType("stco"): trak.stco = { ptr, bytes }; return true;
+            case boxType("co64"): trak.co64 = { ptr, bytes }; return true;
+            default: return true;
+        }
+    };
+    return forEachBox(data, size, on_box);
+}
+
+// 根据采样表生成单个track的所有采样
+static bool buildSamples(const Trak &trak, vector<MP4Index::Sample> &out) {
+    if (!trak.timescale) {
+        return false;
+    }
+    // 采样大小
+    vector<uint32_t> sizes;
+    if (trak.stsz.size >= 12) {
+        auto sample_size = readBE32(trak.stsz.data + 4);
+        if (sample_size) {
+            sizes.assign(readBE32(trak.stsz.data + 8), sample_size);
+        } else {
+            auto count = trak.stsz.count(4, 12);
+            sizes.resize(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                sizes[i] = readBE32(trak.stsz.data + 12 + i * 4);
+            }
+        }
+    } else if (trak.stz2.size >= 12) {
+        auto field_size = trak.stz2.data[7];
+        auto count = readBE32(trak.stz2.data + 8);
+        if ((field_size != 4 && field_size != 8 && field_size != 16) || (uint64_t)count * field_size > (trak.stz2.size - 12) * 8) {
+            return false;
+        }
+        sizes.resize(count);
+        auto table = trak.stz2.data + 12;
+        for (uint32_t i = 0; i < count; ++i) {
+            switch (field_size) {
+                case 4: sizes[i] = (i & 1) ? (table[i / 2] & 0x0F) : (table[i / 2] >> 4); break;
+                case 8: sizes[i] = table[i]; break;
+                default: sizes[i] = (table[i * 2] << 8) | table[i * 2 + 1]; break;
+            }
+        }
+    } else {
+        return false;
+    }
+    if (sizes.empty()) {
+        return true;
+    }
+
+    auto begin = out.size();
+    auto sample_count = sizes.size();
+    out.resize(begin + sample_count);
+    auto samples = out.data() + begin;
+
+    // 采样在文件中的偏移量
+    bool co64 = trak.co64.size != 0;
+    auto &chunk_table = co64 ? trak.co64 : trak.stco;
+    auto chunk_count = chunk_table.count(co64 ? 8 : 4);
+    auto stsc_count = trak.stsc.count(12);
+    if (!chunk_count || !stsc_count) {
+        return false;
+    }
+    size_t sample = 0;
+    uint32_t stsc_index = 0;
+    for (uint32_t chunk = 0; chunk < chunk_count && sample < sample_count; ++chunk) {
+        // stsc中的first_chunk从1开始
+        while (stsc_index + 1 < stsc_count && chunk + 1 >= readBE32(trak.stsc.data + 8 + (stsc_index + 1) * 12)) {
+            ++stsc_index;
+        }
+        auto samples_per_chunk = readBE32(trak.stsc.data + 8 + stsc_index * 12 + 4);
+        uint64_t offset = co64 ? readBE64(chunk_table.data + 8 + chunk * 8) : readBE32(chunk_table.data + 8 + chunk * 4);
+        for (uint32_t i = 0; i < samples_per_chunk && sample < sample_count; ++i, ++sample) {
+            samples[sample].offset = offset;
+            samples[sample].size = sizes[sample];
+            samples[sample].track_id = trak.track_id;
+            samples[sample].key = trak.stss.size == 0;
+            offset += sizes[sample];
+        }
+    }
+    if (sample != sample_count) {
+        return false;
+    }
+
+    // 时间戳
+    vector<uint64_t> dts(sample_count);
+    sample = 0;
+    uint64_t time = 0;
+    auto stts_count = trak.stts.count(8);
+    for (uint32_t i = 0; i < stts_count && sample < sample_count; ++i) {
+        auto count = readBE32(trak.stts.data + 8 + i * 8);
+        auto delta = readBE32(trak.stts.data + 8 + i * 8 + 4);
+        for (uint32_t j = 0; j < count && sample < sample_count; ++j, ++sample) {
+            dts[sample] = time;
+            time += delta;
+        }
+    }
+    if (sample != sample_count) {
+        return false;
+    }
+
+    vector<int32_t> cts(sample_count, 0);
+    sample = 0;
+    auto ctts_count = trak.ctts.count(8);
+    for (uint32_t i = 0; i < ctts_count && sample < sample_count; ++i) {
+        auto count = readBE32(trak.ctts.data + 8 + i * 8);
+        // version 0的偏移量也按有符号处理，兼容大部分封装器
+        auto offset = (int32_t)readBE32(trak.ctts.data + 8 + i * 8 + 4);
+        for (uint32_t j = 0; j < count && sample < sample_count; ++j, ++sample) {
+            cts[sample] = offset;
+        }
+    }
+
+    for (size_t i = 0; i < sample_count; ++i) {
+        samples[i].dts = (int64_t)(dts[i] * 1000 / trak.timescale) + trak.delay_ms;
+        auto pts = ((int64_t)dts[i] + cts[i]) * 1000 / trak.timescale + trak.delay_ms;
+        samples[i].cts = (int32_t)(pts - samples[i].dts);
+    }
+
+    // 关键帧，stss中的序号从1开始
+    auto stss_count = trak.stss.count(4);
+    for (uint32_t i = 0; i < stss_count; ++i) {
+        auto index = readBE32(trak.stss.data + 8 + i * 4);
+        if (index && index <= sample_count) {
+            samples[index - 1].key = true;
+        }
+    }
+    return true;
+}
+
+bool MP4Index::load(const string &file, uint64_t file_size) {
+    string moov;
+    {
+        std::shared_ptr<FILE> fp(File::create_file(file.data(), "rb"), [](FILE *fp) {
+            if (fp) {
+                fclose(fp);
+            }
+        });
+        if (!fp || !readMoov(fp.get(), file_size, moov)) {
+            return false;
+        }
+    }
+
+    uint32_t movie_timescale = 0;
+    vector<Trak> traks;
+    auto ret = forEachBox((uint8_t *)moov.data(), moov.size(), [&](uint32_t type, const uint8_t *ptr, size_t bytes) {
+        switch (type) {
+            case boxType("mvex"): return false; // 分片mp4
+            case boxType("mvhd"): {
+                size_t pos = ptr[0] ? 20 : 12;
+                if (bytes >= pos + 4) {
+                    movie_timescale = readBE32(ptr + pos);
+                }
+                return true;
+            }
+            case boxType("trak"): {
+                traks.emplace_back();
+                return parseTrak(ptr, bytes, movie_timescale, traks.back());
+            }
+            default: return true;
+        }
+    });
+    if (!ret) {
+        return false;
+    }
+
+    // track信息(编码格式与extradata)通过mov_reader获取，只在首次打开时解析
+    static mov_reader_trackinfo_t s_on_track = {
+        [](void *param, uint32_t track, uint8_t object, int width, int height, const void *extra, size_t bytes) {
+            TrackInfo info;
+            info.track_id = track;
+            info.video = true;
+            info.object = object;
+            info.width = width;
+            info.height = height;
+            info.extra.assign((char *)extra, extra ? bytes : 0);
+            ((MP4Index *)param)->_tracks.emplace_back(std::move(info));
+        },
+        [](void *param, uint32_t track, uint8_t object, int channel_count, int bit_per_sample, int sample_rate, const void *extra, size_t bytes) {
+            TrackInfo info;
+            info.track_id = track;
+            info.object = object;
+            info.channel_count = channel_count;
+            info.bit_per_sample = bit_per_sample;
+            info.sample_rate = sample_rate;
+            info.extra.assign((char *)extra, extra ? bytes : 0);
+            ((MP4Index *)param)->_tracks.emplace_back(std::move(info));
+        },
+        [](void *param, uint32_t track, uint8_t object, const void *extra, size_t bytes) {
+            // onsubtitle, do nothing
+        }
+    };
+    auto mp4_file = std::make_shared<MP4FileDisk>();
+    mp4_file->openFile(file.data(), "rb");
+    auto mov_reader = mp4_file->createReader();
+    mov_reader_getinfo(mov_reader.get(), &s_on_track, this);
+    _duration_ms = mov_reader_getduration(mov_reader.get());
+
+    for (auto &trak : traks) {
+        auto it = find_if(_tracks.begin(), _tracks.end(), [&](const TrackInfo &info) { return info.track_id == trak.track_id; });
+        if (it != _tracks.end() && !buildSamples(trak, _samples)) {
+            WarnL << "解析mp4采样表失败:" << file << ", track:" << trak.track_id;
+            return false;
+        }
+    }
+    std::stable_sort(_samples.begin(), _samples.end(), [](const Sample &a, const Sample &b) {
+        return a.dts < b.dts || (a.dts == b.dts && a.offset < b.offset);
+    });
+    _samples.shrink_to_fit();
+
+    // 以第一个视频track的关键帧作为seek点
+    auto it = find_if(_tracks.begin(), _tracks.end(), [](const TrackInfo &info) { return info.video; });
+    if (it != _tracks.end()) {
+        for (size_t i = 0; i < _samples.size(); ++i) {
+            if (_samples[i].track_id == it->track_id && _samples[i].key) {
+                _key_frames.emplace_back(i);
+            }
+        }
+    }
+    return true;
+}
+
+size_t MP4Index::seekTo(int64_t &stamp_ms) const {
+    if (!_key_frames.empty()) {
+        auto it = upper_bound(_key_frames.begin(), _key_frames.end(), stamp_ms, [&](int64_t stamp, size_t index) {
+            return stamp < _samples[index].dts;
+        });
+        if (it != _key_frames.begin()) {
+            --it;
+        }
+        stamp_ms = _samples[*it].dts;
+    }
+    // 同一时刻其他track的采样也一并输出
+    auto it = lower_bound(_samples.begin(), _samples.end(), stamp_ms, [](const Sample &sample, int64_t stamp) {
+        return sample.dts < stamp;
+    });
+    return it - _samples.begin();
+}
+
+size_t MP4Index::getMemorySize() const {
+    auto ret = sizeof(MP4Index) + _samples.capacity() * sizeof(Sample) + _key_frames.capacity() * sizeof(size_t);
+    for (auto &track : _tracks) {
+        ret += sizeof(TrackInfo) + track.extra.size();
+    }
+    return ret;
+}
+
+/////////////////////////////////////////////////////索引缓存/////////////////////////////////////////////////////////
+
+struct IndexCacheItem {
+    string file;
+    time_t mtime;
+    uint64_t file_size;
+    MP4Index::Ptr index;
+};
+
+static mutex s_cache_mtx;
+static size_t s_cache_bytes = 0;
+// 最近使用的在前
+static list<IndexCacheItem> s_cache_list;
+static unordered_map<string, list<IndexCacheItem>::iterator> s_cache_map;
+
+MP4Index::Ptr MP4Index::get(const string &file) {
+    struct stat st;
+    if (0 != stat(file.data(), &st)) {
+        return nullptr;
+    }
+    GET_CONFIG(size_t, cache_mb, Record::kIndexCacheMB);
+    if (cache_mb) {
+        lock_guard<mutex> lck(s_cache_mtx);
+        auto it = s_cache_map.find(file);
+        if (it != s_cache_map.end()) {
+            auto item = it->second;
+            if (item->mtime == st.st_mtime && item->file_size == (uint64_t)st.st_size) {
+                s_cache_list.splice(s_cache_list.begin(), s_cache_list, item);
+                return item->index;
+            }
+            // 文件已经修改
+            s_cache_bytes -= item->index->getMemorySize();
+            s_cache_list.erase(item);
+            s_cache_map.erase(it);
+        }
+    }
+
+    // 在锁外解析，避免阻塞其他文件的打开
+    std::shared_ptr<MP4Index> index(new MP4Index);
+    try {
+        if (!index->load(file, st.st_size)) {
+            return nullptr;
+        }
+    } catch (std::exception &ex) {
+        WarnL << ex.what();
+        return nullptr;
+    }
+    if (!cache_mb) {
+        return index;
+    }
+
+    lock_guard<mutex> lck(s_cache_mtx);
+    if (s_cache_map.find(file) == s_cache_map.end()) {
+        s_cache_list.push_front(IndexCacheItem { file, st.st_mtime, (uint64_t)st.st_size, index });
+        s_cache_map.emplace(file, s_cache_list.begin());
+        s_cache_bytes += index->getMemorySize();
+    }
+    // 淘汰最久未使用的索引，至少保留最新的一个
+    while (s_cache_bytes > cache_mb * 1024 * 1024 && s_cache_list.size() > 1) {
+        auto &item = s_cache_list.back();
+        s_cache_bytes -= item.index->getMemorySize();
+        s_cache_map.erase(item.file);
+        s_cache_list.pop_back();
+    }
+    return index;
+}
+
+/////////////////////////////////////////////////////MP4SampleReader/////////////////////////////////////////////////////////
+
+static ThreadPool &getReadThreadPool() {
+    // 不析构，防止进程退出时等待读盘线程
+    static auto pool = new ThreadPool(4, ThreadPool::PRIORITY_HIGH, true, false, "mp4 read");
+    return *pool;
+}
+
+MP4SampleReader::MP4SampleReader(MP4Index::Ptr index, const string &file) {
+    _index = std::move(index);
+    auto fp = File::create_file(file.data(), "rb");
+    if (!fp) {
+        throw std::runtime_error(string("打开文件失败:") + file);
+    }
+    _file.reset(fp, [](FILE *fp) { fclose(fp); });
+    GET_CONFIG(size_t, read_ahead_kb, Record::kReadAheadKB);
+    _window_bytes = read_ahead_kb * 1024;
+}
+
+Buffer::Ptr MP4SampleReader::read(size_t index) {
+    Buffer::Ptr ret;
+    {
+        lock_guard<mutex> lck(_mtx);
+        // 丢弃跳过的采样
+        while (!_cache.empty() && _cache.front().first <= index) {
+            _cached_bytes -= _cache.front().second->size();
+            if (_cache.front().first == index) {
+                ret = std::move(_cache.front().second);
+            }
+            _cache.pop_front();
+        }
+        _next = MAX(_next, index + 1);
+        if (_window_bytes && !_pending && _cached_bytes < _window_bytes / 2 && _next < _index->getSamples().size()) {
+            // 预读剩余不足一半时，在后台读取下一个区间
+            _pending = true;
+            weak_ptr<MP4SampleReader> weak_self = shared_from_this();
+            auto begin = _next;
+            auto generation = _generation;
+            getReadThreadPool().async([weak_self, begin, generation]() {
+                if (auto strong_self = weak_self.lock()) {
+                    strong_self->readAhead(begin, generation);
+                }
+            });
+        }
+    }
+    if (ret) {
+        return ret;
+    }
+    // 未预读到，同步读取
+    vector<Buffer::Ptr> out;
+    if (!readRange(index, index + 1, out)) {
+        return nullptr;
+    }
+    return out[0];
+}
+
+void MP4SampleReader::reset(size_t index) {
+    lock_guard<mutex> lck(_mtx);
+    // 正在进行的预读结果将被丢弃
+    ++_generation;
+    _pending = false;
+    _cache.clear();
+    _cached_bytes = 0;
+    _next = index;
+}
+
+void MP4SampleReader::readAhead(size_t begin, uint32_t generation) {
+    auto &samples = _index->getSamples();
+    size_t end = begin;
+    size_t bytes = 0;
+    while (end < samples.size() && (end == begin || bytes + samples[end].size <= _window_bytes)) {
+        bytes += samples[end++].size;
+    }
+
+    vector<Buffer::Ptr> out;
+    auto ret = readRange(begin, end, out);
+
+    lock_guard<mutex> lck(_mtx);
+    if (generation != _generation) {
+        // 已经seek
+        return;
+    }
+    _pending = false;
+    if (!ret) {
+        return;
+    }
+    for (size_t i = 0; i < out.size(); ++i) {
+        _cached_bytes += out[i]->size();
+        _cache.emplace_back(begin + i, std::move(out[i]));
+    }
+    _next = end;
+}
+
+bool MP4SampleReader::readRange(size_t begin, size_t end, vector<Buffer::Ptr> &out) {
+    auto &samples = _index->getSamples();
+    out.reserve(end - begin);
+    while (begin < end) {
+        // 合并文件中连续的采样为一次读取
+        auto run_end = begin + 1;
+        auto run_bytes = (size_t)samples[begin].size;
+        while (run_end < end && samples[run_end].offset == samples[begin].offset + run_bytes) {
+            run_bytes += samples[run_end++].size;
+        }
+
+        auto buffer = BufferRaw::create();
+        buffer->setCapacity(run_bytes + 1);
+        buffer->setSize(run_bytes);
+        {
+            lock_guard<mutex> lck(_file_mtx);
+            if (0 != fseek64(_file.get(), samples[begin].offset, SEEK_SET) || run_bytes != fread(buffer->data(), 1, run_bytes, _file.get())) {
+                WarnL << "读取mp4采样失败, offset:" << samples[begin].offset << ", size:" << run_bytes;
+                return false;
+            }
+        }
+        size_t offset = 0;
+        for (auto i = begin; i < run_end; ++i) {
+            auto size = samples[i].size;
+            if (run_end - begin == 1) {
+                out.emplace_back(buffer);
+            } else if (size) {
+                out.emplace_back(std::make_shared<BufferOffset<Buffer::Ptr> >(buffer, offset, size));
+            } else {
+                out.emplace_back(BufferRaw::create());
+            }
+            offset += size;
+        }
+        begin = run_end;
+    }
+    return true;
+}
+
+}//namespace mediakit
+#endif// ENABLE_MP4
@@ -0,0 +1,143 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_MP4INDEX_H
+#define ZLMEDIAKIT_MP4INDEX_H
+#ifdef ENABLE_MP4
+#include <mutex>
+#include <deque>
+#include <string>
+#include <vector>
+#include <memory>
+#include "Network/Buffer.h"
+
+namespace mediakit {
+
+/**
+ * mp4文件的采样索引，由moov中的采样表(stts/ctts/stss/stsz/stsc/stco)直接生成
+ * 同一个文件的索引在进程内缓存(以文件路径、修改时间与大小为键)，多个点播共享，避免每次打开都重新解析moov
+ */
+class MP4Index {
+public:
+    using Ptr = std::shared_ptr<const MP4Index>;
+
+    struct TrackInfo {
+        uint32_t track_id = 0;
+        bool video = false;
+        uint8_t object = 0;
+        int width = 0;
+        int height = 0;
+        int channel_count = 0;
+        int bit_per_sample = 0;
+        int sample_rate = 0;
+        std::string extra;
+    };
+
+    struct Sample {
+        // 在文件中的偏移量
+        uint64_t offset;
+        // 解码时间戳，单位毫秒
+        int64_t dts;
+        // pts与dts的差值，单位毫秒
+        int32_t cts;
+        uint32_t size;
+        uint32_t track_id;
+        bool key;
+    };
+
+    /**
+     * 获取文件的采样索引，文件未修改时返回缓存
+     * @param file mp4文件路径
+     * @return 分片mp4或解析失败时返回nullptr，此时应该使用mov_reader解复用
+     */
+    static Ptr get(const std::string &file);
+
+    /**
+     * 获取所有track信息(通过mov_reader获取，不包括字幕)
+     */
+    const std::vector<TrackInfo> &getTracks() const { return _tracks; }
+
+    /**
+     * 获取所有track的采样，按dts排序
+     */
+    const std::vector<Sample> &getSamples() const { return _samples; }
+
+    /**
+     * 获取文件长度，单位毫秒
+     */
+    uint64_t getDurationMS() const { return _duration_ms; }
+
+    /**
+     * 查找不晚于stamp_ms的视频关键帧，没有视频时按时间戳查找
+     * @param stamp_ms 预期的时间轴位置，返回实际的时间轴位置
+     * @return 开始读取的采样序号
+     */
+    size_t seekTo(int64_t &stamp_ms) const;
+
+    /**
+     * 索引占用的内存大小
+     */
+    size_t getMemorySize() const;
+
+private:
+    MP4Index() = default;
+    bool load(const std::string &file, uint64_t file_size);
+
+private:
+    uint64_t _duration_ms = 0;
+    std::vector<TrackInfo> _tracks;
+    std::vector<Sample> _samples;
+    // 视频关键帧在_samples中的序号
+    std::vector<size_t> _key_frames;
+};
+
+/**
+ * 按索引读取mp4采样
+ * 在后台线程中预读后续的采样区间，文件中连续的采样合并为一次读取，避免在poller线程中阻塞读盘
+ */
+class MP4SampleReader : public std::enable_shared_from_this<MP4SampleReader> {
+public:
+    using Ptr = std::shared_ptr<MP4SampleReader>;
+
+    MP4SampleReader(MP4Index::Ptr index, const std::string &file);
+
+    /**
+     * 读取采样数据，已经预读时直接返回，否则同步读取；同时触发后续采样的预读
+     * @param index 采样序号
+     * @return 读取失败时返回nullptr
+     */
+    toolkit::Buffer::Ptr read(size_t index);
+
+    /**
+     * seek后丢弃已经预读的数据
+     * @param index 下一个读取的采样序号
+     */
+    void reset(size_t index);
+
+private:
+    void readAhead(size_t begin, uint32_t generation);
+    bool readRange(size_t begin, size_t end, std::vector<toolkit::Buffer::Ptr> &out);
+
+private:
+    bool _pending = false;
+    uint32_t _generation = 0;
+    size_t _next = 0;
+    size_t _cached_bytes = 0;
+    size_t _window_bytes = 0;
+    MP4Index::Ptr _index;
+    std::shared_ptr<FILE> _file;
+    std::mutex _file_mtx;
+    std::mutex _mtx;
+    std::deque<std::pair<size_t, toolkit::Buffer::Ptr>> _cache;
+};
+
+}//namespace mediakit
+#endif//ENABLE_MP4
+#endif //ZLMEDIAKIT_MP4INDEX_H
@@ -22,11 +22,12 @@ MP4Muxer::~MP4Muxer() {
     closeMP4();
 }
 
-void MP4Muxer::openMP4(const string &file) {
+void MP4Muxer::openMP4(const string &file, const string &group) {
     closeMP4();
     _file_name = file;
+    _group = group;
     _mp4_file = std::make_shared<MP4FileDisk>();
-    _mp4_file->openFile(_file_name.data(), "wb+");
+    _mp4_file->openFile(_file_name.data(), "wb+", _group);
 }
 
 MP4FileIO::Writer MP4Muxer::createWriter() {
@@ -35,14 +36,20 @@ MP4FileIO::Writer MP4Muxer::createWriter() {
     return _mp4_file->createWriter(mp4FastStart ? MOV_FLAG_FASTSTART : 0, recordEnableFmp4);
 }
 
-void MP4Muxer::closeMP4() {
+void MP4Muxer::closeMP4(const RecordFile::onClosed &cb) {
+    // 先释放mp4复用器，写入moov
     MP4MuxerInterface::resetTracks();
-    _mp4_file = nullptr;
+    if (_mp4_file) {
+        _mp4_file->closeFile(cb);
+        _mp4_file = nullptr;
+    } else if (cb) {
+        cb(false, 0);
+    }
 }
 
 void MP4Muxer::resetTracks() {
     MP4MuxerInterface::resetTracks();
-    openMP4(_file_name);
+    openMP4(_file_name, _group);
 }
 
 /////////////////////////////////////////// MP4MuxerInterface /////////////////////////////////////////////
@@ -99,19 +99,22 @@ public:
     /**
      * 打开mp4
      * @param file 文件完整路径
+     * @param group 录制io分组，一般为流的录制目录
      */
-    void openMP4(const std::string &file);
+    void openMP4(const std::string &file, const std::string &group = "");
 
     /**
      * 手动关闭文件(对象析构时会自动关闭)
+     * @param cb 数据全部写盘并关闭文件后在录制io线程中回调
      */
-    void closeMP4();
+    void closeMP4(const RecordFile::onClosed &cb = nullptr);
 
 protected:
     MP4FileIO::Writer createWriter() override;
 
 private:
     std::string _file_name;
+    std::string _group;
     MP4FileDisk::Ptr _mp4_file;
 };
 
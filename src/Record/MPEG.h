@@ -108,4 +108,28 @@ protected:
 
 #endif
 
+namespace mediakit {
+
+/**
+ * 通过回调输出ts/ps数据的MpegMuxer
+ * 用于同一路流的多个协议(ts直播、hls、ts rtp推流等)共享一个复用器，每帧只复用一次
+ */
+class MpegMuxerImp : public MpegMuxer {
+public:
+    using Ptr = std::shared_ptr<MpegMuxerImp>;
+    using onOutput = std::function<void(const toolkit::Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos)>;
+
+    MpegMuxerImp(onOutput cb, bool is_ps = false) : MpegMuxer(is_ps), _cb(std::move(cb)) {}
+
+protected:
+    void onWrite(std::shared_ptr<toolkit::Buffer> buffer, uint64_t timestamp, bool key_pos) override {
+        _cb(buffer, timestamp, key_pos);
+    }
+
+private:
+    onOutput _cb;
+};
+
+}//namespace mediakit
+
 #endif //ZLMEDIAKIT_MPEG_H
@@ -0,0 +1,507 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <deque>
+#include <thread>
+#include <cstring>
+#include "RecordIO.h"
+#include "Util/File.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Util/uv_errno.h"
+#include "Common/config.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #define fseek64 _fseeki64
+#else
+    #include <unistd.h>
+#endif
+
+#if defined(ENABLE_IO_URING)
+#include <liburing.h>
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 一次批量提交的最大写盘请求数
+static constexpr size_t kMaxBatch = 64;
+
+class RecordIOWorker {
+public:
+    struct Task {
+        RecordFile::Ptr file;
+        Buffer::Ptr data;
+        uint64_t offset = 0;
+        function<void()> func;
+        // 是否已经写盘完成
+        bool done = false;
+    };
+
+    RecordIOWorker(size_t index) {
+#if defined(ENABLE_IO_URING)
+        _uring = 0 == io_uring_queue_init(kMaxBatch, &_ring, 0);
+        if (!_uring) {
+            WarnL << "io_uring初始化失败，录制文件使用同步写盘";
+        }
+#endif
+        _thread = std::thread([this, index]() {
+            setThreadName(("record io " + to_string(index)).data());
+            run();
+        });
+    }
+
+    ~RecordIOWorker() {
+        {
+            lock_guard<mutex> lck(_mtx);
+            _exit = true;
+        }
+        _cond.notify_one();
+        // 等待剩余的数据写盘完毕
+        _thread.join();
+#if defined(ENABLE_IO_URING)
+        if (_uring) {
+            io_uring_queue_exit(&_ring);
+        }
+#endif
+    }
+
+    void post(Task task) {
+        {
+            lock_guard<mutex> lck(_mtx);
+            _tasks.emplace_back(std::move(task));
+        }
+        _cond.notify_one();
+    }
+
+private:
+    void run() {
+        while (true) {
+            deque<Task> tasks;
+            {
+                unique_lock<mutex> lck(_mtx);
+                _cond.wait(lck, [&]() { return _exit || !_tasks.empty(); });
+                if (_tasks.empty()) {
+                    break;
+                }
+                tasks.swap(_tasks);
+            }
+
+            vector<Task *> batch;
+            for (auto &task : tasks) {
+                if (task.data) {
+                    if (batch.size() >= kMaxBatch || overlapped(batch, task)) {
+                        flush(batch);
+                    }
+                    batch.emplace_back(&task);
+                    continue;
+                }
+                // 其他任务需要等待之前的数据写盘完毕
+                flush(batch);
+                try {
+                    task.func();
+                } catch (std::exception &ex) {
+                    WarnL << "Exception occurred: " << ex.what();
+                }
+                if (task.file) {
+                    task.file->onTaskDone();
+                }
+            }
+            flush(batch);
+        }
+    }
+
+    // 同一个文件的写盘区间重叠时(mp4写完后回写box头)，批量提交无法保证先后顺序
+    static bool overlapped(const vector<Task *> &batch, const Task &task) {
+        for (auto &item : batch) {
+            if (item->file == task.file && item->offset < task.offset + task.data->size() && task.offset < item->offset + item->data->size()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void flush(vector<Task *> &batch) {
+        if (batch.empty()) {
+            return;
+        }
+        writeBatch(batch);
+        for (auto &task : batch) {
+            task->file->onTaskDone();
+        }
+        batch.clear();
+    }
+
+    void writeBatch(const vector<Task *> &batch) {
+#if defined(ENABLE_IO_URING)
+        if (_uring && writeBatchUring(batch)) {
+            return;
+        }
+#endif
+        for (auto &task : batch) {
+            auto start = getCurrentMicrosecond();
+            auto ok = task->file->writeAt(task->data->data(), task->data->size(), task->offset);
+            task->file->onWritten(task->data->size(), ok, getCurrentMicrosecond() - start);
+        }
+    }
+
+#if defined(ENABLE_IO_URING)
+    bool writeBatchUring(const vector<Task *> &batch) {
+        size_t submitted = 0;
+        for (auto &task : batch) {
+            if (!task->file->_fp) {
+                // 文件打开失败，不占用sqe，否则未填充的sqe也会被提交
+                task->done = true;
+                task->file->onWritten(task->data->size(), false, 0);
+                continue;
+            }
+            auto sqe = io_uring_get_sqe(&_ring);
+            if (!sqe) {
+                // 提交队列已满，同步写盘
+                auto start = getCurrentMicrosecond();
+                auto ok = task->file->writeAt(task->data->data(), task->data->size(), task->offset);
+                task->done = true;
+                task->file->onWritten(task->data->size(), ok, getCurrentMicrosecond() - start);
+                continue;
+            }
+            io_uring_prep_write(sqe, fileno(task->file->_fp), task->data->data(), task->data->size(), task->offset);
+            io_uring_sqe_set_data(sqe, task);
+            ++submitted;
+        }
+        auto start = getCurrentMicrosecond();
+        if (submitted && io_uring_submit(&_ring) < 0) {
+            WarnL << "io_uring提交失败，录制文件改为同步写盘";
+            _uring = false;
+            return false;
+        }
+        for (size_t i = 0; i < submitted; ++i) {
+            io_uring_cqe *cqe = nullptr;
+            int ret;
+            while (-EINTR == (ret = io_uring_wait_cqe(&_ring, &cqe)));
+            if (ret < 0) {
+                // 已经提交的请求无法追踪完成状态，之后不再使用io_uring
+                WarnL << "io_uring等待完成失败:" << ret << "，录制文件改为同步写盘";
+                _uring = false;
+                for (auto &task : batch) {
+                    if (!task->done) {
+                        task->done = true;
+                        task->file->onWritten(task->data->size(), false, 0);
+                    }
+                }
+                return true;
+            }
+            auto task = (Task *)io_uring_cqe_get_data(cqe);
+            auto res = cqe->res;
+            io_uring_cqe_seen(&_ring, cqe);
+            auto bytes = task->data->size();
+            auto ok = res == (int)bytes;
+            if (!ok && res >= 0) {
+                // 部分写入，同步写入剩余数据
+                ok = task->file->writeAt(task->data->data() + res, bytes - res, task->offset + res);
+            }
+            task->done = true;
+            task->file->onWritten(bytes, ok, getCurrentMicrosecond() - start);
+        }
+        return true;
+    }
+#endif
+
+private:
+    bool _exit = false;
+    mutex _mtx;
+    condition_variable _cond;
+    deque<Task> _tasks;
+    std::thread _thread;
+#if defined(ENABLE_IO_URING)
+    bool _uring = false;
+    struct io_uring _ring;
+#endif
+};
+
+/////////////////////////////////////////////////////RecordFile/////////////////////////////////////////////////////////
+
+RecordFile::Ptr RecordFile::create(const string &path, const string &group, size_t chunk_size) {
+    GET_CONFIG(uint32_t, queue_mb, Record::kIOQueueMB);
+    GET_CONFIG(bool, drop_on_full, Record::kIODropOnFull);
+
+    Ptr ret(new RecordFile(path, MAX(chunk_size, (size_t)4 * 1024)));
+    ret->_max_pending = MAX((size_t)queue_mb * 1024 * 1024, ret->_chunk_size);
+    ret->_drop_on_full = drop_on_full;
+    ret->_stat = RecordIO::Instance().getStat(group);
+    ret->_worker = RecordIO::Instance().getWorker(group);
+    auto ptr = ret.get();
+    ret->post(nullptr, 0, [ptr]() { ptr->onOpen(); });
+    return ret;
+}
+
+RecordFile::RecordFile(string path, size_t chunk_size) {
+    _path = std::move(path);
+    _chunk_size = chunk_size;
+}
+
+RecordFile::~RecordFile() {
+    // 未调用close时，未提交的数据将丢失
+    if (_fp) {
+        fclose(_fp);
+    }
+}
+
+bool RecordFile::write(const void *data, size_t len) {
+    if (_closed || _broken) {
+        return false;
+    }
+    auto ptr = (const char *)data;
+    while (len) {
+        if (_chunk && _pos != _chunk_offset + _chunk->size()) {
+            // seek后不再连续，提交当前块
+            submit();
+        }
+        if (!_chunk) {
+            _chunk = BufferRaw::create();
+            _chunk->setCapacity(_chunk_size);
+            _chunk->setSize(0);
+            _chunk_offset = _pos;
+        }
+        // 块的结束位置按块大小对齐
+        auto chunk_end = (_chunk_offset / _chunk_size + 1) * _chunk_size;
+        auto bytes = (size_t)MIN((uint64_t)len, chunk_end - _pos);
+        memcpy(_chunk->data() + _chunk->size(), ptr, bytes);
+        _chunk->setSize(_chunk->size() + bytes);
+        ptr += bytes;
+        len -= bytes;
+        _pos += bytes;
+        _size = MAX(_size, _pos);
+        if (_pos == chunk_end) {
+            submit();
+        }
+    }
+    return !_broken;
+}
+
+void RecordFile::seek(uint64_t offset) {
+    _pos = offset;
+}
+
+int RecordFile::read(void *data, size_t len) {
+    submit();
+    {
+        unique_lock<mutex> lck(_mtx);
+        _cond.wait(lck, [&]() { return _pending_tasks == 0; });
+    }
+    if (!readAt(data, len, _pos)) {
+        return -1;
+    }
+    _pos += len;
+    return 0;
+}
+
+void RecordFile::close(onClosed cb) {
+    if (_closed) {
+        return;
+    }
+    submit();
+    _closed = true;
+    auto size = _size;
+    post(nullptr, 0, [this, cb, size]() {
+        // 任务持有文件的强引用，此处this有效
+        auto ok = onClose() && !_broken;
+        if (cb) {
+            cb(ok, size);
+        }
+    });
+}
+
+void RecordFile::submit() {
+    auto chunk = std::move(_chunk);
+    if (!chunk || !chunk->size()) {
+        return;
+    }
+    auto bytes = chunk->size();
+    {
+        unique_lock<mutex> lck(_mtx);
+        if (_pending_bytes + bytes > _max_pending) {
+            if (_drop_on_full) {
+                // 丢弃数据后文件已经不完整
+                if (!_broken.exchange(true)) {
+                    WarnL << "录制写盘队列已满，丢弃数据:" << _path;
+                }
+                _stat->drop_bytes += bytes;
+                return;
+            }
+            // 反压，等待录制io线程写盘
+            _cond.wait(lck, [&]() { return _pending_bytes + bytes <= _max_pending || _broken; });
+        }
+        _pending_bytes += bytes;
+    }
+    _stat->pending_bytes += bytes;
+    post(std::move(chunk), _chunk_offset, nullptr);
+}
+
+void RecordFile::post(Buffer::Ptr data, uint64_t offset, function<void()> task) {
+    {
+        lock_guard<mutex> lck(_mtx);
+        ++_pending_tasks;
+    }
+    RecordIOWorker::Task item;
+    item.file = shared_from_this();
+    item.data = std::move(data);
+    item.offset = offset;
+    item.func = std::move(task);
+    _worker->post(std::move(item));
+}
+
+void RecordFile::onOpen() {
+    _fp = File::create_file(_path.data(), "wb+");
+    if (_fp) {
+        return;
+    }
+    WarnL << "Create file failed," << _path << " " << get_uv_errmsg();
+    ++_stat->error_count;
+    _broken = true;
+    lock_guard<mutex> lck(_mtx);
+    _cond.notify_all();
+}
+
+bool RecordFile::onClose() {
+    if (!_fp) {
+        return false;
+    }
+    auto ret = 0 == fclose(_fp);
+    _fp = nullptr;
+    return ret;
+}
+
+bool RecordFile::writeAt(const char *data, size_t len, uint64_t offset) {
+    if (!_fp) {
+        return false;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    lock_guard<mutex> lck(_fp_mtx);
+    return 0 == fseek64(_fp, offset, SEEK_SET) && len == fwrite(data, 1, len, _fp);
+#else
+    auto fd = fileno(_fp);
+    while (len) {
+        auto ret = pwrite(fd, data, len, offset);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+        data += ret;
+        len -= ret;
+        offset += ret;
+    }
+    return true;
+#endif
+}
+
+bool RecordFile::readAt(void *data, size_t len, uint64_t offset) {
+    if (!_fp) {
+        return false;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    lock_guard<mutex> lck(_fp_mtx);
+    return 0 == fseek64(_fp, offset, SEEK_SET) && len == fread(data, 1, len, _fp);
+#else
+    auto fd = fileno(_fp);
+    auto ptr = (char *)data;
+    while (len) {
+        auto ret = pread(fd, ptr, len, offset);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+        ptr += ret;
+        len -= ret;
+        offset += ret;
+    }
+    return true;
+#endif
+}
+
+void RecordFile::onWritten(size_t bytes, bool ok, uint64_t time_us) {
+    _stat->pending_bytes -= bytes;
+    if (ok) {
+        ++_stat->write_count;
+        _stat->write_bytes += bytes;
+        _stat->write_time_us += time_us;
+        auto max_time = _stat->max_time_us.load();
+        while (time_us > max_time && !_stat->max_time_us.compare_exchange_weak(max_time, time_us));
+    } else {
+        ++_stat->error_count;
+        if (!_broken.exchange(true)) {
+            WarnL << "写入录制文件失败:" << _path << " " << get_uv_errmsg();
+        }
+    }
+    lock_guard<mutex> lck(_mtx);
+    _pending_bytes -= bytes;
+    _cond.notify_all();
+}
+
+void RecordFile::onTaskDone() {
+    lock_guard<mutex> lck(_mtx);
+    --_pending_tasks;
+    _cond.notify_all();
+}
+
+/////////////////////////////////////////////////////RecordIO/////////////////////////////////////////////////////////
+
+INSTANCE_IMP(RecordIO)
+
+RecordIO::RecordIO() {
+    GET_CONFIG(uint32_t, thread_num, Record::kIOThreadNum);
+    for (size_t i = 0; i < MAX(thread_num, 1u); ++i) {
+        _workers.emplace_back(std::make_shared<RecordIOWorker>(i));
+    }
+}
+
+RecordIO::~RecordIO() = default;
+
+RecordIOWorker *RecordIO::getWorker(const string &group) {
+    return _workers[std::hash<string>()(group) % _workers.size()].get();
+}
+
+shared_ptr<RecordIOStat> RecordIO::getStat(const string &group) {
+    lock_guard<mutex> lck(_mtx);
+    auto &weak_stat = _stats[group];
+    auto ret = weak_stat.lock();
+    if (!ret) {
+        ret = std::make_shared<RecordIOStat>();
+        weak_stat = ret;
+    }
+    return ret;
+}
+
+void RecordIO::async(const string &group, function<void()> task) {
+    RecordIOWorker::Task item;
+    item.func = std::move(task);
+    getWorker(group)->post(std::move(item));
+}
+
+void RecordIO::getStatistic(const function<void(const string &group, const RecordIOStat &stat)> &cb) {
+    lock_guard<mutex> lck(_mtx);
+    for (auto it = _stats.begin(); it != _stats.end();) {
+        auto stat = it->second.lock();
+        if (!stat) {
+            // 该分组已经没有录制中的文件
+            it = _stats.erase(it);
+            continue;
+        }
+        cb(it->first, *stat);
+        ++it;
+    }
+}
+
+}//namespace mediakit
@@ -0,0 +1,166 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RECORDIO_H
+#define ZLMEDIAKIT_RECORDIO_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
+#include "Network/Buffer.h"
+
+namespace mediakit {
+
+class RecordIOWorker;
+
+/**
+ * 录制写盘统计，按分组(一般为流的录制目录)统计
+ */
+struct RecordIOStat {
+    std::atomic<uint64_t> write_count { 0 };
+    std::atomic<uint64_t> write_bytes { 0 };
+    // 累计写盘耗时，单位微秒
+    std::atomic<uint64_t> write_time_us { 0 };
+    // 单次写盘最大耗时，单位微秒
+    std::atomic<uint64_t> max_time_us { 0 };
+    std::atomic<uint64_t> error_count { 0 };
+    // 队列满时丢弃的数据量
+    std::atomic<uint64_t> drop_bytes { 0 };
+    // 排队中未写盘的数据量
+    std::atomic<uint64_t> pending_bytes { 0 };
+};
+
+/**
+ * 异步写入的录制文件
+ * 数据先合并为块(块的结束位置按块大小对齐)，再提交到录制io线程写盘，文件的打开与关闭也在录制io线程中执行，
+ * 避免磁盘卡顿时阻塞媒体poller线程；每个文件排队的数据量有上限，超过后阻塞等待或丢弃数据
+ * 写入接口非线程安全，应该在同一线程中调用
+ */
+class RecordFile : public std::enable_shared_from_this<RecordFile> {
+public:
+    using Ptr = std::shared_ptr<RecordFile>;
+    using onClosed = std::function<void(bool ok, uint64_t file_size)>;
+
+    /**
+     * 创建文件
+     * @param path 文件路径
+     * @param group 分组，同一分组的文件在同一线程中按顺序写盘
+     * @param chunk_size 合并写盘的块大小
+     */
+    static Ptr create(const std::string &path, const std::string &group, size_t chunk_size);
+    ~RecordFile();
+
+    /**
+     * 在当前位置写入数据
+     * @return 文件已经损坏(打开失败、写盘失败或丢弃了数据)时返回false
+     */
+    bool write(const void *data, size_t len);
+
+    /**
+     * 移动读写位置
+     */
+    void seek(uint64_t offset);
+
+    /**
+     * 获取读写位置
+     */
+    uint64_t tell() const { return _pos; }
+
+    /**
+     * 在当前位置读取数据，会先等待已经提交的数据写盘完毕
+     * @return 是否成功(0成功)
+     */
+    int read(void *data, size_t len);
+
+    /**
+     * 提交剩余的数据并关闭文件
+     * @param cb 文件关闭后在录制io线程中回调
+     */
+    void close(onClosed cb = nullptr);
+
+    bool isBroken() const { return _broken; }
+
+    const std::string &getPath() const { return _path; }
+
+private:
+    friend class RecordIOWorker;
+    RecordFile(std::string path, size_t chunk_size);
+
+    void submit();
+    void post(toolkit::Buffer::Ptr data, uint64_t offset, std::function<void()> task);
+    bool readAt(void *data, size_t len, uint64_t offset);
+
+    // 以下在录制io线程中调用
+    void onOpen();
+    bool onClose();
+    bool writeAt(const char *data, size_t len, uint64_t offset);
+    void onWritten(size_t bytes, bool ok, uint64_t time_us);
+    void onTaskDone();
+
+private:
+    bool _closed = false;
+    bool _drop_on_full = false;
+    std::atomic<bool> _broken { false };
+    size_t _chunk_size;
+    size_t _max_pending = 0;
+    size_t _pending_bytes = 0;
+    size_t _pending_tasks = 0;
+    uint64_t _pos = 0;
+    uint64_t _size = 0;
+    uint64_t _chunk_offset = 0;
+    std::string _path;
+    FILE *_fp = nullptr;
+    // windows下没有按偏移量读写的接口，读写需要加锁
+    std::mutex _fp_mtx;
+    std::mutex _mtx;
+    std::condition_variable _cond;
+    toolkit::BufferRaw::Ptr _chunk;
+    std::shared_ptr<RecordIOStat> _stat;
+    RecordIOWorker *_worker = nullptr;
+};
+
+/**
+ * 录制io线程池，文件按分组固定在某个线程中写盘
+ * 编译时开启ENABLE_IO_URING时通过io_uring批量提交写盘请求，否则逐个同步写盘
+ */
+class RecordIO {
+public:
+    static RecordIO &Instance();
+    ~RecordIO();
+
+    /**
+     * 在分组对应的录制io线程中执行任务，与该分组的文件写盘保持先后顺序
+     */
+    void async(const std::string &group, std::function<void()> task);
+
+    /**
+     * 遍历各分组的写盘统计
+     */
+    void getStatistic(const std::function<void(const std::string &group, const RecordIOStat &stat)> &cb);
+
+private:
+    friend class RecordFile;
+    RecordIO();
+    RecordIOWorker *getWorker(const std::string &group);
+    std::shared_ptr<RecordIOStat> getStat(const std::string &group);
+
+private:
+    std::mutex _mtx;
+    std::vector<std::shared_ptr<RecordIOWorker>> _workers;
+    std::unordered_map<std::string, std::weak_ptr<RecordIOStat>> _stats;
+};
+
+}//namespace mediakit
+#endif //ZLMEDIAKIT_RECORDIO_H
@@ -457,9 +457,12 @@ FCI_TWCC::TwccPacketStatus FCI_TWCC::getPacketChunkList(size_t total_size) const
         }
         ptr += 2;
     }
-    for (auto &pr : ret) {
+    // 接收时间增量按seq顺序排列，seq回环时不能按map顺序遍历
+    seq = getBaseSeq();
+    for (size_t i = 0; i < ret.size(); ++i, ++seq) {
         CHECK(ptr <= end);
-        pr.second.second = getRecvDelta(pr.second.first, ptr, end);
+        auto &pr = ret[seq];
+        pr.second = getRecvDelta(pr.first, ptr, end);
     }
     return ret;
 }
@@ -66,6 +66,12 @@ void FlvMuxer::start(const EventPoller::Ptr &poller, const RtmpMediaSource::Ptr
             return;
         }
 
+        if (!check) {
+            // 直接发送所有播放器共享的flv tag数据
+            strong_self->onWrite(pkt->getFlvBuffer(), true);
+            return;
+        }
+
         size_t i = 0;
         auto size = pkt->size();
         pkt->for_each([&](const RtmpPacket::Ptr &rtmp) {
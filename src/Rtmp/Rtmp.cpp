@@ -8,7 +8,9 @@
  * may be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <algorithm>
 #include "Rtmp.h"
+#include "utils.h"
 #include "Common/config.h"
 #include "Extension/Factory.h"
 
@@ -239,6 +241,129 @@ RtmpPacket &RtmpPacket::operator=(const RtmpPacket &that) {
     return *this;
 }
 
+toolkit::Buffer::Ptr RtmpPacketList::getChunkedBuffer(size_t chunk_size) const {
+    std::call_once(_chunked_flag, [&]() {
+        _chunk_size = chunk_size;
+        _chunked_buffer = makeChunkedBuffer(chunk_size);
+    });
+    return _chunk_size == chunk_size ? _chunked_buffer : nullptr;
+}
+
+toolkit::Buffer::Ptr RtmpPacketList::makeChunkedBuffer(size_t chunk_size) const {
+    if (!chunk_size) {
+        return nullptr;
+    }
+    size_t total = 0;
+    for (auto &pkt : *this) {
+        if (pkt->chunk_id < 2 || pkt->chunk_id > 63) {
+            // 只支持一个字节的basic header
+            return nullptr;
+        }
+        auto chunks = (pkt->size() + chunk_size - 1) / chunk_size;
+        // fmt0头 + 扩展时间戳 + 后续每个chunk的fmt3头与扩展时间戳
+        total += sizeof(RtmpHeader) + 4 + (chunks ? chunks - 1 : 0) * 5 + pkt->size();
+    }
+
+    // 每个chunk stream id上一个消息的头部信息，用于头部压缩
+    struct ChunkState {
+        bool valid = false;
+        uint8_t type_id = 0;
+        uint32_t stamp = 0;
+        uint32_t stream_index = 0;
+        size_t body_size = 0;
+    } states[64];
+
+    auto buffer = toolkit::BufferRaw::create();
+    buffer->setCapacity(total + 1);
+    auto start = (uint8_t *)buffer->data();
+    auto ptr = start;
+    for (auto &pkt : *this) {
+        auto &state = states[pkt->chunk_id];
+        auto stamp = pkt->time_stamp;
+        auto delta = stamp - state.stamp;
+        bool ext_stamp = stamp >= 0xFFFFFF;
+        int fmt = 0;
+        if (state.valid && !ext_stamp && stamp >= state.stamp && pkt->stream_index == state.stream_index) {
+            // 时间戳递增且stream id相同，可以只发送时间戳增量
+            fmt = (pkt->type_id == state.type_id && pkt->size() == state.body_size) ? 2 : 1;
+        }
+
+        *ptr++ = (uint8_t)((fmt << 6) | pkt->chunk_id);
+        switch (fmt) {
+            case 0:
+                set_be24(ptr, ext_stamp ? 0xFFFFFF : stamp);
+                set_be24(ptr + 3, (uint32_t)pkt->size());
+                ptr[6] = pkt->type_id;
+                set_le32(ptr + 7, pkt->stream_index);
+                ptr += 11;
+                break;
+            case 1:
+                set_be24(ptr, delta);
+                set_be24(ptr + 3, (uint32_t)pkt->size());
+                ptr[6] = pkt->type_id;
+                ptr += 7;
+                break;
+            default:
+                set_be24(ptr, delta);
+                ptr += 3;
+                break;
+        }
+
+        size_t offset = 0;
+        do {
+            if (offset) {
+                // 同一消息的后续chunk使用fmt3
+                *ptr++ = (uint8_t)((3 << 6) | pkt->chunk_id);
+            }
+            if (ext_stamp) {
+                set_be32(ptr, stamp);
+                ptr += 4;
+            }
+            auto chunk = std::min(chunk_size, pkt->size() - offset);
+            memcpy(ptr, pkt->data() + offset, chunk);
+            ptr += chunk;
+            offset += chunk;
+        } while (offset < pkt->size());
+
+        state.valid = true;
+        state.type_id = pkt->type_id;
+        state.stamp = stamp;
+        state.stream_index = pkt->stream_index;
+        state.body_size = pkt->size();
+    }
+    buffer->setSize(ptr - start);
+    return buffer;
+}
+
+const toolkit::Buffer::Ptr &RtmpPacketList::getFlvBuffer() const {
+    std::call_once(_flv_flag, [this]() {
+        size_t total = 0;
+        for (auto &pkt : *this) {
+            total += sizeof(RtmpTagHeader) + pkt->size() + 4;
+        }
+        auto buffer = toolkit::BufferRaw::create();
+        buffer->setCapacity(total + 1);
+        auto ptr = buffer->data();
+        for (auto &pkt : *this) {
+            RtmpTagHeader header;
+            header.type = pkt->type_id;
+            set_be24(header.data_size, (uint32_t)pkt->size());
+            header.timestamp_ex = (pkt->time_stamp >> 24) & 0xff;
+            set_be24(header.timestamp, pkt->time_stamp & 0xFFFFFF);
+            memcpy(ptr, &header, sizeof(header));
+            ptr += sizeof(header);
+            memcpy(ptr, pkt->data(), pkt->size());
+            ptr += pkt->size();
+            // PreviousTagSize
+            set_be32(ptr, (uint32_t)(pkt->size() + sizeof(header)));
+            ptr += 4;
+        }
+        buffer->setSize(total);
+        _flv_buffer = std::move(buffer);
+    });
+    return _flv_buffer;
+}
+
 RtmpHandshake::RtmpHandshake(uint32_t _time, uint8_t *_random /*= nullptr*/) {
     _time = htonl(_time);
     memcpy(time_stamp, &_time, 4);
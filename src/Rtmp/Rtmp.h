@@ -11,10 +11,12 @@
 #ifndef __rtmp_h
 #define __rtmp_h
 
+#include <mutex>
 #include <memory>
 #include <string>
 #include <cstdlib>
 #include "amf.h"
+#include "Util/List.h"
 #include "Network/Buffer.h"
 #include "Extension/Track.h"
 
@@ -211,6 +213,39 @@ private:
     toolkit::ObjectStatistic<RtmpPacket> _statistic;
 };
 
+/**
+ * RtmpMediaSource环形缓存中的rtmp包列表
+ * 可以按chunk size生成分块后的数据供所有播放器共享，避免每个播放器重复分块
+ */
+class RtmpPacketList : public toolkit::List<RtmpPacket::Ptr> {
+public:
+    using Ptr = std::shared_ptr<RtmpPacketList>;
+
+    /**
+     * 获取分块后的rtmp数据，每个消息已经包含chunk头，同一chunk stream id的后续消息采用fmt1/fmt2压缩头
+     * 首次调用时按调用者的chunk size生成，之后chunk size相同的播放器共享同一块内存；线程安全
+     * @param chunk_size 输出chunk size
+     * @return chunk size与首次调用不一致或包含不支持的chunk id时返回nullptr，此时需要逐包发送
+     */
+    toolkit::Buffer::Ptr getChunkedBuffer(size_t chunk_size) const;
+
+    /**
+     * 获取flv tag格式的数据，每个包已经包含tag头与PreviousTagSize
+     * 首次调用时生成，之后所有http-flv/websocket-flv播放器共享同一块内存；线程安全
+     */
+    const toolkit::Buffer::Ptr &getFlvBuffer() const;
+
+private:
+    toolkit::Buffer::Ptr makeChunkedBuffer(size_t chunk_size) const;
+
+private:
+    mutable size_t _chunk_size = 0;
+    mutable std::once_flag _chunked_flag;
+    mutable toolkit::Buffer::Ptr _chunked_buffer;
+    mutable std::once_flag _flv_flag;
+    mutable toolkit::Buffer::Ptr _flv_buffer;
+};
+
 /**
  * rtmp metadata基类，用于描述rtmp格式信息
  */
@@ -33,10 +33,10 @@ namespace mediakit {
  * 只要生成了这三要素，那么要实现rtmp推流、rtmp服务器就很简单了
  * rtmp推拉流协议中，先传递metadata，然后传递config帧，然后一直传递普通帧
  */
-class RtmpMediaSource : public MediaSource, public toolkit::RingDelegate<RtmpPacket::Ptr>, private PacketCache<RtmpPacket>{
+class RtmpMediaSource : public MediaSource, public toolkit::RingDelegate<RtmpPacket::Ptr>, private PacketCache<RtmpPacket, FlushPolicy, RtmpPacketList> {
 public:
     using Ptr = std::shared_ptr<RtmpMediaSource>;
-    using RingDataType = std::shared_ptr<toolkit::List<RtmpPacket::Ptr> >;
+    using RingDataType = RtmpPacketList::Ptr;
     using RingType = toolkit::RingBuffer<RingDataType>;
 
     /**
@@ -115,7 +115,7 @@ public:
     uint32_t getTimeStamp(TrackType trackType) override;
 
     void clearCache() override{
-        PacketCache<RtmpPacket>::clearCache();
+        PacketCache<RtmpPacket, FlushPolicy, RtmpPacketList>::clearCache();
         _ring->clearCache();
     }
 
@@ -133,7 +133,7 @@ private:
     * @param rtmp_list rtmp包列表
     * @param key_pos 是否包含关键帧
     */
-    void onFlush(std::shared_ptr<toolkit::List<RtmpPacket::Ptr> > rtmp_list, bool key_pos) override {
+    void onFlush(RtmpPacketList::Ptr rtmp_list, bool key_pos) override {
         //如果不存在视频，那么就没有存在GOP缓存的意义，所以is_key一直为true确保一直清空GOP缓存
         _ring->write(std::move(rtmp_list), _have_video ? key_pos : true);
     }
@@ -270,6 +270,20 @@ void RtmpProtocol::sendRtmp(uint8_t type, uint32_t stream_index, const Buffer::P
     }
 }
 
+bool RtmpProtocol::sendRtmp(const RtmpPacketList &list) {
+    auto buffer = list.getChunkedBuffer(_chunk_size_out);
+    if (!buffer) {
+        return false;
+    }
+    _bytes_sent += (uint32_t)buffer->size();
+    onSendRawData(std::move(buffer));
+    if (_windows_size > 0 && _bytes_sent - _bytes_sent_last >= _windows_size) {
+        _bytes_sent_last = _bytes_sent;
+        sendAcknowledgement(_bytes_sent);
+    }
+    return true;
+}
+
 void RtmpProtocol::onParseRtmp(const char *data, size_t size) {
     input(data, size);
 }
@@ -61,6 +61,8 @@ protected:
     void sendResponse(int type, const std::string &str);
     void sendRtmp(uint8_t type, uint32_t stream_index, const std::string &buffer, uint32_t stamp, int chunk_id);
     void sendRtmp(uint8_t type, uint32_t stream_index, const toolkit::Buffer::Ptr &buffer, uint32_t stamp, int chunk_id);
+    // 发送多个播放器共享的分块后rtmp数据，chunk size不一致时返回false，需要逐包发送
+    bool sendRtmp(const RtmpPacketList &list);
     toolkit::BufferRaw::Ptr obtainBuffer(const void *data = nullptr, size_t len = 0);
 
 private:
@@ -314,6 +314,11 @@ void RtmpSession::sendPlayResponse(const string &err, const RtmpMediaSource::Ptr
         if (!strong_self) {
             return;
         }
+        strong_self->setSendFlushFlag(true);
+        if (strong_self->sendRtmp(*pkt)) {
+            // 直接发送共享的分块数据
+            return;
+        }
         size_t i = 0;
         auto size = pkt->size();
         strong_self->setSendFlushFlag(false);
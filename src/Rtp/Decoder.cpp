@@ -28,6 +28,10 @@ void Decoder::setOnDecode(Decoder::onDecode cb) {
 void Decoder::setOnStream(Decoder::onStream cb) {
     _on_stream = std::move(cb);
 }
+
+void Decoder::setOnDecodeBuffer(Decoder::onDecodeBuffer cb) {
+    _on_decode_buffer = std::move(cb);
+}
     
 static Decoder::Ptr createDecoder_l(DecoderImp::Type type) {
     switch (type){
@@ -80,6 +84,9 @@ DecoderImp::DecoderImp(const Decoder::Ptr &decoder, MediaSinkInterface *sink){
     _decoder->setOnStream([this](int stream, int codecid, const void *extra, size_t bytes, int finish) {
         onStream(stream, codecid, extra, bytes, finish);
     });
+    _decoder->setOnDecodeBuffer([this](int stream, int codecid, int flags, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
+        onDecode(stream, codecid, flags, pts, dts, buffer);
+    });
 }
 
 #if defined(ENABLE_RTPPROXY) || defined(ENABLE_HLS)
@@ -102,13 +109,23 @@ void DecoderImp::onStream(int stream, int codecid, const void *extra, size_t byt
 }
 
 void DecoderImp::onDecode(int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes) {
-    pts /= 90;
-    dts /= 90;
+    auto codec = getCodecByMpegId(codecid);
+    if (codec == CodecInvalid) {
+        return;
+    }
+    onDecodeFrame(stream, codec, Factory::getFrameFromPtr(codec, (char *)data, bytes, dts / 90, pts / 90));
+}
 
+void DecoderImp::onDecode(int stream, int codecid, int flags, int64_t pts, int64_t dts, const Buffer::Ptr &buffer) {
     auto codec = getCodecByMpegId(codecid);
     if (codec == CodecInvalid) {
         return;
     }
+    // 可缓存的帧，合并时无需再拷贝
+    onDecodeFrame(stream, codec, Factory::getFrameFromBuffer(codec, buffer, dts / 90, pts / 90));
+}
+
+void DecoderImp::onDecodeFrame(int stream, CodecId codec, const Frame::Ptr &frame) {
     auto &ref = _tracks[stream];
     if (!ref.first) {
         onTrack(stream, Factory::getTrackByCodecId(codec, 8000, 1, 16));
@@ -117,7 +134,9 @@ void DecoderImp::onDecode(int stream, int codecid, int flags, int64_t pts, int64
         WarnL << "Unsupported codec :" << getCodecName(codec);
         return;
     }
-    auto frame = Factory::getFrameFromPtr(codec, (char *)data, bytes, dts, pts);
+    if (!frame) {
+        return;
+    }
     if (getTrackType(codec) != TrackVideo) {
         onFrame(stream, frame);
         return;
@@ -128,6 +147,8 @@ void DecoderImp::onDecode(int stream, int codecid, int flags, int64_t pts, int64
 }
 #else
 void DecoderImp::onDecode(int stream,int codecid,int flags,int64_t pts,int64_t dts,const void *data,size_t bytes) {}
+void DecoderImp::onDecode(int stream,int codecid,int flags,int64_t pts,int64_t dts,const Buffer::Ptr &buffer) {}
+void DecoderImp::onDecodeFrame(int stream,CodecId codec,const Frame::Ptr &frame) {}
 void DecoderImp::onStream(int stream,int codecid,const void *extra,size_t bytes,int finish) {}
 #endif
 
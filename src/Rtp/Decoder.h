@@ -23,10 +23,13 @@ public:
     using Ptr = std::shared_ptr<Decoder>;
     using onDecode = std::function<void(int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes)>;
     using onStream = std::function<void(int stream, int codecid, const void *extra, size_t bytes, int finish)>;
+    // 解复用器自行拼接好的帧，所有权转移给回调，无需再拷贝
+    using onDecodeBuffer = std::function<void(int stream, int codecid, int flags, int64_t pts, int64_t dts, const toolkit::Buffer::Ptr &buffer)>;
 
     virtual ssize_t input(const uint8_t *data, size_t bytes) = 0;
     void setOnDecode(onDecode cb);
     void setOnStream(onStream cb);
+    void setOnDecodeBuffer(onDecodeBuffer cb);
 
 protected:
     Decoder() = default;
@@ -35,6 +38,7 @@ protected:
 protected:
     onDecode _on_decode;
     onStream _on_stream;
+    onDecodeBuffer _on_decode_buffer;
 };
 
 class DecoderImp {
@@ -54,6 +58,8 @@ protected:
 private:
     DecoderImp(const Decoder::Ptr &decoder, MediaSinkInterface *sink);
     void onDecode(int stream, int codecid, int flags, int64_t pts, int64_t dts, const void *data, size_t bytes);
+    void onDecode(int stream, int codecid, int flags, int64_t pts, int64_t dts, const toolkit::Buffer::Ptr &buffer);
+    void onDecodeFrame(int stream, CodecId codec, const Frame::Ptr &frame);
     void onStream(int stream, int codecid, const void *extra, size_t bytes, int finish);
 
 private:
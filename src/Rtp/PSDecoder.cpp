@@ -12,12 +12,45 @@
 
 #include "PSDecoder.h"
 #include "mpeg-ps.h"
+#include "Common/config.h"
 
 using namespace toolkit;
 
 namespace mediakit{
 
+// 收到psm前允许的音视频pes个数，超过后认为流中没有psm，回退到libmpeg解析
+static constexpr size_t kMaxPesWithoutPSM = 256;
+// 单帧最大长度，防止异常流导致内存溢出
+static constexpr size_t kMaxFrameSize = 8 * 1024 * 1024;
+// psm最大长度
+static constexpr size_t kMaxHeaderSize = 6 + 0xFFFF;
+
+// 查找00 00 01起始码
+// memchr在主流平台上为simd实现，先定位0x01再回溯比对前两个字节，比逐字节比对快得多
+static const uint8_t *findStartCode(const uint8_t *data, size_t bytes) {
+    auto ptr = data + 2;
+    auto end = data + bytes;
+    while (ptr < end) {
+        ptr = (const uint8_t *)memchr(ptr, 0x01, end - ptr);
+        if (!ptr) {
+            return nullptr;
+        }
+        if (ptr[-1] == 0x00 && ptr[-2] == 0x00) {
+            return ptr - 2;
+        }
+        // 当前字节为0x01，下一个起始码的0x01至少在3个字节后
+        ptr += 3;
+    }
+    return nullptr;
+}
+
+static int64_t readStamp(const uint8_t *ptr) {
+    return (((int64_t)(ptr[0] >> 1) & 0x07) << 30) | (ptr[1] << 22) | ((ptr[2] >> 1) << 15) | (ptr[3] << 7) | (ptr[4] >> 1);
+}
+
 PSDecoder::PSDecoder() {
+    GET_CONFIG(bool, fast_demux, RtpProxy::kPSFastDemux);
+    _fast_demux = fast_demux;
     _ps_demuxer = ps_demuxer_create([](void* param,
                                        int stream,
                                        int codecid,
@@ -49,10 +82,259 @@ PSDecoder::~PSDecoder() {
 }
 
 ssize_t PSDecoder::input(const uint8_t *data, size_t bytes) {
+    if (_fast_demux) {
+        inputFast(data, bytes);
+        return bytes;
+    }
     HttpRequestSplitter::input(reinterpret_cast<const char *>(data), bytes);
     return bytes;
 }
 
+void PSDecoder::inputFast(const uint8_t *data, size_t bytes) {
+    while (bytes && _fast_demux) {
+        if (_payload_left) {
+            // pes负载，直接拼接到帧中或丢弃
+            auto len = MIN(_payload_left, bytes);
+            if (_cur) {
+                onPesPayload(data, len, len == _payload_left);
+            }
+            _payload_left -= len;
+            data += len;
+            bytes -= len;
+            continue;
+        }
+
+        if (!_header_cache.empty()) {
+            // 上次输入剩余不完整的头部，补齐后再解析
+            auto old_size = _header_cache.size();
+            auto len = MIN(bytes, MIN((size_t)256, kMaxHeaderSize - old_size));
+            _header_cache.append((char *)data, len);
+            auto ret = parseHeader((uint8_t *)_header_cache.data(), _header_cache.size());
+            if (ret == 0 && _header_cache.size() < kMaxHeaderSize) {
+                data += len;
+                bytes -= len;
+                continue;
+            }
+            _header_cache.clear();
+            if (ret > 0) {
+                // 头部的剩余部分在本次输入中
+                data += ret - old_size;
+                bytes -= ret - old_size;
+            }
+            // 非法数据，丢弃缓存后从本次输入重新同步
+            continue;
+        }
+
+        auto ret = parseHeader(data, bytes);
+        if (ret > 0) {
+            data += ret;
+            bytes -= ret;
+            continue;
+        }
+        if (ret == 0) {
+            // 头部不完整，等待后续数据
+            _header_cache.assign((char *)data, bytes);
+            return;
+        }
+
+        // 非法数据，搜索下一个起始码恢复同步
+        auto next = bytes > 1 ? findStartCode(data + 1, bytes - 1) : nullptr;
+        if (!next) {
+            // 保留末尾可能是起始码前缀的字节
+            auto keep = data[bytes - 1] ? 0 : (bytes > 1 && !data[bytes - 2] ? 2 : 1);
+            _header_cache.assign((char *)data + bytes - keep, keep);
+            return;
+        }
+        bytes -= next - data;
+        data = next;
+    }
+    if (bytes && !_fast_demux) {
+        HttpRequestSplitter::input(reinterpret_cast<const char *>(data), bytes);
+    }
+}
+
+ssize_t PSDecoder::parseHeader(const uint8_t *data, size_t bytes) {
+    static const uint8_t s_start_code[] = { 0x00, 0x00, 0x01 };
+    if (memcmp(data, s_start_code, MIN(bytes, sizeof(s_start_code)))) {
+        return -1;
+    }
+    if (bytes < 4) {
+        return 0;
+    }
+    auto id = data[3];
+    if (id == 0xB9) {
+        // 结束码
+        return 4;
+    }
+    if (id == 0xBA) {
+        // pack header
+        if (bytes < 5) {
+            return 0;
+        }
+        if ((data[4] & 0xC0) == 0x40) {
+            // mpeg2
+            if (bytes < 14) {
+                return 0;
+            }
+            size_t len = 14 + (data[13] & 0x07);
+            return bytes < len ? 0 : len;
+        }
+        if ((data[4] & 0xF0) == 0x20) {
+            // mpeg1
+            return bytes < 12 ? 0 : 12;
+        }
+        return -1;
+    }
+    if (id < 0xBB) {
+        return -1;
+    }
+    if (bytes < 6) {
+        return 0;
+    }
+    size_t len = (data[4] << 8) | data[5];
+    if (id == 0xBC) {
+        // psm
+        if (bytes < 6 + len) {
+            return 0;
+        }
+        parsePSM(data + 6, len);
+        return 6 + len;
+    }
+
+    auto it = _streams.find(id);
+    if (it == _streams.end()) {
+        // system header、padding、海康私有数据或psm中未声明的流，丢弃
+        if (!_have_psm && id >= 0xC0 && id <= 0xEF && ++_pes_without_psm > kMaxPesWithoutPSM) {
+            WarnL << "No psm found in ps stream, fallback to libmpeg";
+            _fast_demux = false;
+            return 6;
+        }
+        _cur = nullptr;
+        _cur_id = -1;
+        _payload_left = len;
+        return 6;
+    }
+
+    if (len < 3) {
+        return -1;
+    }
+    if (bytes < 9) {
+        return 0;
+    }
+    if ((data[6] & 0xC0) != 0x80) {
+        // 不是mpeg2格式的pes，丢弃
+        _cur = nullptr;
+        _cur_id = -1;
+        _payload_left = len;
+        return 6;
+    }
+    size_t header_len = data[8];
+    if (len < 3 + header_len) {
+        return -1;
+    }
+    if (bytes < 9 + header_len) {
+        return 0;
+    }
+    auto flags = data[7] >> 6;
+    int64_t pts = 0, dts = 0;
+    if (flags & 0x02) {
+        if (header_len < 5 || (flags == 0x03 && header_len < 10)) {
+            return -1;
+        }
+        pts = dts = readStamp(data + 9);
+        if (flags == 0x03) {
+            dts = readStamp(data + 14);
+        }
+    }
+    _cur_id = id;
+    _cur = &it->second;
+    onPesHeader(it->second, flags & 0x02, pts, dts);
+    _payload_left = len - 3 - header_len;
+    return 9 + header_len;
+}
+
+void PSDecoder::parsePSM(const uint8_t *data, size_t bytes) {
+    if (bytes < 6) {
+        return;
+    }
+    size_t info_len = (data[2] << 8) | data[3];
+    if (4 + info_len + 2 > bytes) {
+        return;
+    }
+    auto ptr = data + 4 + info_len;
+    size_t map_len = (ptr[0] << 8) | ptr[1];
+    ptr += 2;
+    auto end = MIN(ptr + map_len, data + bytes);
+    std::vector<int> added;
+    while (ptr + 4 <= end) {
+        auto type = ptr[0];
+        auto id = ptr[1];
+        ptr += 4 + ((ptr[2] << 8) | ptr[3]);
+        if (_streams.find(id) != _streams.end()) {
+            continue;
+        }
+        auto &stream = _streams[id];
+        stream.video = id >= 0xE0 && id <= 0xEF;
+        stream.codecid = type;
+        stream.frame = std::make_shared<BufferLikeString>();
+        added.emplace_back(id);
+    }
+    _have_psm = true;
+    if (!_on_stream) {
+        return;
+    }
+    for (size_t i = 0; i < added.size(); ++i) {
+        _on_stream(added[i], _streams[added[i]].codecid, nullptr, 0, i + 1 == added.size());
+    }
+}
+
+void PSDecoder::onPesHeader(Stream &stream, bool has_stamp, int64_t pts, int64_t dts) {
+    if (!has_stamp) {
+        // 后续pes，沿用前一个pes的时间戳
+        return;
+    }
+    if (stream.video && stream.frame->size() && stream.pts != pts) {
+        // 时间戳变化，说明上一帧已经完整
+        flushFrame(_cur_id, stream);
+    }
+    stream.pts = pts;
+    stream.dts = dts;
+}
+
+void PSDecoder::onPesPayload(const uint8_t *data, size_t bytes, bool end) {
+    auto &stream = *_cur;
+    if (!stream.video && end && !stream.frame->size()) {
+        // 完整的音频pes，直接引用输入数据，无需拷贝
+        if (_on_decode) {
+            _on_decode(_cur_id, stream.codecid, 0, stream.pts, stream.dts, data, bytes);
+        }
+        return;
+    }
+    if (stream.frame->size() + bytes > kMaxFrameSize) {
+        WarnL << "Too large ps frame: " << stream.frame->size() + bytes << ", stream id: " << _cur_id;
+        flushFrame(_cur_id, stream);
+    }
+    stream.frame->append((char *)data, bytes);
+    if (!stream.video && end) {
+        flushFrame(_cur_id, stream);
+    }
+}
+
+void PSDecoder::flushFrame(int stream_id, Stream &stream) {
+    if (!stream.frame->size()) {
+        return;
+    }
+    auto frame = std::move(stream.frame);
+    stream.frame = std::make_shared<BufferLikeString>();
+    // 按上一帧的大小预分配，避免拼接时反复扩容
+    stream.frame->reserve(frame->size());
+    if (_on_decode_buffer) {
+        _on_decode_buffer(stream_id, stream.codecid, 0, stream.pts, stream.dts, frame);
+    } else if (_on_decode) {
+        _on_decode(stream_id, stream.codecid, 0, stream.pts, stream.dts, frame->data(), frame->size());
+    }
+}
+
 const char *PSDecoder::onSearchPacketTail(const char *data, size_t len) {
     try {
         auto ret = ps_demuxer_input(static_cast<struct ps_demuxer_t *>(_ps_demuxer), reinterpret_cast<const uint8_t *>(data), len);
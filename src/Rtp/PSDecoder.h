@@ -13,12 +13,15 @@
 
 #if defined(ENABLE_RTPPROXY)
 #include <stdint.h>
+#include <unordered_map>
 #include "Decoder.h"
 #include "Http/HttpRequestSplitter.h"
 
 namespace mediakit{
 
 //ps解析器
+//默认使用内置的快速解析流程：按起始码逐个解析pack/psm/pes头，pes负载直接拼接为帧(音频完整时直接引用输入数据)，
+//不经过HttpRequestSplitter与libmpeg的中间缓存；流中一直没有psm(无法确定编码格式)时回退到libmpeg解析
 class PSDecoder : public Decoder, private HttpRequestSplitter {
 public:
     PSDecoder();
@@ -33,6 +36,39 @@ private:
     ssize_t onRecvHeader(const char *, size_t) override { return 0; };
 
 private:
+    struct Stream {
+        bool video = false;
+        int codecid = 0;
+        int64_t pts = 0;
+        int64_t dts = 0;
+        // 拼接中的帧
+        std::shared_ptr<toolkit::BufferLikeString> frame;
+    };
+
+    void inputFast(const uint8_t *data, size_t bytes);
+    /**
+     * 解析一个pack/psm/pes等单元的头部
+     * @return 头部长度；数据不够时返回0，不是合法的起始码时返回-1
+     */
+    ssize_t parseHeader(const uint8_t *data, size_t bytes);
+    void parsePSM(const uint8_t *data, size_t bytes);
+    void onPesHeader(Stream &stream, bool has_stamp, int64_t pts, int64_t dts);
+    void onPesPayload(const uint8_t *data, size_t bytes, bool end);
+    void flushFrame(int stream_id, Stream &stream);
+
+private:
+    bool _fast_demux = true;
+    bool _have_psm = false;
+    // 收到psm前的音视频pes个数
+    size_t _pes_without_psm = 0;
+    // 当前pes剩余的负载长度
+    size_t _payload_left = 0;
+    // 当前pes所属的流，为空时丢弃负载
+    int _cur_id = -1;
+    Stream *_cur = nullptr;
+    // 跨输入的不完整头部
+    std::string _header_cache;
+    std::unordered_map<int, Stream> _streams;
     void *_ps_demuxer = nullptr;
 };
 
@@ -20,8 +20,8 @@ RtpCache::RtpCache(onFlushed cb) {
     _cb = std::move(cb);
 }
 
-void RtpCache::onFlush(std::shared_ptr<List<Buffer::Ptr>> rtp_list, bool) {
-    _cb(std::move(rtp_list));
+void RtpCache::onFlush(std::shared_ptr<List<Buffer::Ptr>> rtp_list, bool key_pos) {
+    _cb(std::move(rtp_list), key_pos);
 }
 
 void RtpCache::input(uint64_t stamp, Buffer::Ptr buffer, bool is_key) {
@@ -33,6 +33,10 @@ void RtpCachePS::flush() {
     RtpCache::flush();
 }
 
+void RtpCachePS::inputMpeg(const Buffer::Ptr &buffer, uint64_t stamp, bool key_pos) {
+    PSEncoderImp::onWrite(buffer, stamp, key_pos);
+}
+
 void RtpCachePS::onRTP(Buffer::Ptr buffer, bool is_key) {
     auto rtp = std::static_pointer_cast<RtpPacket>(buffer);
     auto stamp = rtp->getStampMS();
@@ -50,6 +54,58 @@ void RtpCacheRaw::onRTP(Buffer::Ptr buffer, bool is_key) {
     input(stamp, std::move(buffer), is_key);
 }
 
+RtpCacheShared::RtpCacheShared(const MediaSourceEvent::SendRtpArgs &args, RingType::onReaderChanged cb) {
+    _only_audio = args.only_audio;
+    _ring = std::make_shared<RingType>(1024, std::move(cb));
+    auto lam = [this](std::shared_ptr<List<Buffer::Ptr>> list, bool key_pos) {
+        // 没有视频时，设置is_key为true，目的是关闭gop缓存
+        _ring->write(std::move(list), key_pos || !_have_video);
+    };
+    // ssrc由各推流目标发送时改写
+    switch (args.data_type) {
+        case MediaSourceEvent::SendRtpArgs::kRtpPS: _encoder = std::make_shared<RtpCachePS>(lam, 0, args.pt, true); break;
+        case MediaSourceEvent::SendRtpArgs::kRtpES: _encoder = std::make_shared<RtpCacheRaw>(lam, 0, args.pt, args.only_audio); break;
+        default: CHECK(0, "invalid shared rtp type: " + std::to_string(args.data_type)); break;
+    }
+}
+
+bool RtpCacheShared::isSupported(const MediaSourceEvent::SendRtpArgs &args) {
+    return args.data_type == MediaSourceEvent::SendRtpArgs::kRtpPS || args.data_type == MediaSourceEvent::SendRtpArgs::kRtpES;
+}
+
+std::string RtpCacheShared::getKey(const MediaSourceEvent::SendRtpArgs &args) {
+    return std::to_string(args.data_type) + ":" + std::to_string(args.pt) + ":" + std::to_string(args.only_audio);
+}
+
+bool RtpCacheShared::addTrack(const Track::Ptr &track) {
+    if (_only_audio && track->getTrackType() == TrackVideo) {
+        // 如果只发送音频则忽略视频
+        return false;
+    }
+    _have_video = track->getTrackType() == TrackVideo || _have_video;
+    return _encoder->addTrack(track);
+}
+
+void RtpCacheShared::addTrackCompleted() {
+    _encoder->addTrackCompleted();
+}
+
+void RtpCacheShared::resetTracks() {
+    _have_video = false;
+    _encoder->resetTracks();
+}
+
+bool RtpCacheShared::inputFrame(const Frame::Ptr &frame) {
+    if (_only_audio && frame->getTrackType() == TrackVideo) {
+        return false;
+    }
+    return _encoder->inputFrame(frame);
+}
+
+void RtpCacheShared::flush() {
+    _encoder->flush();
+}
+
 }//namespace mediakit
 
 #endif//#if defined(ENABLE_RTPPROXY)
\ No newline at end of file
@@ -16,12 +16,14 @@
 #include "PSEncoder.h"
 #include "RawEncoder.h"
 #include "Common/PacketCache.h"
+#include "Common/MediaSource.h"
+#include "Util/RingBuffer.h"
 
 namespace mediakit{
 
 class RtpCache : protected PacketCache<toolkit::Buffer> {
 public:
-    using onFlushed = std::function<void(std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> >)>;
+    using onFlushed = std::function<void(std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> >, bool key_pos)>;
     RtpCache(onFlushed cb);
 
 protected:
@@ -45,6 +47,11 @@ public:
 
     void flush() override;
 
+    /**
+     * 直接输入已经复用好的ts/ps数据(来自共享复用器)，不再经过本对象的复用器
+     */
+    void inputMpeg(const toolkit::Buffer::Ptr &buffer, uint64_t stamp, bool key_pos);
+
 protected:
     void onRTP(toolkit::Buffer::Ptr rtp, bool is_key = false) override;
 };
@@ -58,6 +65,51 @@ protected:
     void onRTP(toolkit::Buffer::Ptr rtp, bool is_key = false) override;
 };
 
+/**
+ * 多个rtp推流目标共享的ps/es rtp打包器
+ * 打包格式(ps/es、pt、是否只推音频)相同的推流只复用打包一次，rtp包通过环形缓存分发给各目标，
+ * 各目标发送时只改写rtp头中的ssrc与seq，见RtpSender::inputSharedRtp
+ */
+class RtpCacheShared : public MediaSinkInterface {
+public:
+    using Ptr = std::shared_ptr<RtpCacheShared>;
+    using RingDataType = std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> >;
+    using RingType = toolkit::RingBuffer<RingDataType>;
+
+    /**
+     * @param args 推流参数，只使用其中的打包格式
+     * @param cb 环形缓存读取者个数变化回调
+     */
+    RtpCacheShared(const MediaSourceEvent::SendRtpArgs &args, RingType::onReaderChanged cb);
+
+    /**
+     * 该推流是否可以共享打包器，ts推流已经共享ts复用器，不在此列
+     */
+    static bool isSupported(const MediaSourceEvent::SendRtpArgs &args);
+
+    /**
+     * 打包格式相同的推流返回相同的键
+     */
+    static std::string getKey(const MediaSourceEvent::SendRtpArgs &args);
+
+    bool addTrack(const Track::Ptr &track) override;
+    void addTrackCompleted() override;
+    void resetTracks() override;
+    bool inputFrame(const Frame::Ptr &frame) override;
+    void flush() override;
+
+    /**
+     * 获取rtp包的环形缓存，数据为rtp over tcp形式的RtpPacket列表，ssrc为0
+     */
+    const RingType::Ptr &getRing() const { return _ring; }
+
+private:
+    bool _only_audio;
+    bool _have_video = false;
+    MediaSinkInterface::Ptr _encoder;
+    RingType::Ptr _ring;
+};
+
 } //namespace mediakit
 
 #endif//ENABLE_RTPPROXY
@@ -39,7 +39,7 @@ void RtpSender::startSend(const MediaSourceEvent::SendRtpArgs &args, const funct
     _args = args;
     if (!_interface) {
         //重连时不重新创建对象
-        auto lam = [this](std::shared_ptr<List<Buffer::Ptr>> list) { onFlushRtpList(std::move(list)); };
+        auto lam = [this](std::shared_ptr<List<Buffer::Ptr>> list, bool) { onFlushRtpList(std::move(list)); };
         switch (args.data_type) {
             case MediaSourceEvent::SendRtpArgs::kRtpPS: _interface = std::make_shared<RtpCachePS>(lam, atoi(args.ssrc.data()), args.pt, true); break;
             case MediaSourceEvent::SendRtpArgs::kRtpTS: _interface = std::make_shared<RtpCachePS>(lam, atoi(args.ssrc.data()), args.pt, false); break;
@@ -297,6 +297,60 @@ bool RtpSender::inputFrame(const Frame::Ptr &frame) {
     return _is_connect ? _interface->inputFrame(frame) : false;
 }
 
+bool RtpSender::inputMpeg(const Buffer::Ptr &buffer, uint64_t stamp, bool key_pos) {
+    CHECK(_args.data_type == MediaSourceEvent::SendRtpArgs::kRtpPS || _args.data_type == MediaSourceEvent::SendRtpArgs::kRtpTS);
+    if (!_is_connect || !buffer) {
+        return false;
+    }
+    std::static_pointer_cast<RtpCachePS>(_interface)->inputMpeg(buffer, stamp, key_pos);
+    return true;
+}
+
+void RtpSender::inputSharedRtp(const std::shared_ptr<List<Buffer::Ptr>> &rtp_list) {
+    if (!_is_connect) {
+        // 连接成功后才能发送数据
+        return;
+    }
+    auto ssrc = htonl((uint32_t)atoi(_args.ssrc.data()));
+    size_t i = 0;
+    auto size = rtp_list->size();
+    rtp_list->for_each([&](const Buffer::Ptr &buf) {
+        auto rtp = static_cast<RtpPacket *>(buf.get());
+        auto flush = ++i == size;
+        switch (_args.con_type) {
+            case MediaSourceEvent::SendRtpArgs::kUdpActive:
+            case MediaSourceEvent::SendRtpArgs::kUdpPassive: {
+                // udp模式每个rtp包必须是一个完整的数据报，只能拷贝后改写rtp头
+                auto packet = RtpPacket::create();
+                packet->assign(rtp->data(), rtp->size());
+                packet->type = rtp->type;
+                packet->sample_rate = rtp->sample_rate;
+                packet->ntp_stamp = rtp->ntp_stamp;
+                auto header = packet->getHeader();
+                header->seq = htons(_seq++);
+                header->ssrc = ssrc;
+                onSendRtpUdp(packet, i == 1);
+                _socket_rtp->send(std::make_shared<BufferRtp>(std::move(packet), RtpPacket::kRtpTcpHeaderSize), nullptr, 0, flush);
+                break;
+            }
+            case MediaSourceEvent::SendRtpArgs::kTcpActive:
+            case MediaSourceEvent::SendRtpArgs::kTcpPassive: {
+                // tcp模式只拷贝2个字节的长度与rtp固定头并改写，负载部分与其他推流目标共享
+                auto header_size = 2 + RtpPacket::kRtpHeaderSize;
+                auto header = BufferRaw::create();
+                header->assign(rtp->data() + 2, header_size);
+                auto rtp_header = (RtpHeader *)(header->data() + 2);
+                rtp_header->seq = htons(_seq++);
+                rtp_header->ssrc = ssrc;
+                _socket_rtp->send(std::move(header), nullptr, 0, false);
+                _socket_rtp->send(std::make_shared<BufferRtp>(buf, 2 + header_size), nullptr, 0, flush);
+                break;
+            }
+            default: CHECK(0);
+        }
+    });
+}
+
 void RtpSender::onSendRtpUdp(const toolkit::Buffer::Ptr &buf, bool check) {
     if (!_socket_rtcp) {
         return;
@@ -41,6 +41,17 @@ public:
      */
     bool inputFrame(const Frame::Ptr &frame) override;
 
+    /**
+     * 输入共享复用器产生的ts/ps数据，仅限ps/ts类型的推流，且不再调用inputFrame
+     */
+    bool inputMpeg(const toolkit::Buffer::Ptr &buffer, uint64_t stamp, bool key_pos);
+
+    /**
+     * 输入共享打包器(RtpCacheShared)产生的rtp包，改写ssrc与seq后发送，不再调用inputFrame
+     * @param rtp_list rtp over tcp形式的RtpPacket列表
+     */
+    void inputSharedRtp(const std::shared_ptr<toolkit::List<toolkit::Buffer::Ptr> > &rtp_list);
+
     /**
      * 刷新输出frame缓存
      */
@@ -82,6 +93,8 @@ private:
 
 private:
     bool _is_connect = false;
+    // 使用共享打包器时本目标的rtp seq
+    uint16_t _seq = 0;
     MediaSourceEvent::SendRtpArgs _args;
     toolkit::Socket::Ptr _socket_rtp;
     toolkit::Socket::Ptr _socket_rtcp;
@@ -145,28 +145,41 @@ void RtpSession::onRtpPacket(const char *data, size_t len) {
     _ticker.resetTime();
 }
 
-static const char *findSSRC(const char *data, ssize_t len, uint32_t ssrc) {
+// memchr在主流平台上为simd实现，先定位特征字节再比对完整的4个字节，避免逐字节比对
+static const char *findBytes(const char *data, ssize_t len, const uint8_t (&bytes)[4], size_t anchor) {
     // rtp前面必须预留两个字节的长度字段
-    for (ssize_t i = 2; i <= len - 4; ++i) {
-        auto ptr = (const uint8_t *)data + i;
-        if (ptr[0] == (ssrc >> 24) && ptr[1] == ((ssrc >> 16) & 0xFF) && ptr[2] == ((ssrc >> 8) & 0xFF)
-            && ptr[3] == (ssrc & 0xFF)) {
-            return (const char *)ptr;
+    if (len < 2 + 4) {
+        return nullptr;
+    }
+    auto ptr = (const uint8_t *)data + 2 + anchor;
+    auto end = (const uint8_t *)data + len - 4 + anchor + 1;
+    while (ptr < end) {
+        ptr = (const uint8_t *)memchr(ptr, bytes[anchor], end - ptr);
+        if (!ptr) {
+            return nullptr;
         }
+        if (memcmp(ptr - anchor, bytes, 4) == 0) {
+            return (const char *)(ptr - anchor);
+        }
+        ++ptr;
     }
     return nullptr;
 }
 
-static const char *findPsHeaderFlag(const char *data, ssize_t len) {
-    for (ssize_t i = 2; i <= len - 4; ++i) {
-        auto ptr = (const uint8_t *)data + i;
-        // PsHeader 0x000001ba、PsSystemHeader0x000001bb（关键帧标识）
-        if (ptr[0] == (0x00) && ptr[1] == (0x00) && ptr[2] == (0x01) && ptr[3] == (0xbb)) {
-            return (const char *)ptr;
-        }
+static const char *findSSRC(const char *data, ssize_t len, uint32_t ssrc) {
+    const uint8_t bytes[4] = { (uint8_t)(ssrc >> 24), (uint8_t)(ssrc >> 16), (uint8_t)(ssrc >> 8), (uint8_t)ssrc };
+    // 以ssrc中第一个非0字节定位，0在负载中出现的频率太高
+    size_t anchor = 0;
+    while (anchor < 3 && !bytes[anchor]) {
+        ++anchor;
     }
+    return findBytes(data, len, bytes, anchor);
+}
 
-    return nullptr;
+static const char *findPsHeaderFlag(const char *data, ssize_t len) {
+    // PsHeader 0x000001ba、PsSystemHeader0x000001bb（关键帧标识）
+    static const uint8_t bytes[4] = { 0x00, 0x00, 0x01, 0xbb };
+    return findBytes(data, len, bytes, 3);
 }
 
 // rtp长度到ssrc间的长度固定为10
@@ -140,7 +140,7 @@ RtpMultiCaster::RtpMultiCaster(SocketHelper &helper, const string &local_ip, con
         auto size = pkt->size();
         pkt->for_each([&](const RtpPacket::Ptr &rtp) {
             auto &sock = _udp_sock[rtp->type];
-            sock->send(std::make_shared<BufferRtp>(rtp, 4), nullptr, 0, ++i == size);
+            sock->send(RtpPacket::getUdpBuffer(rtp), nullptr, 0, ++i == size);
         });
     });
 
@@ -80,10 +80,15 @@ RtpPacket::Ptr RtpTrack::inputRtp(TrackType type, int sample_rate, uint8_t *ptr,
         _ssrc_alive.resetTime();
     }
 
-    auto rtp = RtpPacket::create();
+    RtpPacket::Ptr rtp;
     //需要添加4个字节的rtp over tcp头
-    rtp->setCapacity(RtpPacket::kRtpTcpHeaderSize + len);
-    rtp->setSize(RtpPacket::kRtpTcpHeaderSize + len);
+    if (_packet_block) {
+        rtp = _packet_block->obtain(RtpPacket::kRtpTcpHeaderSize + len);
+    } else {
+        rtp = RtpPacket::create();
+        rtp->setCapacity(RtpPacket::kRtpTcpHeaderSize + len);
+        rtp->setSize(RtpPacket::kRtpTcpHeaderSize + len);
+    }
     rtp->sample_rate = sample_rate;
     rtp->type = type;
 
@@ -118,6 +123,10 @@ void RtpTrack::setPayloadType(uint8_t pt) {
     _pt = pt;
 }
 
+void RtpTrack::setPacketBlock(RtpPacketBlock::Ptr block) {
+    _packet_block = std::move(block);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////
 
 void RtpTrackImp::setOnSorted(OnSorted cb) {
@@ -12,9 +12,14 @@
 #define ZLMEDIAKIT_RTPRECEIVER_H
 
 #include <map>
+#include <limits>
 #include <string>
+#include <vector>
 #include <memory>
+#include <algorithm>
+#include <functional>
 #include "Rtsp/Rtsp.h"
+#include "Common/config.h"
 #include "Extension/Frame.h"
 // for NtpStamp
 #include "Common/Stamp.h"
@@ -22,11 +27,18 @@
 
 namespace mediakit {
 
+/**
+ * rtp排序(抖动缓冲)
+ * 缓存为2的幂大小的环形数组，按seq & mask索引，并用位图标记占用的槽位，插入与顺序输出均为O(1)
+ * 缓存只保存距离下一个待输出seq不超过max_distance的包，回环时按seq差值的符号判断先后；
+ * 连续收到多个seq连续且回退距离超过max_distance的包时认为seq重新开始
+ */
 template<typename T, typename SEQ = uint16_t>
 class PacketSortor {
 public:
     static constexpr SEQ SEQ_MAX = (std::numeric_limits<SEQ>::max)();
-    using iterator = typename std::map<SEQ, T>::iterator;
+    // 连续收到该个数seq连续且回退距离超过max_distance的包时，认为seq重新开始
+    static constexpr size_t kRestartCount = 16;
 
     virtual ~PacketSortor() = default;
 
@@ -37,14 +49,15 @@ public:
      */
     void clear() {
         _started = false;
+        _restart_list.clear();
         _ticker.resetTime();
-        _pkt_sort_cache_map.clear();
+        clearCache();
     }
 
     /**
      * 获取排序缓存长度
      */
-    size_t getJitterSize() const { return _pkt_sort_cache_map.size(); }
+    size_t getJitterSize() const { return _size; }
 
     /**
      * 输入并排序
@@ -61,104 +74,170 @@ public:
         auto next_seq = static_cast<SEQ>(_last_seq_out + 1);
         if (seq == next_seq) {
             // 收到下一个seq
+            _restart_list.clear();
             output(seq, std::move(packet));
             // 清空连续包列表
             flushPacket();
             return;
         }
 
-        if (seq < next_seq && !mayLooped(next_seq, seq)) {
-            // 无回环风险, 过滤seq回退包
+        auto dis = static_cast<SEQ>(seq - next_seq);
+        if (dis > SEQ_MAX >> 1) {
+            // seq回退包(已考虑回环)
+            if (static_cast<SEQ>(next_seq - seq) <= _max_distance) {
+                // 迟到或重复的包，过滤
+                _restart_list.clear();
+                return;
+            }
+            onRestartCandidate(seq, std::move(packet));
             return;
         }
-        _pkt_sort_cache_map.emplace(seq, std::move(packet));
+        _restart_list.clear();
+        if (dis > _max_distance) {
+            if (!_size) {
+                // seq跳跃太大且没有缓存，直接把这个包当做next_seq
+                output(seq, std::move(packet));
+                return;
+            }
+            // 先输出缓存中最近的包
+            forceFlush();
+            next_seq = static_cast<SEQ>(_last_seq_out + 1);
+            dis = static_cast<SEQ>(seq - next_seq);
+            if (dis > _max_distance) {
+                // 距离仍然太大，丢弃
+                return;
+            }
+            if (seq == next_seq) {
+                output(seq, std::move(packet));
+                flushPacket();
+                return;
+            }
+        }
+        insert(seq, std::move(packet));
 
-        if (needForceFlush(seq)) {
-            forceFlush(next_seq);
+        if (_size > _max_buffer_size || _ticker.elapsedTime() > _max_buffer_ms) {
+            forceFlush();
         }
     }
 
     void flush() {
-        if (!_pkt_sort_cache_map.empty()) {
-            forceFlush(static_cast<SEQ>(_last_seq_out + 1));
-            _pkt_sort_cache_map.clear();
+        if (_size) {
+            forceFlush();
+            clearCache();
         }
     }
 
     void setParams(size_t max_buffer_size, size_t max_buffer_ms, size_t max_distance) {
         _max_buffer_size = max_buffer_size;
         _max_buffer_ms = max_buffer_ms;
-        _max_distance = max_distance;
+        _max_distance = (std::min)(max_distance, static_cast<size_t>(SEQ_MAX >> 1));
+        if (_slots.size() != getCapacity()) {
+            // 窗口大小改变，丢弃缓存并在下次插入时重新分配
+            clearCache();
+            _slots.clear();
+            _bitmap.clear();
+        }
     }
 
 private:
-    SEQ distance(SEQ seq) {
-        SEQ ret;
-        auto next_seq = static_cast<SEQ>(_last_seq_out + 1);
-        if (seq > next_seq) {
-            ret = seq - next_seq;
-        } else {
-            ret = next_seq - seq;
-        }
-        if (ret > SEQ_MAX >> 1) {
-            return SEQ_MAX - ret;
+    // 能容纳max_distance的2的幂，至少为一个位图字
+    size_t getCapacity() const {
+        size_t capacity = 64;
+        while (capacity <= _max_distance) {
+            capacity <<= 1;
         }
-        return ret;
-    }
-
-    bool needForceFlush(SEQ seq) {
-        return !_pkt_sort_cache_map.empty() && (_pkt_sort_cache_map.size() > _max_buffer_size ||
-               distance(seq) > _max_distance || _ticker.elapsedTime() > _max_buffer_ms);
+        return capacity;
     }
 
-    //外部调用代码确保_pkt_sort_cache_map不为空
-    void forceFlush(SEQ next_seq) {
-        // 寻找距离比next_seq大的最近的seq
-        auto it = _pkt_sort_cache_map.lower_bound(next_seq);
-        if (it == _pkt_sort_cache_map.end()) {
-            // 没有比next_seq更大的seq，应该是回环时丢包导致
-            it = _pkt_sort_cache_map.begin();
+    // 回退距离过大的包可能是迟到的重传包，也可能是推流端重启(例如国标重新invite)导致seq重新开始；
+    // 只有连续收到多个seq连续的此类包(中间没有其他包)时才认为seq重新开始，否则丢弃
+    void onRestartCandidate(SEQ seq, T packet) {
+        if (!_restart_list.empty() && static_cast<SEQ>(_restart_list.back().first + 1) != seq) {
+            _restart_list.clear();
         }
-        // 丢包无法恢复，把这个包当做next_seq
-        popIterator(it);
-        // 清空连续包列表
-        flushPacket();
-        // 删除距离next_seq太大的包
-        for (auto it = _pkt_sort_cache_map.begin(); it != _pkt_sort_cache_map.end();) {
-            if (distance(it->first) > _max_distance) {
-                it = _pkt_sort_cache_map.erase(it);
-            } else {
-                ++it;
-            }
+        _restart_list.emplace_back(seq, std::move(packet));
+        if (_restart_list.size() < kRestartCount) {
+            return;
+        }
+        WarnL << "seq restarted: " << static_cast<SEQ>(_last_seq_out + 1) << " -> " << _restart_list.front().first;
+        auto restart_list = std::move(_restart_list);
+        flush();
+        clear();
+        for (auto &pr : restart_list) {
+            sortPacket(pr.first, std::move(pr.second));
         }
     }
 
-    bool mayLooped(SEQ last_seq, SEQ now_seq) { return last_seq > SEQ_MAX - _max_distance || now_seq < _max_distance; }
+    size_t toIndex(SEQ seq) const { return static_cast<size_t>(seq) & _mask; }
 
-    void flushPacket() {
-        if (_pkt_sort_cache_map.empty()) {
-            return;
+    bool testBit(size_t index) const { return (_bitmap[index >> 6] >> (index & 63)) & 1; }
+
+    void insert(SEQ seq, T packet) {
+        if (_slots.empty()) {
+            auto capacity = getCapacity();
+            _mask = capacity - 1;
+            _slots.resize(capacity);
+            _bitmap.assign(capacity >> 6, 0);
         }
-        auto next_seq = static_cast<SEQ>(_last_seq_out + 1);
-        auto it = _pkt_sort_cache_map.lower_bound(next_seq);
-        if (!mayLooped(next_seq, next_seq)) {
-            // 无回环风险, 清空 < next_seq的值
-            it = _pkt_sort_cache_map.erase(_pkt_sort_cache_map.begin(), it);
+        auto index = toIndex(seq);
+        if (testBit(index)) {
+            // 重复包
+            return;
         }
+        _slots[index] = std::move(packet);
+        _bitmap[index >> 6] |= uint64_t(1) << (index & 63);
+        ++_size;
+    }
 
-        while (it != _pkt_sort_cache_map.end()) {
-            // 找到下一个包
-            if (it->first == static_cast<SEQ>(_last_seq_out + 1)) {
-                it = popIterator(it);
+    // 外部调用代码确保_size不为0
+    void forceFlush() {
+        // 从next_seq对应的槽位开始循环查找最近的包，按位图每次跳过64个槽位
+        auto next_seq = static_cast<SEQ>(_last_seq_out + 1);
+        auto start = toIndex(next_seq);
+        for (size_t offset = 0; offset <= _mask;) {
+            auto index = (start + offset) & _mask;
+            auto word = _bitmap[index >> 6] >> (index & 63);
+            if (!word) {
+                offset += 64 - (index & 63);
                 continue;
             }
+            while (!(word & 1)) {
+                word >>= 1;
+                ++offset;
+            }
+            // 丢包无法恢复，把这个包当做next_seq
+            pop(static_cast<SEQ>(next_seq + offset));
             break;
         }
+        // 清空连续包列表
+        flushPacket();
     }
 
-    iterator popIterator(iterator it) {
-        output(it->first, std::move(it->second));
-        return _pkt_sort_cache_map.erase(it);
+    void flushPacket() {
+        while (_size) {
+            auto next_seq = static_cast<SEQ>(_last_seq_out + 1);
+            if (!testBit(toIndex(next_seq))) {
+                break;
+            }
+            // 找到下一个包
+            pop(next_seq);
+        }
+    }
+
+    void pop(SEQ seq) {
+        auto index = toIndex(seq);
+        _bitmap[index >> 6] &= ~(uint64_t(1) << (index & 63));
+        --_size;
+        output(seq, std::move(_slots[index]));
+    }
+
+    void clearCache() {
+        if (!_size) {
+            return;
+        }
+        _size = 0;
+        std::fill(_slots.begin(), _slots.end(), T());
+        std::fill(_bitmap.begin(), _bitmap.end(), 0);
     }
 
     void output(SEQ seq, T packet) {
@@ -166,7 +245,7 @@ private:
         if (seq != next_seq) {
             WarnL << "packet dropped: " << next_seq << " -> " << static_cast<SEQ>(seq - 1)
                   << ", latest seq: " << _latest_seq
-                  << ", jitter buffer size: " << _pkt_sort_cache_map.size()
+                  << ", jitter buffer size: " << _size
                   << ", jitter buffer ms: " << _ticker.elapsedTime();
         }
         _last_seq_out = seq;
@@ -176,6 +255,8 @@ private:
 
 private:
     bool _started = false;
+    // 疑似seq重新开始的连续包
+    std::vector<std::pair<SEQ, T>> _restart_list;
     // 排序缓存最大保存数据长度，单位毫秒
     size_t _max_buffer_ms = 1000;
     // 排序缓存最大保存数据个数
@@ -188,8 +269,13 @@ private:
     SEQ _latest_seq = 0;
     // 下次应该输出的SEQ
     SEQ _last_seq_out = 0;
-    // pkt排序缓存，根据seq排序
-    std::map<SEQ, T> _pkt_sort_cache_map;
+    // 缓存的包个数
+    size_t _size = 0;
+    size_t _mask = 0;
+    // pkt排序缓存，按seq & _mask索引，首次插入时分配
+    std::vector<T> _slots;
+    // 槽位占用位图
+    std::vector<uint64_t> _bitmap;
     // 回调
     std::function<void(SEQ seq, T packet)> _cb;
 };
@@ -210,6 +296,12 @@ public:
     void setNtpStamp(uint32_t rtp_stamp, uint64_t ntp_stamp_ms);
     void setPayloadType(uint8_t pt);
 
+    /**
+     * 设置rtp接收内存池，设置后rtp包从内存池中分配，不再单独分配内存
+     * 多个track可以共享同一个内存池
+     */
+    void setPacketBlock(RtpPacketBlock::Ptr block);
+
 protected:
     virtual void onRtpSorted(RtpPacket::Ptr rtp) {}
     virtual void onBeforeRtpSorted(const RtpPacket::Ptr &rtp) {}
@@ -220,6 +312,7 @@ private:
     uint32_t _ssrc = 0;
     toolkit::Ticker _ssrc_alive;
     NtpStamp _ntp_stamp;
+    RtpPacketBlock::Ptr _packet_block;
 };
 
 class RtpTrackImp : public RtpTrack{
@@ -253,6 +346,14 @@ public:
             });
             ++index;
         }
+        GET_CONFIG(size_t, rtp_block_kb, Rtsp::kRtpBlockKB);
+        if (rtp_block_kb) {
+            // 所有track共享同一个接收内存池，使音视频交错的rtp包在内存中也首尾相连
+            auto block = std::make_shared<RtpPacketBlock>(rtp_block_kb * 1024);
+            for (auto &track : _track) {
+                track.setPacketBlock(block);
+            }
+        }
     }
 
     virtual ~RtpMultiReceiver() = default;
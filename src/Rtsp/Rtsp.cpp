@@ -651,6 +651,80 @@ RtpPacket::Ptr RtpPacket::create() {
 #endif
 }
 
+RtpPacket::Ptr RtpPacket::create(Buffer::Ptr block, char *data, size_t size) {
+    auto ret = create();
+    ret->_view_data = data;
+    ret->_view_size = size;
+    ret->_block = std::move(block);
+    return ret;
+}
+
+Buffer::Ptr RtpPacket::getUdpBuffer(const Ptr &rtp) {
+    // 别名构造，引用计数与rtp包共享
+    return Buffer::Ptr(rtp, &rtp->_udp_view);
+}
+
+const Buffer::Ptr &RtpPacketList::getTcpBuffer() const {
+    std::call_once(_tcp_buffer_flag, [this]() {
+        if (size() == 1) {
+            // 只有一个包，无需合并
+            _tcp_buffer = front();
+            return;
+        }
+        auto &block = front()->getBlock();
+        if (block) {
+            // 同一接收内存块中首尾相连的rtp包，直接引用该内存块
+            auto begin = front()->data();
+            auto end = begin;
+            for (auto &rtp : *this) {
+                if (rtp->getBlock() != block || rtp->data() != end) {
+                    end = nullptr;
+                    break;
+                }
+                end += rtp->size();
+            }
+            if (end) {
+                _tcp_buffer = std::make_shared<BufferOffset<Buffer::Ptr> >(block, begin - block->data(), end - begin);
+                return;
+            }
+        }
+        size_t total = 0;
+        for (auto &rtp : *this) {
+            total += rtp->size();
+        }
+        auto buffer = BufferRaw::create();
+        buffer->setCapacity(total + 1);
+        auto ptr = buffer->data();
+        for (auto &rtp : *this) {
+            memcpy(ptr, rtp->data(), rtp->size());
+            ptr += rtp->size();
+        }
+        buffer->setSize(total);
+        _tcp_buffer = std::move(buffer);
+    });
+    return _tcp_buffer;
+}
+
+RtpPacket::Ptr RtpPacketBlock::obtain(size_t size) {
+    if (size * 4 > _block_size) {
+        // 大包单独分配内存，避免内存块剩余空间浪费过多
+        auto rtp = RtpPacket::create();
+        rtp->setCapacity(size);
+        rtp->setSize(size);
+        return rtp;
+    }
+    if (!_block || _offset + size > _block_size) {
+        // 旧内存块由引用它的rtp包保持，rtp包全部释放后自动回收
+        _block = BufferRaw::create();
+        _block->setCapacity(_block_size);
+        _block->setSize(_block_size);
+        _offset = 0;
+    }
+    auto rtp = RtpPacket::create(_block, _block->data() + _offset, size);
+    _offset += size;
+    return rtp;
+}
+
 /**
  * 构造title类型sdp
  * @param dur_sec rtsp点播时长，0代表直播，单位秒
@@ -14,7 +14,9 @@
 #include "Common/macros.h"
 #include "Extension/Frame.h"
 #include "Network/Socket.h"
+#include "Util/List.h"
 #include <memory>
+#include <mutex>
 #include <string.h>
 #include <string>
 #include <unordered_map>
@@ -170,15 +172,107 @@ public:
 
     static Ptr create();
 
+    /**
+     * 创建引用接收内存块的rtp包，rtp包不单独分配内存，也不拷贝数据
+     * 该rtp包的长度固定，不能再调用setCapacity/setSize
+     * @param block 内存块，rtp包存在期间保持对其引用
+     * @param data rtp over tcp数据起始地址(包含4个字节的tcp头)，必须位于内存块中
+     * @param size 数据长度
+     */
+    static Ptr create(toolkit::Buffer::Ptr block, char *data, size_t size);
+
+    char *data() const override { return _block ? _view_data : BufferRaw::data(); }
+    size_t size() const override { return _block ? _view_size : BufferRaw::size(); }
+
+    /**
+     * 获取引用的接收内存块，单独分配内存的rtp包返回空
+     */
+    const toolkit::Buffer::Ptr &getBlock() const { return _block; }
+
+    /**
+     * 获取rtp over udp形式的buffer(跳过前4个字节的rtp over tcp头)
+     * 返回的buffer与rtp包共享所有权，无需额外内存分配，可被多个udp播放器复用
+     */
+    static toolkit::Buffer::Ptr getUdpBuffer(const Ptr &rtp);
+
 private:
     friend class toolkit::ResourcePool_l<RtpPacket>;
     RtpPacket() = default;
 
 private:
+    // 内嵌的rtp over udp视图，指向本对象跳过前4个字节后的数据
+    class BufferUdpView : public toolkit::Buffer {
+    public:
+        BufferUdpView(RtpPacket *rtp) : _rtp(rtp) {}
+        char *data() const override { return _rtp->data() + RtpPacket::kRtpTcpHeaderSize; }
+        size_t size() const override { return _rtp->size() - RtpPacket::kRtpTcpHeaderSize; }
+
+    private:
+        RtpPacket *_rtp;
+    };
+
+    BufferUdpView _udp_view { this };
+    // 引用接收内存块时的数据区域
+    char *_view_data = nullptr;
+    size_t _view_size = 0;
+    toolkit::Buffer::Ptr _block;
     // 对象个数统计
     toolkit::ObjectStatistic<RtpPacket> _statistic;
 };
 
+/**
+ * rtp包列表，即RtspMediaSource环形缓存中的一个数据单元
+ * 支持把列表内所有rtp over tcp包合并成一块连续内存，供多个rtsp/tcp播放器共享发送
+ */
+class RtpPacketList : public toolkit::List<RtpPacket::Ptr> {
+public:
+    using Ptr = std::shared_ptr<RtpPacketList>;
+
+    /**
+     * 获取合并后的rtp over tcp数据，每个包已经包含$、interleaved、长度前缀
+     * 首次调用时生成，之后所有播放器共享同一块内存；线程安全
+     * 所有rtp包在同一接收内存块中首尾相连时直接引用该内存块，不再拷贝
+     */
+    const toolkit::Buffer::Ptr &getTcpBuffer() const;
+
+    /**
+     * 列表是否以视频关键帧开始
+     */
+    bool isKeyPos() const { return _key_pos; }
+    void setKeyPos(bool key_pos) { _key_pos = key_pos; }
+
+private:
+    bool _key_pos = false;
+    mutable std::once_flag _tcp_buffer_flag;
+    mutable toolkit::Buffer::Ptr _tcp_buffer;
+};
+
+/**
+ * rtp接收内存池，连续收到的rtp包依次拷贝到同一内存块中，rtp包只引用该内存块而不再单独分配内存
+ * 同一内存块中首尾相连的rtp包合并发送时可直接引用该内存块，见RtpPacketList::getTcpBuffer
+ * 非线程安全，应该在接收rtp的线程中使用
+ */
+class RtpPacketBlock {
+public:
+    using Ptr = std::shared_ptr<RtpPacketBlock>;
+
+    /**
+     * @param block_size 内存块大小
+     */
+    RtpPacketBlock(size_t block_size) : _block_size(block_size) {}
+
+    /**
+     * 分配rtp包，大包单独分配内存，其他的从当前内存块中顺序分配
+     * @param size rtp over tcp包长度(包含4个字节的tcp头)
+     */
+    RtpPacket::Ptr obtain(size_t size);
+
+private:
+    size_t _block_size;
+    size_t _offset = 0;
+    toolkit::BufferRaw::Ptr _block;
+};
+
 class RtpPayload {
 public:
     static int getClockRate(int pt);
@@ -29,10 +29,10 @@ namespace mediakit {
  * 只要生成了这两要素，那么要实现rtsp推流、rtsp服务器就很简单了
  * rtsp推拉流协议中，先传递sdp，然后再协商传输方式(tcp/udp/组播)，最后一直传递rtp
  */
-class RtspMediaSource : public MediaSource, public toolkit::RingDelegate<RtpPacket::Ptr>, private PacketCache<RtpPacket> {
+class RtspMediaSource : public MediaSource, public toolkit::RingDelegate<RtpPacket::Ptr>, private PacketCache<RtpPacket, FlushPolicy, RtpPacketList> {
 public:
     using Ptr = std::shared_ptr<RtspMediaSource>;
-    using RingDataType = std::shared_ptr<toolkit::List<RtpPacket::Ptr> >;
+    using RingDataType = RtpPacketList::Ptr;
     using RingType = toolkit::RingBuffer<RingDataType>;
 
     /**
@@ -136,7 +136,7 @@ public:
     void onWrite(RtpPacket::Ptr rtp, bool keyPos) override;
 
     void clearCache() override{
-        PacketCache<RtpPacket>::clearCache();
+        PacketCache<RtpPacket, FlushPolicy, RtpPacketList>::clearCache();
         _ring->clearCache();
     }
 
@@ -146,7 +146,8 @@ private:
      * @param rtp_list rtp包列表
      * @param key_pos 是否包含关键帧
      */
-    void onFlush(std::shared_ptr<toolkit::List<RtpPacket::Ptr> > rtp_list, bool key_pos) override {
+    void onFlush(RtpPacketList::Ptr rtp_list, bool key_pos) override {
+        rtp_list->setKeyPos(_have_video && key_pos);
         //如果不存在视频，那么就没有存在GOP缓存的意义，所以is_key一直为true确保一直清空GOP缓存
         _ring->write(std::move(rtp_list), _have_video ? key_pos : true);
     }
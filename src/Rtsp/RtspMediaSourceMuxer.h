@@ -11,6 +11,7 @@
 #ifndef ZLMEDIAKIT_RTSPMEDIASOURCEMUXER_H
 #define ZLMEDIAKIT_RTSPMEDIASOURCEMUXER_H
 
+#include <atomic>
 #include "RtspMuxer.h"
 #include "Rtsp/RtspMediaSource.h"
 
@@ -46,6 +47,13 @@ public:
         return _media_src->readerCount();
     }
 
+    /**
+     * 媒体源是否已经注册，媒体源在第一次写入数据时注册
+     */
+    bool isRegisted() const {
+        return !!_media_src->getRing();
+    }
+
     void setTimeStamp(uint32_t stamp){
         _media_src->setTimeStamp(stamp);
     }
@@ -64,8 +72,7 @@ public:
     }
 
     bool inputFrame(const Frame::Ptr &frame) override {
-        if (_clear_cache && _option.rtsp_demand) {
-            _clear_cache = false;
+        if (_option.rtsp_demand && _clear_cache.exchange(false)) {
             _media_src->clearCache();
         }
         if (_enabled || !_option.rtsp_demand) {
@@ -76,12 +83,13 @@ public:
 
     bool isEnabled() {
         //缓存尚未清空时，还允许触发inputFrame函数，以便及时清空缓存
-        return _option.rtsp_demand ? (_clear_cache ? true : _enabled) : true;
+        return _option.rtsp_demand ? (_clear_cache || _enabled) : true;
     }
 
 private:
-    bool _enabled = true;
-    bool _clear_cache = false;
+    // 按需复用开关，在归属线程(onReaderChanged)中修改，并行复用时在复用线程中读取
+    std::atomic<bool> _enabled { true };
+    std::atomic<bool> _clear_cache { false };
     ProtocolOption _option;
     RtspMediaSource::Ptr _media_src;
 };
@@ -413,7 +413,7 @@ void RtspPusher::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
                     return;
                 }
 
-                pSock->send(std::make_shared<BufferRtp>(rtp, RtpPacket::kRtpTcpHeaderSize), nullptr, 0, ++i == size);
+                pSock->send(RtpPacket::getUdpBuffer(rtp), nullptr, 0, ++i == size);
             });
             break;
         }
@@ -64,6 +64,13 @@ void RtspSession::onError(const SockException &err) {
                 << ")断开:" << err.what()
                 << ",耗时(s):" << duration;
 
+    if (is_player && _udp_send_flushs) {
+        //rtp over udp批量发送统计，用于评估每个包平均触发的系统调用次数
+        InfoP(this) << "rtp over udp发送包数:" << _udp_send_packets
+                    << ",flush次数:" << _udp_send_flushs
+                    << ",平均每次flush包数:" << _udp_send_packets / _udp_send_flushs;
+    }
+
     if (_rtp_type == Rtsp::RTP_MULTICAST) {
         //取消UDP端口监听
         UDPServer::Instance().stopListenPeer(get_peer_ip().data(), this);
@@ -1228,9 +1235,15 @@ void RtspSession::updateRtcpContext(const RtpPacket::Ptr &rtp){
 void RtspSession::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
     switch (_rtp_type) {
         case Rtsp::RTP_TCP: {
+            if (_target_play_track == TrackInvalid) {
+                //未指定播放track时，所有tcp播放器发送的数据完全一致，直接发送共享的合并内存块
+                pkt->for_each([&](const RtpPacket::Ptr &rtp) { updateRtcpContext(rtp); });
+                send(pkt->getTcpBuffer());
+                break;
+            }
             setSendFlushFlag(false);
             pkt->for_each([&](const RtpPacket::Ptr &rtp) {
-                if (_target_play_track == TrackInvalid || _target_play_track == rtp->type) {
+                if (_target_play_track == rtp->type) {
                     updateRtcpContext(rtp);
                     send(rtp);
                 }
@@ -1244,6 +1257,8 @@ void RtspSession::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
             Socket::Ptr rtp_socks[2];
             rtp_socks[TrackVideo] = _rtp_socks[getTrackIndexByTrackType(TrackVideo)];
             rtp_socks[TrackAudio] = _rtp_socks[getTrackIndexByTrackType(TrackAudio)];
+            //本批次各socket待发送的包数
+            size_t pending[2] = {0, 0};
             pkt->for_each([&](const RtpPacket::Ptr &rtp) {
                 if (_target_play_track == TrackInvalid || _target_play_track == rtp->type) {
                     updateRtcpContext(rtp);
@@ -1253,12 +1268,16 @@ void RtspSession::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
                         return;
                     }
                     _bytes_usage += rtp->size() - RtpPacket::kRtpTcpHeaderSize;
-                    sock->send(std::make_shared<BufferRtp>(rtp, RtpPacket::kRtpTcpHeaderSize), nullptr, 0, false);
+                    //复用rtp包内嵌的udp视图，不再每包创建BufferRtp；先缓存，最后整批flush(linux下为一次sendmmsg)
+                    sock->send(RtpPacket::getUdpBuffer(rtp), nullptr, 0, false);
+                    ++pending[rtp->type];
                 }
             });
-            for (auto &sock : rtp_socks) {
-                if (sock) {
-                    sock->flushAll();
+            for (auto i = 0; i < 2; ++i) {
+                if (rtp_socks[i] && pending[i]) {
+                    rtp_socks[i]->flushAll();
+                    _udp_send_packets += pending[i];
+                    ++_udp_send_flushs;
                 }
             }
         }
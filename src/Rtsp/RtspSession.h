@@ -163,6 +163,10 @@ private:
     int _cseq = 0;
     //消耗的总流量
     uint64_t _bytes_usage = 0;
+    //rtp over udp发送的总包数
+    uint64_t _udp_send_packets = 0;
+    //rtp over udp批量flush的次数(一次flush对应一次sendmmsg系统调用)
+    uint64_t _udp_send_flushs = 0;
     //ContentBase
     std::string _content_base;
     //记录是否需要rtsp专属鉴权，防止重复触发事件
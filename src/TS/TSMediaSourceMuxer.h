@@ -11,6 +11,7 @@
 #ifndef ZLMEDIAKIT_TSMEDIASOURCEMUXER_H
 #define ZLMEDIAKIT_TSMEDIASOURCEMUXER_H
 
+#include <atomic>
 #include "TSMediaSource.h"
 #include "Record/MPEG.h"
 
@@ -43,6 +44,13 @@ public:
         return _media_src->readerCount();
     }
 
+    /**
+     * 媒体源是否已经注册，媒体源在第一次写入数据时注册
+     */
+    bool isRegisted() const {
+        return !!_media_src->getRing();
+    }
+
     void onReaderChanged(MediaSource &sender, int size) override {
         _enabled = _option.ts_demand ? size : true;
         if (!size && _option.ts_demand) {
@@ -52,19 +60,32 @@ public:
     }
 
     bool inputFrame(const Frame::Ptr &frame) override {
-        if (_clear_cache && _option.ts_demand) {
-            _clear_cache = false;
+        return prepareInput() ? MpegMuxer::inputFrame(frame) : false;
+    }
+
+    /**
+     * 使用共享ts复用器时，每帧调用一次以代替inputFrame
+     * @return 是否需要ts数据
+     */
+    bool prepareInput() {
+        if (_option.ts_demand && _clear_cache.exchange(false)) {
             _media_src->clearCache();
         }
+        return _enabled || !_option.ts_demand;
+    }
+
+    /**
+     * 输入共享ts复用器产生的ts数据
+     */
+    void inputTS(const toolkit::Buffer::Ptr &buffer, uint64_t timestamp, bool key_pos) {
         if (_enabled || !_option.ts_demand) {
-            return MpegMuxer::inputFrame(frame);
+            onWrite(buffer, timestamp, key_pos);
         }
-        return false;
     }
 
     bool isEnabled() {
         //缓存尚未清空时，还允许触发inputFrame函数，以便及时清空缓存
-        return _option.ts_demand ? (_clear_cache ? true : _enabled) : true;
+        return _option.ts_demand ? (_clear_cache || _enabled) : true;
     }
 
 protected:
@@ -78,8 +99,9 @@ protected:
     }
 
 private:
-    bool _enabled = true;
-    bool _clear_cache = false;
+    // 按需复用开关，在归属线程(onReaderChanged)中修改，并行复用时在复用线程中读取
+    std::atomic<bool> _enabled { true };
+    std::atomic<bool> _clear_cache { false };
     ProtocolOption _option;
     TSMediaSource::Ptr _media_src;
 };
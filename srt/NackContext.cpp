@@ -1,13 +1,13 @@
 ﻿#include "NackContext.hpp"
 
 namespace SRT {
-void NackContext::update(TimePoint now, std::list<PacketQueue::LostPair> &lostlist) {
+void NackContext::update(TimePoint now, std::list<PacketQueueInterface::LostPair> &lostlist) {
     for (auto item : lostlist) {
         mergeItem(now, item);
     }
 }
 void NackContext::getLostList(
-    TimePoint now, uint32_t rtt, uint32_t rtt_variance, std::list<PacketQueue::LostPair> &lostlist) {
+    TimePoint now, uint32_t rtt, uint32_t rtt_variance, std::list<PacketQueueInterface::LostPair> &lostlist) {
     lostlist.clear();
     std::list<uint32_t> tmp_list;
 
@@ -39,7 +39,7 @@ void NackContext::getLostList(
         }
     }
 
-    PacketQueue::LostPair lost;
+    PacketQueueInterface::LostPair lost;
     bool finish = true;
     for (auto cur = tmp_list.begin(); cur != tmp_list.end(); ++cur) {
         if (finish) {
@@ -94,7 +94,7 @@ void NackContext::drop(uint32_t seq) {
     }
 }
 
-void NackContext::mergeItem(TimePoint now, PacketQueue::LostPair &item) {
+void NackContext::mergeItem(TimePoint now, PacketQueueInterface::LostPair &item) {
     for (uint32_t i = item.first; i < item.second; ++i) {
         auto it = _nack_map.find(i);
         if (it != _nack_map.end()) {
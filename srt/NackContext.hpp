@@ -3,18 +3,19 @@
 #include "Common.hpp"
 #include "PacketQueue.hpp"
 #include <list>
+#include <map>
 
 namespace SRT {
 class NackContext {
 public:
     NackContext() = default;
     ~NackContext() = default;
-    void update(TimePoint now, std::list<PacketQueue::LostPair> &lostlist);
-    void getLostList(TimePoint now, uint32_t rtt, uint32_t rtt_variance, std::list<PacketQueue::LostPair> &lostlist);
+    void update(TimePoint now, std::list<PacketQueueInterface::LostPair> &lostlist);
+    void getLostList(TimePoint now, uint32_t rtt, uint32_t rtt_variance, std::list<PacketQueueInterface::LostPair> &lostlist);
     void drop(uint32_t seq);
 
 private:
-    void mergeItem(TimePoint now, PacketQueue::LostPair &item);
+    void mergeItem(TimePoint now, PacketQueueInterface::LostPair &item);
 
 private:
     class NackItem {
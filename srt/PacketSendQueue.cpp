@@ -5,28 +5,48 @@ namespace SRT {
 PacketSendQueue::PacketSendQueue(uint32_t max_size, uint32_t latency,uint32_t flag)
     : _srt_flag(flag)
     , _pkt_cap(max_size)
-    , _pkt_latency(latency) {}
+    , _pkt_latency(latency)
+    , _pkt_buf(max_size) {}
 
-bool PacketSendQueue::drop(uint32_t num) {
-    decltype(_pkt_cache.begin()) it;
-    for (it = _pkt_cache.begin(); it != _pkt_cache.end(); ++it) {
-        if ((*it)->packet_seq_number == num) {
-            break;
-        }
+uint32_t PacketSendQueue::seqOffset(uint32_t seq) const {
+    // seq范围为[0, MAX_SEQ]，回环后需要修正偏移
+    return seq >= _first_seq ? seq - _first_seq : MAX_SEQ - _first_seq + seq + 1;
+}
+
+void PacketSendQueue::popFront(uint32_t count) {
+    for (uint32_t i = 0; i < count && _size > 0; ++i) {
+        _pkt_buf[_start] = nullptr;
+        _start = (_start + 1) % _pkt_cap;
+        _first_seq = genExpectedSeq(_first_seq + 1);
+        --_size;
     }
-    if (it != _pkt_cache.end()) {
-        _pkt_cache.erase(_pkt_cache.begin(), it);
+}
+
+bool PacketSendQueue::drop(uint32_t num) {
+    // 丢弃num之前(不包括num)已经被确认的包
+    auto offset = seqOffset(num);
+    if (offset < _size) {
+        popFront(offset);
     }
     return true;
 }
 
 bool PacketSendQueue::inputPacket(DataPacket::Ptr pkt) {
-    _pkt_cache.push_back(pkt);
-    while (_pkt_cache.size() > _pkt_cap) {
-        _pkt_cache.pop_front();
+    if (_size && seqOffset(pkt->packet_seq_number) != _size) {
+        // seq不连续，清空缓存重新开始
+        WarnL << "send seq not continuous, expected " << genExpectedSeq(_first_seq + _size) << " but " << pkt->packet_seq_number;
+        popFront(_size);
     }
+    if (!_size) {
+        _first_seq = pkt->packet_seq_number;
+    }
+    if (_size == _pkt_cap) {
+        popFront(1);
+    }
+    _pkt_buf[(_start + _size) % _pkt_cap] = std::move(pkt);
+    ++_size;
     while (timeLatency() > _pkt_latency && TLPKTDrop()) {
-        _pkt_cache.pop_front();
+        popFront(1);
     }
     return true;
 }
@@ -37,35 +57,27 @@ bool PacketSendQueue::TLPKTDrop(){
 
 std::list<DataPacket::Ptr> PacketSendQueue::findPacketBySeq(uint32_t start, uint32_t end) {
     std::list<DataPacket::Ptr> re;
-    decltype(_pkt_cache.begin()) it;
-    for (it = _pkt_cache.begin(); it != _pkt_cache.end(); ++it) {
-        if ((*it)->packet_seq_number == start) {
-            break;
-        }
-    }
-
-    if (start == end) {
-        if (it != _pkt_cache.end()) {
-            re.push_back(*it);
-        }
+    auto first = seqOffset(start);
+    if (first >= _size) {
         return re;
     }
-
-    for (; it != _pkt_cache.end(); ++it) {
-        re.push_back(*it);
-        if ((*it)->packet_seq_number == end) {
-            break;
-        }
+    auto last = seqOffset(end);
+    if (last < first || last >= _size) {
+        // 结束位置不在缓存中，返回缓存中start之后的所有包
+        last = _size - 1;
+    }
+    for (auto i = first; i <= last; ++i) {
+        re.push_back(_pkt_buf[(_start + i) % _pkt_cap]);
     }
     return re;
 }
 
 uint32_t PacketSendQueue::timeLatency() {
-    if (_pkt_cache.empty()) {
+    if (!_size) {
         return 0;
     }
-    auto first = _pkt_cache.front()->timestamp;
-    auto last = _pkt_cache.back()->timestamp;
+    auto first = _pkt_buf[_start]->timestamp;
+    auto last = _pkt_buf[(_start + _size - 1) % _pkt_cap]->timestamp;
     uint32_t dur;
 
     if (last > first) {
@@ -81,4 +93,4 @@ uint32_t PacketSendQueue::timeLatency() {
     return dur;
 }
 
-} // namespace SRT
\ No newline at end of file
+} // namespace SRT
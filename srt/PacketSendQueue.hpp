@@ -5,9 +5,9 @@
 #include <algorithm>
 #include <list>
 #include <memory>
-#include <set>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace SRT {
 
@@ -26,11 +26,19 @@ public:
 private:
     uint32_t timeLatency();
     bool TLPKTDrop();
+    // 获取seq在环形缓存中相对于第一个包的偏移，不在缓存中时返回值不小于_size
+    uint32_t seqOffset(uint32_t seq) const;
+    void popFront(uint32_t count);
+
 private:
     uint32_t _srt_flag;
     uint32_t _pkt_cap;
     uint32_t _pkt_latency;
-    std::list<DataPacket::Ptr> _pkt_cache;
+    // 按seq连续存放的环形缓存，_start为第一个包的位置，_first_seq为第一个包的seq
+    std::vector<DataPacket::Ptr> _pkt_buf;
+    uint32_t _start = 0;
+    uint32_t _size = 0;
+    uint32_t _first_seq = 0;
 };
 
 } // namespace SRT
@@ -559,9 +559,9 @@ void SrtTransport::sendLightACKPacket() {
     TraceL << "send  ack " << pkt->dump();
 }
 
-void SrtTransport::sendNAKPacket(std::list<PacketQueue::LostPair> &lost_list) {
+void SrtTransport::sendNAKPacket(std::list<PacketQueueInterface::LostPair> &lost_list) {
     NAKPacket::Ptr pkt = std::make_shared<NAKPacket>();
-    std::list<PacketQueue::LostPair> tmp;
+    std::list<PacketQueueInterface::LostPair> tmp;
     auto size = NAKPacket::getCIFSize(lost_list);
     size_t paylaod_size = getPayloadSize();
     if (size > paylaod_size) {
@@ -82,7 +82,7 @@ private:
     void handlePeerError(uint8_t *buf, int len, struct sockaddr_storage *addr);
     void handleDataPacket(uint8_t *buf, int len, struct sockaddr_storage *addr);
 
-    void sendNAKPacket(std::list<PacketQueue::LostPair> &lost_list);
+    void sendNAKPacket(std::list<PacketQueueInterface::LostPair> &lost_list);
     void sendACKPacket();
     void sendLightACKPacket();
     void sendKeepLivePacket();
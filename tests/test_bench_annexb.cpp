@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <random>
+#include <cstring>
+#include <iostream>
+#include "Util/CMD.h"
+#include "Util/File.h"
+#include "Util/TimeTicker.h"
+#include "ext-codec/H264.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+
+        (*_parser) << Option('i',/*该选项简称，如果是\x00则说明无简称*/
+                             "in",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "h264/h265 annexb裸流文件，为空时生成8Mbps的模拟码流",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('n',/*该选项简称，如果是\x00则说明无简称*/
+                             "number",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "20",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "重复扫描次数",/*该选项说明文字*/
+                             nullptr);
+    }
+};
+
+// 生成60秒8Mbps、25fps的模拟码流，每帧包含sps/pps/sei等小nalu与一个大的slice
+static string makeBitstream() {
+    string ret;
+    mt19937 rng(0);
+    uniform_int_distribution<int> dist(2, 255);
+    auto frame_bytes = 8 * 1024 * 1024 / 8 / 25;
+    for (auto i = 0; i < 60 * 25; ++i) {
+        for (auto nalu_size : { 20, 8, 32, frame_bytes }) {
+            ret.append("\x00\x00\x00\x01", 4);
+            // 真实码流中存在防竞争字节，这里插入少量0x00模拟
+            for (auto j = 0; j < nalu_size; ++j) {
+                ret.push_back(j % 97 == 0 ? 0 : (char)dist(rng));
+            }
+        }
+    }
+    return ret;
+}
+
+// 逐字节memcmp查找起始码，作为对比基准
+static size_t splitByMemcmp(const char *ptr, size_t len) {
+    size_t count = 0;
+    for (size_t i = 0; i + 3 < len; ++i) {
+        if (memcmp(ptr + i, "\x00\x00\x01", 3) == 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+//该测试程序用于测量annexb起始码查找与nalu分割的吞吐量
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+    string in = cmd_main["in"];
+    int number = cmd_main["number"];
+    auto data = in.empty() ? makeBitstream() : File::loadFile(in);
+    if (data.empty()) {
+        cout << "读取文件失败:" << in << endl;
+        return -1;
+    }
+    auto total_mb = (double)data.size() * number / 1024 / 1024;
+    cout << "码流大小:" << data.size() << " 字节, 重复次数:" << number << endl;
+
+    size_t memcmp_count = 0;
+    Ticker ticker;
+    for (auto i = 0; i < number; ++i) {
+        memcmp_count = splitByMemcmp(data.data(), data.size());
+    }
+    auto ms = ticker.elapsedTime();
+    cout << "memcmp: " << total_mb * 1000 / (ms ? ms : 1) << " MB/s, nalu个数:" << memcmp_count << endl;
+
+    size_t split_count = 0;
+    ticker.resetTime();
+    for (auto i = 0; i < number; ++i) {
+        split_count = 0;
+        splitH264(data.data(), data.size(), prefixSize(data.data(), data.size()), [&](const char *ptr, size_t len, size_t prefix) {
+            ++split_count;
+        });
+    }
+    ms = ticker.elapsedTime();
+    cout << "splitH264: " << total_mb * 1000 / (ms ? ms : 1) << " MB/s, nalu个数:" << split_count << endl;
+    return 0;
+}
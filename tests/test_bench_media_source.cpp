@@ -0,0 +1,149 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <atomic>
+#include <iostream>
+#include "Util/CMD.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Thread/semaphore.h"
+#include "Poller/EventPoller.h"
+#include "Common/config.h"
+#include "Common/MediaSource.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class BenchMediaSource : public MediaSource {
+public:
+    using Ptr = std::shared_ptr<BenchMediaSource>;
+    BenchMediaSource(const string &schema, const MediaTuple &tuple) : MediaSource(schema, tuple) {}
+    int readerCount() override { return 0; }
+    void registSelf() { regist(); }
+};
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+
+        (*_parser) << Option('t',/*该选项简称，如果是\x00则说明无简称*/
+                             "threads",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             to_string(thread::hardware_concurrency()).data(),/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "并发查找的poller线程数",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('c',/*该选项简称，如果是\x00则说明无简称*/
+                             "count",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "10000",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "预先注册的流个数",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('n',/*该选项简称，如果是\x00则说明无简称*/
+                             "number",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "1000000",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "每个线程的操作次数",/*该选项说明文字*/
+                             nullptr);
+    }
+};
+
+// 在所有poller线程上并发执行task，返回总耗时(毫秒)
+static uint64_t runOnAllPollers(const function<void(size_t index)> &task) {
+    semaphore sem;
+    size_t count = 0;
+    Ticker ticker;
+    EventPollerPool::Instance().for_each([&](const TaskExecutor::Ptr &executor) {
+        auto index = count++;
+        executor->async([&, index]() {
+            task(index);
+            sem.post();
+        });
+    });
+    for (size_t i = 0; i < count; ++i) {
+        sem.wait();
+    }
+    return ticker.elapsedTime();
+}
+
+//该测试程序用于测量MediaSource注册表在多线程下的查找与注册性能
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+    // 未添加日志通道，不输出日志，避免影响测试结果
+    size_t threads = cmd_main["threads"];
+    size_t count = cmd_main["count"];
+    size_t number = cmd_main["number"];
+    EventPollerPool::setPoolSize(threads);
+
+    static const string schemas[] = { RTMP_SCHEMA, RTSP_SCHEMA, TS_SCHEMA, FMP4_SCHEMA };
+    vector<BenchMediaSource::Ptr> sources;
+    for (size_t i = 0; i < count; ++i) {
+        for (auto &schema : schemas) {
+            auto src = std::make_shared<BenchMediaSource>(schema, MediaTuple { DEFAULT_VHOST, "live", "stream_" + to_string(i), "" });
+            src->registSelf();
+            sources.emplace_back(std::move(src));
+        }
+    }
+    cout << "已注册流个数:" << count << ",协议个数:" << sizeof(schemas) / sizeof(schemas[0]) << ",线程数:" << threads << endl;
+
+    // 指定协议查找
+    atomic<size_t> hit { 0 };
+    auto ms = runOnAllPollers([&](size_t index) {
+        size_t ok = 0;
+        for (size_t i = 0; i < number; ++i) {
+            auto stream = "stream_" + to_string((i * 7 + index) % count);
+            ok += MediaSource::find(RTSP_SCHEMA, DEFAULT_VHOST, "live", stream) ? 1 : 0;
+        }
+        hit += ok;
+    });
+    cout << "find(schema, vhost, app, stream): " << threads * number * 1000 / (ms ? ms : 1) << " 次/秒, 命中:" << hit << endl;
+
+    // 不指定协议查找(按协议优先级查找)
+    hit = 0;
+    ms = runOnAllPollers([&](size_t index) {
+        size_t ok = 0;
+        for (size_t i = 0; i < number; ++i) {
+            // 一半的请求查找不存在的流，模拟断线重连风暴
+            auto stream = "stream_" + to_string((i * 7 + index) % (2 * count));
+            ok += MediaSource::find(DEFAULT_VHOST, "live", stream) ? 1 : 0;
+        }
+        hit += ok;
+    });
+    cout << "find(vhost, app, stream): " << threads * number * 1000 / (ms ? ms : 1) << " 次/秒, 命中:" << hit << endl;
+
+    // 并发注册与注销
+    auto regist_number = number / 10;
+    ms = runOnAllPollers([&](size_t index) {
+        for (size_t i = 0; i < regist_number; ++i) {
+            auto src = std::make_shared<BenchMediaSource>(RTSP_SCHEMA, MediaTuple { DEFAULT_VHOST, "bench", to_string(index) + "_" + to_string(i), "" });
+            src->registSelf();
+            // 析构时自动注销
+        }
+    });
+    cout << "regist/unregist: " << threads * regist_number * 1000 / (ms ? ms : 1) << " 次/秒" << endl;
+
+    sources.clear();
+    return 0;
+}
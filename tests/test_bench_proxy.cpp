@@ -1,4 +1,5 @@
 ﻿#include <map>
+#include <ctime>
 #include <signal.h>
 #include <iostream>
 #include "Util/CMD.h"
@@ -6,6 +7,8 @@
 #include "Common/config.h"
 #include "Player/PlayerProxy.h"
 #include "Thread/WorkThreadPool.h"
+#include "Poller/Timer.h"
+#include "Util/TimeTicker.h"
 
 using namespace std;
 using namespace toolkit;
@@ -81,6 +84,21 @@ public:
                              "是否按需转协议，设置为1提高性能",/*该选项说明文字*/
                              nullptr);
 
+        (*_parser) << Option('b',/*该选项简称，如果是\x00则说明无简称*/
+                             "block",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "64",/*该选项默认值*/
+                             true,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "rtp接收内存块大小(KB)，设置为0时每个rtp包单独分配内存，用于对比",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('s',/*该选项简称，如果是\x00则说明无简称*/
+                             "stat",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "5",/*该选项默认值*/
+                             true,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "统计打印间隔,单位秒,设置为0关闭",/*该选项说明文字*/
+                             nullptr);
 
     }
 
@@ -91,7 +109,7 @@ public:
     }
 };
 
-//此程序为zlm的拉流代理性能测试工具，用于测试拉流代理性能
+//此程序为zlm的拉流代理性能测试工具，用于测试拉流代理性能；可通过-b参数对比rtp接收内存块对转发开销的影响
 int main(int argc, char *argv[]) {
     {
         CMD_main cmd_main;
@@ -113,6 +131,8 @@ int main(int argc, char *argv[]) {
         auto proxy_count = cmd_main["count"].as<int>();
         auto merge_ms = cmd_main["merge"].as<int>();
         auto demand = cmd_main["demand"].as<int>();
+        auto block_kb = cmd_main["block"].as<int>();
+        auto stat_sec = cmd_main["stat"].as<float>();
 
         //设置日志
         Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", logLevel));
@@ -130,6 +150,7 @@ int main(int argc, char *argv[]) {
         mINI::Instance()[Protocol::kHlsDemand] = demand;
         mINI::Instance()[Protocol::kTSDemand] = demand;
         mINI::Instance()[Protocol::kFMP4Demand] = demand;
+        mINI::Instance()[Rtsp::kRtpBlockKB] = block_kb;
 
         map<string, PlayerProxy::Ptr> proxyMap;
         ProtocolOption option;
@@ -148,6 +169,30 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        Timer::Ptr timer;
+        if (stat_sec > 0) {
+            //定时打印转发码率、cpu占用与rtp包对象个数，用于对比不同配置下的转发开销
+            auto ticker = std::make_shared<Ticker>();
+            auto cpu = std::make_shared<clock_t>(clock());
+            timer = std::make_shared<Timer>(stat_sec, [ticker, cpu]() {
+                uint64_t bytes_speed = 0;
+                size_t count = 0;
+                MediaSource::for_each_media([&](const MediaSource::Ptr &src) {
+                    bytes_speed += src->getBytesSpeed();
+                    ++count;
+                }, RTSP_SCHEMA);
+                auto now = clock();
+                auto cpu_ms = (uint64_t)(now - *cpu) * 1000 / CLOCKS_PER_SEC;
+                auto ms = ticker->elapsedTime();
+                *cpu = now;
+                ticker->resetTime();
+                InfoL << "rtsp源个数:" << count << ", 总码率:" << bytes_speed * 8 / 1024 / 1024 << " Mbps"
+                      << ", cpu占用:" << cpu_ms * 100 / (ms ? ms : 1) << "%"
+                      << ", RtpPacket个数:" << ObjectStatistic<RtpPacket>::count();
+                return true;
+            }, nullptr);
+        }
+
         static semaphore sem;
         signal(SIGINT, [](int) { sem.post(); });// 设置退出信号
         sem.wait();
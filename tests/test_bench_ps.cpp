@@ -0,0 +1,159 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <ctime>
+#include <iostream>
+#include "Util/CMD.h"
+#include "Util/util.h"
+#include "Util/File.h"
+#include "Util/TimeTicker.h"
+#include "Common/config.h"
+#include "Rtsp/Rtsp.h"
+#include "Rtp/Decoder.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+
+        (*_parser) << Option('i',/*该选项简称，如果是\x00则说明无简称*/
+                             "in",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             nullptr,/*该选项默认值*/
+                             true,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "rtp_proxy.dumpDir导出的调试文件，支持.rtp(带2字节长度前缀的rtp)与.mpeg(ps负载)",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('n',/*该选项简称，如果是\x00则说明无简称*/
+                             "loop",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "20",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "重复解析次数",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('c',/*该选项简称，如果是\x00则说明无简称*/
+                             "chunk",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "0",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "每次输入的字节数，0则.rtp文件按rtp包输入、.mpeg文件按1400字节输入",/*该选项说明文字*/
+                             nullptr);
+    }
+};
+
+// 只统计帧数与字节数的MediaSink
+class CountSink : public MediaSinkInterface {
+public:
+    bool addTrack(const Track::Ptr &track) override { return true; }
+    bool inputFrame(const Frame::Ptr &frame) override {
+        ++frames;
+        bytes += frame->size();
+        return true;
+    }
+
+    size_t frames = 0;
+    size_t bytes = 0;
+};
+
+// 读取调试文件，返回每次输入的数据块
+static vector<string> loadDump(const string &path, size_t chunk) {
+    vector<string> ret;
+    auto content = File::loadFile(path);
+    if (end_with(path, ".rtp")) {
+        // RtpProcess导出的rtp，每个包前有2个字节的长度
+        string payload;
+        for (size_t pos = 0; pos + 2 <= content.size();) {
+            size_t len = ((uint8_t)content[pos] << 8) | (uint8_t)content[pos + 1];
+            pos += 2;
+            if (pos + len > content.size() || len < RtpPacket::kRtpHeaderSize) {
+                break;
+            }
+            auto header = (RtpHeader *)(&content[pos]);
+            auto size = header->getPayloadSize(len);
+            if (size > 0) {
+                if (chunk) {
+                    payload.append((char *)header->getPayloadData(), size);
+                } else {
+                    ret.emplace_back((char *)header->getPayloadData(), size);
+                }
+            }
+            pos += len;
+        }
+        if (!chunk) {
+            return ret;
+        }
+        content = std::move(payload);
+    }
+    chunk = chunk ? chunk : 1400;
+    for (size_t pos = 0; pos < content.size(); pos += chunk) {
+        ret.emplace_back(content.substr(pos, chunk));
+    }
+    return ret;
+}
+
+static void bench(const char *name, bool fast, const vector<string> &chunks, size_t total, int loop) {
+    mINI::Instance()[RtpProxy::kPSFastDemux] = fast;
+    size_t frames = 0, bytes = 0;
+    Ticker ticker;
+    auto cpu = clock();
+    for (int i = 0; i < loop; ++i) {
+        CountSink sink;
+        auto decoder = DecoderImp::createDecoder(DecoderImp::decoder_ps, &sink);
+        for (auto &chunk : chunks) {
+            decoder->input((const uint8_t *)chunk.data(), chunk.size());
+        }
+        frames = sink.frames;
+        bytes = sink.bytes;
+    }
+    auto ms = ticker.elapsedTime();
+    auto cpu_ms = (uint64_t)(clock() - cpu) * 1000 / CLOCKS_PER_SEC;
+    cout << name << " 帧数:" << frames << ", 帧字节数:" << bytes << ", 耗时:" << ms << " ms"
+         << ", 速度:" << total * loop / 1024 / (ms ? ms : 1) << " MB/s, cpu:" << cpu_ms << " ms" << endl;
+}
+
+//该测试程序回放rtp_proxy.dumpDir导出的国标调试文件，对比内置ps快速解析流程与libmpeg的解复用性能
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+#if defined(ENABLE_RTPPROXY)
+    // 未添加日志通道，不输出日志，避免影响测试结果
+    string path = cmd_main["in"];
+    int loop = cmd_main["loop"];
+    size_t chunk = cmd_main["chunk"];
+    auto chunks = loadDump(path, chunk);
+    size_t total = 0;
+    for (auto &item : chunks) {
+        total += item.size();
+    }
+    if (!total) {
+        cout << "读取文件失败:" << path << endl;
+        return -1;
+    }
+    cout << "ps数据:" << total << " 字节, 输入次数:" << chunks.size() << ", 重复次数:" << loop << endl;
+    bench("fast   ", true, chunks, total, loop);
+    bench("libmpeg", false, chunks, total, loop);
+#else
+    cout << "该测试程序需要开启ENABLE_RTPPROXY" << endl;
+#endif
+    return 0;
+}
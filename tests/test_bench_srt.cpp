@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <random>
+#include <iostream>
+#include "Util/CMD.h"
+#include "Util/util.h"
+#include "Util/TimeTicker.h"
+#include "srt/PacketQueue.hpp"
+#include "srt/PacketSendQueue.hpp"
+
+using namespace std;
+using namespace toolkit;
+using namespace SRT;
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+
+        (*_parser) << Option('b',/*该选项简称，如果是\x00则说明无简称*/
+                             "bitrate",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "20",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "模拟码率(Mbps)",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('l',/*该选项简称，如果是\x00则说明无简称*/
+                             "latency",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "1000",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "srt延时(毫秒)",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('p',/*该选项简称，如果是\x00则说明无简称*/
+                             "loss",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "2",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "丢包率(百分比)",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('s',/*该选项简称，如果是\x00则说明无简称*/
+                             "seconds",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "60",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "模拟的码流时长(秒)",/*该选项说明文字*/
+                             nullptr);
+    }
+};
+
+//该测试程序模拟有丢包的srt传输，测量收发缓存与nack处理的性能
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+    // 未添加日志通道，不输出日志，避免影响测试结果
+    uint32_t bitrate = cmd_main["bitrate"];
+    uint32_t latency = cmd_main["latency"];
+    uint32_t loss = cmd_main["loss"];
+    uint32_t seconds = cmd_main["seconds"];
+
+    // 每个srt包1316字节负载
+    uint32_t pkt_per_sec = bitrate * 1024 * 1024 / 8 / 1316;
+    uint32_t pkt_count = pkt_per_sec * seconds;
+    // 缓存至少能容纳一个延时窗口内的包
+    uint32_t buf_size = MAX(pkt_per_sec * latency / 1000, 8192);
+    uint32_t init_seq = MAX_SEQ - pkt_count / 2;
+
+    PacketSendQueue send_buf(buf_size, latency * 1000);
+    PacketRecvQueue recv_buf(buf_size, init_seq, latency * 1000);
+    mt19937 rng(0);
+    uniform_int_distribution<uint32_t> dist(0, 99);
+
+    list<DataPacket::Ptr> out;
+    list<PacketQueueInterface::LostPair> lost_list;
+    size_t recv_count = 0, nack_count = 0, retrans_count = 0;
+    Ticker ticker;
+
+    auto seq = init_seq;
+    for (uint32_t i = 0; i < pkt_count; ++i) {
+        auto pkt = std::make_shared<DataPacket>();
+        pkt->packet_seq_number = seq;
+        pkt->timestamp = (uint32_t)((uint64_t)i * 1000000 / pkt_per_sec);
+        seq = genExpectedSeq(seq + 1);
+        send_buf.inputPacket(pkt);
+
+        // 模拟丢包，丢失的包等待nack重传
+        if (dist(rng) >= loss) {
+            recv_buf.inputPacket(pkt, out);
+        }
+
+        // 与SrtTransport::checkAndSendAckNak一样，每20ms发送一次周期性nack，然后重传
+        if (i % (pkt_per_sec / 50 + 1) == 0) {
+            lost_list = recv_buf.getLostSeq();
+            nack_count += lost_list.size();
+            for (auto &lost : lost_list) {
+                for (auto &re : send_buf.findPacketBySeq(lost.first, genExpectedSeq(lost.second - 1))) {
+                    recv_buf.inputPacket(re, out);
+                    ++retrans_count;
+                }
+            }
+            // 对端ack
+            send_buf.drop(recv_buf.getExpectedSeq());
+        }
+        recv_count += out.size();
+        out.clear();
+    }
+    auto ms = ticker.elapsedTime();
+    cout << "包数:" << pkt_count << ", 缓存大小:" << buf_size << ", 耗时:" << ms << "ms, "
+         << (uint64_t)pkt_count * 1000 / (ms ? ms : 1) << " 包/秒" << endl;
+    cout << "交付包数:" << recv_count << ", nack区间数:" << nack_count << ", 重传包数:" << retrans_count << endl;
+    return 0;
+}
@@ -0,0 +1,178 @@
+﻿/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <ctime>
+#include <cstring>
+#include <iostream>
+#include "Util/CMD.h"
+#include "Util/util.h"
+#include "Util/TimeTicker.h"
+#include "Thread/semaphore.h"
+#include "Thread/WorkThreadPool.h"
+#if defined(ENABLE_FFMPEG)
+#include "Codec/Transcode.h"
+#endif
+
+using namespace std;
+using namespace toolkit;
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+
+        (*_parser) << Option('t',/*该选项简称，如果是\x00则说明无简称*/
+                             "threads",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             to_string(thread::hardware_concurrency()).data(),/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "合成线程数",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('n',/*该选项简称，如果是\x00则说明无简称*/
+                             "frames",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgRequired,/*该选项后面必须跟值*/
+                             "250",/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "每种布局合成的帧数",/*该选项说明文字*/
+                             nullptr);
+
+        (*_parser) << Option('s',/*该选项简称，如果是\x00则说明无简称*/
+                             "serial",/*该选项全称,每个选项必须有全称；不得为null或空字符串*/
+                             Option::ArgNone,/*该选项后面不跟值*/
+                             nullptr,/*该选项默认值*/
+                             false,/*该选项是否必须赋值，如果没有默认值且为ArgRequired时用户必须提供该参数否则将抛异常*/
+                             "同时测试单线程缩放到临时帧再逐行拷贝的旧方式，用于对比",/*该选项说明文字*/
+                             nullptr);
+    }
+};
+
+#if defined(ENABLE_FFMPEG)
+using namespace mediakit;
+
+static FFmpegFrame::Ptr makeFrame(int width, int height) {
+    auto frame = std::make_shared<FFmpegFrame>();
+    frame->get()->width = width;
+    frame->get()->height = height;
+    frame->get()->format = AV_PIX_FMT_YUV420P;
+    av_frame_get_buffer(frame->get(), 32);
+    // 填充渐变，避免全黑帧走特殊路径
+    for (int i = 0; i < 3; ++i) {
+        auto h = i ? height / 2 : height;
+        for (int y = 0; y < h; ++y) {
+            memset(frame->get()->data[i] + y * frame->get()->linesize[i], (y * 4 + i * 64) & 0xFF, frame->get()->linesize[i]);
+        }
+    }
+    return frame;
+}
+
+struct Tile {
+    int x;
+    int y;
+    FFmpegSws::Ptr sws;
+    TaskExecutor::Ptr executor;
+};
+
+// 旧方式：缩放到临时帧，再逐行拷贝到画布
+static void copyTile(const FFmpegFrame::Ptr &canvas, const FFmpegFrame::Ptr &tmp, int x, int y) {
+    auto dst = canvas->get();
+    auto src = tmp->get();
+    for (int i = 0; i < src->height; ++i) {
+        memcpy(dst->data[0] + dst->linesize[0] * (i + y) + x, src->data[0] + src->linesize[0] * i, src->width);
+    }
+    for (int i = 0; i < (src->height + 1) / 2; ++i) {
+        memcpy(dst->data[1] + dst->linesize[1] * (i + y / 2) + x / 2, src->data[1] + src->linesize[1] * i, src->width / 2);
+        memcpy(dst->data[2] + dst->linesize[2] * (i + y / 2) + x / 2, src->data[2] + src->linesize[2] * i, src->width / 2);
+    }
+}
+
+static void report(const char *name, int tiles, size_t frames, uint64_t ms, clock_t cpu) {
+    auto cpu_ms = (uint64_t)cpu * 1000 / CLOCKS_PER_SEC;
+    cout << name << " 画面数:" << tiles << ", 帧率:" << frames * 1000 / (ms ? ms : 1) << " fps, cpu占用:" << cpu_ms * 100 / (ms ? ms : 1) << "%" << endl;
+}
+#endif
+
+//该测试程序测量视频拼接(VideoStack)在不同布局下的合成性能：每个画面缩放后直接写入1080p画布，画面分散在线程池中并行处理
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+#if defined(ENABLE_FFMPEG)
+    // 未添加日志通道，不输出日志，避免影响测试结果
+    size_t threads = cmd_main["threads"];
+    size_t frames = cmd_main["frames"];
+    bool serial = cmd_main.hasKey("serial");
+    WorkThreadPool::setPoolSize(threads);
+
+    static constexpr int kWidth = 1920;
+    static constexpr int kHeight = 1080;
+    // 模拟720p的解码帧
+    auto src = makeFrame(1280, 720);
+    auto canvas = makeFrame(kWidth, kHeight);
+    cout << "画布:" << kWidth << "x" << kHeight << ", 源:1280x720, 线程数:" << threads << ", 帧数:" << frames << endl;
+
+    for (int grid = 2; grid <= 6; ++grid) {
+        auto tile_width = (kWidth / grid) & ~1;
+        auto tile_height = (kHeight / grid) & ~1;
+        vector<Tile> tiles;
+        for (int row = 0; row < grid; ++row) {
+            for (int col = 0; col < grid; ++col) {
+                Tile tile;
+                tile.x = col * tile_width;
+                tile.y = row * tile_height;
+                tile.sws = std::make_shared<FFmpegSws>(AV_PIX_FMT_YUV420P, tile_width, tile_height);
+                tile.executor = WorkThreadPool::Instance().getExecutor();
+                tiles.emplace_back(std::move(tile));
+            }
+        }
+
+        // 并行，直接缩放到画布区域
+        semaphore sem;
+        Ticker ticker;
+        auto cpu = clock();
+        for (size_t i = 0; i < frames; ++i) {
+            for (auto &tile : tiles) {
+                tile.executor->async([&]() {
+                    tile.sws->inputFrame(src, canvas, tile.x, tile.y);
+                    sem.post();
+                });
+            }
+            for (size_t j = 0; j < tiles.size(); ++j) {
+                sem.wait();
+            }
+        }
+        report("parallel", tiles.size(), frames, ticker.elapsedTime(), clock() - cpu);
+
+        if (!serial) {
+            continue;
+        }
+        // 单线程，缩放到临时帧再逐行拷贝
+        ticker.resetTime();
+        cpu = clock();
+        for (size_t i = 0; i < frames; ++i) {
+            for (auto &tile : tiles) {
+                auto tmp = tile.sws->inputFrame(src);
+                copyTile(canvas, tmp, tile.x, tile.y);
+            }
+        }
+        report("serial  ", tiles.size(), frames, ticker.elapsedTime(), clock() - cpu);
+    }
+#else
+    cout << "该测试程序需要开启ENABLE_FFMPEG" << endl;
+#endif
+    return 0;
+}
@@ -10,11 +10,14 @@
 
 #include <map>
 #include <list>
+#include <vector>
 #include <iostream>
 #include <functional>
+#include "Util/TimeTicker.h"
 #include "Rtsp/RtpReceiver.h"
 
 using namespace std;
+using namespace toolkit;
 using namespace mediakit;
 
 void test_real() {
@@ -269,7 +272,118 @@ void test_rand(){
 #endif
 }
 
-//该测试程序用于检验rtp排序算法的正确性
+//生成测试用的seq序列，从回环前开始
+//reorder: 乱序窗口(连续倒序个数)，为0时不乱序
+//loss: 丢包百分比
+//repeat: 重复包百分比
+static vector<uint16_t> makeSeqList(size_t count, int reorder, int loss, int repeat) {
+    vector<uint16_t> ret;
+    ret.reserve(count * 2);
+    uint16_t base = 0xFFFF - 1000;
+    for (size_t i = 0; i < count;) {
+        size_t window = reorder ? 1 + rand() % reorder : 1;
+        for (size_t j = i + window; j-- > i;) {
+            uint16_t seq = base + (uint16_t)j;
+            if (rand() % 100 < loss) {
+                continue;
+            }
+            ret.emplace_back(seq);
+            if (rand() % 100 < repeat) {
+                ret.emplace_back(seq);
+            }
+        }
+        i += window;
+    }
+    return ret;
+}
+
+//模拟推流端重启(例如国标重新invite)，seq从0重新开始
+static bool test_restart() {
+    PacketSortor<uint16_t, uint16_t> sortor;
+    vector<uint16_t> sorted_list;
+    sortor.setOnSort([&](uint16_t seq, uint16_t packet) {
+        sorted_list.emplace_back(seq);
+    });
+    for (uint16_t seq = 30000; seq < 31000; ++seq) {
+        sortor.sortPacket(seq, seq);
+    }
+    for (uint16_t seq = 0; seq < 500; ++seq) {
+        sortor.sortPacket(seq, seq);
+    }
+    sortor.flush();
+    //重启前后的包都应该输出
+    size_t expect = 1000 + 500;
+    auto ok = sorted_list.size() == expect && sorted_list.back() == 499;
+    cout << "输出数据个数:" << sorted_list.size() << " 期望:" << expect << (ok ? " 通过" : " 失败") << endl;
+    return ok;
+}
+
+//模拟nack重传包迟到(回退距离超过max_distance)，迟到包应该被过滤，输出seq不能回退
+static bool test_late_retransmit() {
+    PacketSortor<uint16_t, uint16_t> sortor;
+    size_t out = 0, disorder = 0;
+    bool have_last = false;
+    uint16_t last = 0;
+    sortor.setOnSort([&](uint16_t seq, uint16_t packet) {
+        if (have_last && (int16_t)(seq - last) <= 0) {
+            ++disorder;
+        }
+        have_last = true;
+        last = seq;
+        ++out;
+    });
+    list<uint16_t> lost;
+    for (uint32_t i = 0; i < 100 * 1000; ++i) {
+        uint16_t seq = 0xFFFF - 50000 + i;
+        //每1000个包丢失连续的10个包(小于kRestartCount)，以及零散的单个包
+        if (i % 1000 < 10 || i % 97 == 0) {
+            lost.emplace_back(seq);
+        } else {
+            sortor.sortPacket(seq, seq);
+        }
+        //每100个包批量重传一次600个包之前丢失的包，同一批次的迟到重传包之间没有其他包
+        while (i % 100 == 0 && !lost.empty() && (uint16_t)(seq - lost.front()) >= 600) {
+            sortor.sortPacket(lost.front(), lost.front());
+            lost.pop_front();
+        }
+    }
+    sortor.flush();
+    auto ok = !disorder;
+    cout << "输出数据个数:" << out << " 乱序输出:" << disorder << (ok ? " 通过" : " 失败") << endl;
+    return ok;
+}
+
+//返回乱序输出个数
+static size_t bench(const char *name, const vector<uint16_t> &input, int loop) {
+    size_t out = 0, disorder = 0;
+    Ticker ticker;
+    for (int i = 0; i < loop; ++i) {
+        PacketSortor<RtpPacket::Ptr> sortor;
+        bool have_last = false;
+        uint16_t last = 0;
+        out = disorder = 0;
+        sortor.setOnSort([&](uint16_t seq, RtpPacket::Ptr packet) {
+            //输出的seq必须递增(考虑回环)
+            if (have_last && (int16_t)(seq - last) <= 0) {
+                ++disorder;
+            }
+            have_last = true;
+            last = seq;
+            ++out;
+        });
+        for (auto seq : input) {
+            //与rtp接收流程一样，每个包持有一个智能指针
+            sortor.sortPacket(seq, nullptr);
+        }
+        sortor.flush();
+    }
+    auto ms = ticker.elapsedTime();
+    cout << name << " 输入包数:" << input.size() << " 输出包数:" << out << " 乱序输出:" << disorder
+         << " 耗时:" << ms << "ms 每包耗时:" << (double)ms * 1000 * 1000 / input.size() / loop << "ns" << endl;
+    return disorder;
+}
+
+//该测试程序用于检验rtp排序算法的正确性，并测试各种乱序、丢包情况下的排序性能
 int main(int argc, char *argv[]) {
     //测试真实的rtp seq
     cout << "###### 真实的rtp seq #####" << endl;
@@ -278,5 +392,24 @@ int main(int argc, char *argv[]) {
     //模拟rtp乱序、回环、丢包、重复情况
     cout << "###### 模拟的rtp seq #####" << endl;
     test_rand();
-    return 0;
+
+    //模拟seq重新开始
+    cout << "###### seq重新开始 #####" << endl;
+    auto ok = test_restart();
+
+    //模拟迟到的重传包
+    cout << "###### 迟到的重传包 #####" << endl;
+    ok = test_late_retransmit() && ok;
+
+    //性能测试，日志通道未添加，丢包告警不输出
+    cout << "###### 性能测试 #####" << endl;
+    static constexpr size_t kCount = 1000 * 1000;
+    static constexpr int kLoop = 10;
+    size_t disorder = 0;
+    disorder += bench("顺序         ", makeSeqList(kCount, 0, 0, 0), kLoop);
+    disorder += bench("乱序         ", makeSeqList(kCount, 10, 0, 0), kLoop);
+    disorder += bench("丢包5%       ", makeSeqList(kCount, 0, 5, 0), kLoop);
+    disorder += bench("乱序+丢包5%  ", makeSeqList(kCount, 10, 5, 0), kLoop);
+    disorder += bench("乱序+丢包+重复", makeSeqList(kCount, 10, 5, 5), kLoop);
+    return ok && !disorder ? 0 : -1;
 }
\ No newline at end of file
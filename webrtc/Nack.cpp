@@ -49,12 +49,11 @@ static onceToken token([]() {
 
 } // namespace Rtc
 
-void NackList::pushBack(RtpPacket::Ptr rtp) {
+void NackList::pushBack(RtpPacket::Ptr rtp, uint16_t seq) {
     GET_CONFIG(uint32_t, max_rtp_cache_ms, Rtc::kMaxRtpCacheMS);
     GET_CONFIG(uint32_t, max_rtp_cache_size, Rtc::kMaxRtpCacheSize);
 
     // 记录rtp
-    auto seq = rtp->getSeq();
     _nack_cache_seq.emplace_back(seq);
     _nack_cache_pkt.emplace(seq, std::move(rtp));
 
@@ -74,20 +73,26 @@ void NackList::pushBack(RtpPacket::Ptr rtp) {
     }
 }
 
-void NackList::forEach(const FCI_NACK &nack, const function<void(const RtpPacket::Ptr &rtp)> &func) {
+void NackList::forEach(const FCI_NACK &nack, const function<void(const RtpPacket::Ptr &rtp, uint16_t seq)> &func) {
     auto seq = nack.getPid();
     for (auto bit : nack.getBitArray()) {
         if (bit) {
             // 丢包
             RtpPacket::Ptr *ptr = getRtp(seq);
             if (ptr) {
-                func(*ptr);
+                func(*ptr, seq);
             }
         }
         ++seq;
     }
 }
 
+void NackList::clear() {
+    _cache_ms_check = 0;
+    _nack_cache_seq.clear();
+    _nack_cache_pkt.clear();
+}
+
 void NackList::popFront() {
     if (_nack_cache_seq.empty()) {
         return;
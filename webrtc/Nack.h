@@ -31,8 +31,15 @@ extern const std::string kNackMaxMS;
 
 class NackList {
 public:
-    void pushBack(RtpPacket::Ptr rtp);
-    void forEach(const FCI_NACK &nack, const std::function<void(const RtpPacket::Ptr &rtp)> &cb);
+    /**
+     * 缓存已发送的rtp
+     * @param rtp rtp包
+     * @param seq 实际发送的rtp seq(丢帧后发送的seq与rtp包中的seq可能不一致)
+     */
+    void pushBack(RtpPacket::Ptr rtp, uint16_t seq);
+    void forEach(const FCI_NACK &nack, const std::function<void(const RtpPacket::Ptr &rtp, uint16_t seq)> &cb);
+    // 清空缓存的rtp
+    void clear();
 
 private:
     void popFront();
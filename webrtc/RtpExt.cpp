@@ -361,6 +361,63 @@ uint16_t RtpExt::getTransportCCSeq() const {
     return ret;
 }
 
+void RtpExt::setTransportCCSeq(uint16_t seq) {
+    CHECK(_type == RtpExtType::transport_cc && size() >= 2);
+    auto ptr = (uint8_t *)_data;
+    ptr[0] = seq >> 8;
+    ptr[1] = seq & 0xFF;
+}
+
+size_t RtpExt::appendTransportCCSeq(RtpHeader *header, size_t len, uint8_t ext_id, uint16_t seq) {
+    auto csrc_size = header->getCsrcSize();
+    if (len < RtpPacket::kRtpHeaderSize + csrc_size + header->getExtSize() + (header->ext ? 4 : 0)) {
+        return 0;
+    }
+    auto ext_ptr = &header->payload + csrc_size;
+    if (!header->ext) {
+        // 没有扩展头，新增4字节扩展头与4字节transport-cc扩展
+        memmove(ext_ptr + 8, ext_ptr, len - RtpPacket::kRtpHeaderSize - csrc_size);
+        if (ext_id < (int)RtpExtType::reserved) {
+            uint8_t ext[] = { kOneByteHeader >> 8, kOneByteHeader & 0xFF, 0, 1, (uint8_t)(ext_id << 4 | 1), (uint8_t)(seq >> 8), (uint8_t)(seq & 0xFF), 0 };
+            memcpy(ext_ptr, ext, sizeof(ext));
+        } else {
+            uint8_t ext[] = { kTwoByteHeader >> 8, kTwoByteHeader & 0xFF, 0, 1, ext_id, 2, (uint8_t)(seq >> 8), (uint8_t)(seq & 0xFF) };
+            memcpy(ext_ptr, ext, sizeof(ext));
+        }
+        header->ext = 1;
+        return len + 8;
+    }
+
+    uint8_t ext[4];
+    auto reserved = header->getExtReserved();
+    if (reserved == kOneByteHeader) {
+        if (ext_id >= (int)RtpExtType::reserved) {
+            return 0;
+        }
+        ext[0] = ext_id << 4 | 1;
+        ext[1] = seq >> 8;
+        ext[2] = seq & 0xFF;
+        // padding
+        ext[3] = 0;
+    } else if ((reserved & 0xFFF0) == kTwoByteHeader) {
+        ext[0] = ext_id;
+        ext[1] = 2;
+        ext[2] = seq >> 8;
+        ext[3] = seq & 0xFF;
+    } else {
+        // 不识别的扩展头
+        return 0;
+    }
+    auto ext_end = header->getExtData() + header->getExtSize();
+    memmove(ext_end + 4, ext_end, len - (ext_end - (uint8_t *)header));
+    memcpy(ext_end, ext, sizeof(ext));
+    // 扩展长度单位为4字节
+    auto ext_len = (header->getExtSize() >> 2) + 1;
+    ext_ptr[2] = ext_len >> 8;
+    ext_ptr[3] = ext_len & 0xFF;
+    return len + 4;
+}
+
 //https://tools.ietf.org/html/draft-ietf-avtext-sdes-hdr-ext-07
 //    0                   1                   2                   3
 //    0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
@@ -636,6 +693,11 @@ RtpExt RtpExtContext::changeRtpExtId(const RtpHeader *header, bool is_recv, stri
     return ret;
 }
 
+uint8_t RtpExtContext::getExtId(RtpExtType type) const {
+    auto it = _rtp_ext_type_to_id.find(type);
+    return it == _rtp_ext_type_to_id.end() ? 0 : it->second;
+}
+
 void RtpExtContext::setOnGetRtp(OnGetRtp cb) {
     _cb = std::move(cb);
 }
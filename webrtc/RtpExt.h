@@ -59,6 +59,16 @@ public:
     static const std::string& getExtUrl(RtpExtType type);
     static const char *getExtName(RtpExtType type);
 
+    /**
+     * 在rtp扩展头末尾追加transport-cc扩展，调用方需确保rtp后有至少8个字节的空闲内存
+     * @param header rtp头
+     * @param len rtp长度
+     * @param ext_id transport-cc扩展id
+     * @param seq transport-cc序号
+     * @return 追加扩展后的rtp长度，无法追加时返回0
+     */
+    static size_t appendTransportCCSeq(RtpHeader *header, size_t len, uint8_t ext_id, uint16_t seq);
+
     void setType(RtpExtType type);
     RtpExtType getType() const;
     std::string dumpString() const;
@@ -66,6 +76,7 @@ public:
     uint8_t getAudioLevel(bool *vad) const;
     uint32_t getAbsSendTime() const;
     uint16_t getTransportCCSeq() const;
+    void setTransportCCSeq(uint16_t seq);
     std::string getSdesMid() const;
     std::string getRtpStreamId() const;
     std::string getRepairedRtpStreamId() const;
@@ -123,6 +134,8 @@ public:
     std::string getRid(uint32_t ssrc) const;
     void setRid(uint32_t ssrc, const std::string &rid);
     RtpExt changeRtpExtId(const RtpHeader *header, bool is_recv, std::string *rid_ptr = nullptr, RtpExtType type = RtpExtType::padding);
+    //获取客户端sdp声明的ext id，不支持时返回0
+    uint8_t getExtId(RtpExtType type) const;
 
 private:
     void onGetRtp(uint8_t pt, uint32_t ssrc, const std::string &rid);
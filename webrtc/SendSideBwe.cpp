@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "SendSideBwe.h"
+#include "Rtcp/RtcpFCI.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+// 保存的已发送rtp记录个数
+static constexpr size_t kMaxSentPackets = 4096;
+// 发送时间在5ms内的rtp视为同一组
+static constexpr uint64_t kBurstTimeUs = 5 * 1000;
+// trendline滤波器窗口大小
+static constexpr size_t kTrendlineWindowSize = 20;
+static constexpr double kTrendlineSmoothing = 0.9;
+static constexpr double kTrendlineThresholdGain = 4.0;
+// 统计对端接收码率的时间窗口
+static constexpr int64_t kAckedWindowUs = 500 * 1000;
+// 最小估算码率
+static constexpr uint32_t kMinBitrate = 50 * 1000;
+
+SendSideBwe::SendSideBwe() : _sent_packets(kMaxSentPackets) {}
+
+void SendSideBwe::setBitrateRange(uint32_t min_bitrate, uint32_t max_bitrate) {
+    _min_bitrate = min_bitrate;
+    _max_bitrate = max_bitrate;
+}
+
+void SendSideBwe::onSendRtp(uint16_t twcc_seq, size_t size, uint64_t now_us) {
+    auto &pkt = _sent_packets[twcc_seq % kMaxSentPackets];
+    pkt.valid = true;
+    pkt.seq = twcc_seq;
+    pkt.size = (uint32_t)size;
+    pkt.send_us = now_us;
+}
+
+void SendSideBwe::onTwccFeedback(const FCI_TWCC &fci, size_t fci_size, uint64_t now_us) {
+    FCI_TWCC::TwccPacketStatus status;
+    try {
+        status = fci.getPacketChunkList(fci_size);
+    } catch (std::exception &ex) {
+        WarnL << "parse twcc feedback failed:" << ex.what();
+        return;
+    }
+
+    // 参考时间单位为64ms
+    int64_t arrival_us = (int64_t)fci.getReferenceTime() * 64 * 1000;
+    uint32_t lost = 0, total = 0;
+    auto seq = fci.getBaseSeq();
+    auto count = fci.getPacketCount();
+    for (uint16_t i = 0; i < count; ++i, ++seq) {
+        auto it = status.find(seq);
+        if (it == status.end()) {
+            continue;
+        }
+        auto received = it->second.first != SymbolStatus::not_received;
+        if (received) {
+            // 接收时间增量是相对于上一个接收到的包，单位250us
+            arrival_us += (int64_t)it->second.second * 250;
+        }
+        auto &sent = _sent_packets[seq % kMaxSentPackets];
+        if (!sent.valid || sent.seq != seq) {
+            continue;
+        }
+        ++total;
+        if (!received) {
+            ++lost;
+            continue;
+        }
+        // 同一个包只统计一次
+        sent.valid = false;
+        onPacketArrival(sent.send_us, arrival_us, sent.size);
+    }
+
+    updateLossBasedBitrate(lost, total, now_us);
+    updateDelayBasedBitrate(now_us);
+}
+
+void SendSideBwe::onPacketArrival(uint64_t send_us, int64_t arrival_us, size_t size) {
+    updateAckedBitrate(arrival_us, size);
+
+    if (!_cur_group.valid) {
+        _cur_group.valid = true;
+        _cur_group.first_send_us = _cur_group.last_send_us = send_us;
+        _cur_group.last_arrival_us = arrival_us;
+        return;
+    }
+
+    if (send_us < _cur_group.first_send_us) {
+        // 乱序的包不参与延时估算
+        return;
+    }
+
+    if (send_us - _cur_group.first_send_us <= kBurstTimeUs) {
+        _cur_group.last_send_us = MAX(_cur_group.last_send_us, send_us);
+        _cur_group.last_arrival_us = MAX(_cur_group.last_arrival_us, arrival_us);
+        return;
+    }
+
+    // 新的一组开始，计算上两组间的单向延时变化
+    if (_prev_group.valid) {
+        auto send_delta_ms = (double)(_cur_group.last_send_us - _prev_group.last_send_us) / 1000.0;
+        auto arrival_delta_ms = (double)(_cur_group.last_arrival_us - _prev_group.last_arrival_us) / 1000.0;
+        updateTrendline(arrival_delta_ms - send_delta_ms, _cur_group.last_arrival_us / 1000);
+    }
+    _prev_group = _cur_group;
+    _cur_group.first_send_us = _cur_group.last_send_us = send_us;
+    _cur_group.last_arrival_us = arrival_us;
+}
+
+void SendSideBwe::updateTrendline(double delay_variation_ms, int64_t arrival_ms) {
+    if (_first_arrival_ms < 0) {
+        _first_arrival_ms = arrival_ms;
+    }
+    _num_of_deltas = MIN(_num_of_deltas + 1, 1000u);
+    _accumulated_delay += delay_variation_ms;
+    _smoothed_delay = kTrendlineSmoothing * _smoothed_delay + (1 - kTrendlineSmoothing) * _accumulated_delay;
+    _delay_hist.emplace_back((double)(arrival_ms - _first_arrival_ms), _smoothed_delay);
+    if (_delay_hist.size() > kTrendlineWindowSize) {
+        _delay_hist.pop_front();
+    }
+
+    auto trend = _prev_trend;
+    if (_delay_hist.size() == kTrendlineWindowSize) {
+        // 线性回归求延时变化斜率
+        double sum_x = 0, sum_y = 0;
+        for (auto &pr : _delay_hist) {
+            sum_x += pr.first;
+            sum_y += pr.second;
+        }
+        auto avg_x = sum_x / _delay_hist.size();
+        auto avg_y = sum_y / _delay_hist.size();
+        double numerator = 0, denominator = 0;
+        for (auto &pr : _delay_hist) {
+            numerator += (pr.first - avg_x) * (pr.second - avg_y);
+            denominator += (pr.first - avg_x) * (pr.first - avg_x);
+        }
+        if (denominator != 0) {
+            trend = numerator / denominator;
+        }
+    }
+    detectOveruse(trend, arrival_ms);
+}
+
+void SendSideBwe::detectOveruse(double trend, int64_t arrival_ms) {
+    auto modified_trend = MIN(_num_of_deltas, 60u) * trend * kTrendlineThresholdGain;
+    auto ts_delta = _last_trend_arrival_ms < 0 ? 5.0 : (double)(arrival_ms - _last_trend_arrival_ms);
+    _last_trend_arrival_ms = arrival_ms;
+
+    if (modified_trend > _threshold) {
+        if (_time_over_using < 0) {
+            _time_over_using = ts_delta / 2;
+        } else {
+            _time_over_using += ts_delta;
+        }
+        ++_overuse_counter;
+        // 持续过载10ms以上且趋势未好转时判定为过载
+        if (_time_over_using > 10 && _overuse_counter > 1 && trend >= _prev_trend) {
+            _time_over_using = 0;
+            _overuse_counter = 0;
+            _usage = BandwidthUsage::overuse;
+        }
+    } else if (modified_trend < -_threshold) {
+        _time_over_using = -1;
+        _overuse_counter = 0;
+        _usage = BandwidthUsage::underuse;
+    } else {
+        _time_over_using = -1;
+        _overuse_counter = 0;
+        _usage = BandwidthUsage::normal;
+    }
+    _prev_trend = trend;
+
+    // 自适应调整过载门限
+    if (_last_threshold_update_ms < 0) {
+        _last_threshold_update_ms = arrival_ms;
+    }
+    auto abs_trend = fabs(modified_trend);
+    if (abs_trend > _threshold + 15) {
+        // 突发的延时抖动不参与门限调整
+        _last_threshold_update_ms = arrival_ms;
+        return;
+    }
+    auto k = abs_trend < _threshold ? 0.039 : 0.0087;
+    auto dt = (double)MIN(arrival_ms - _last_threshold_update_ms, (int64_t)100);
+    _threshold += k * (abs_trend - _threshold) * dt;
+    _threshold = MAX(6.0, MIN(_threshold, 600.0));
+    _last_threshold_update_ms = arrival_ms;
+}
+
+void SendSideBwe::updateAckedBitrate(int64_t arrival_us, size_t size) {
+    _acked_window.emplace_back(arrival_us, size);
+    _acked_bytes += size;
+    while (_acked_window.size() > 1 && arrival_us - _acked_window.front().first > kAckedWindowUs) {
+        _acked_bytes -= _acked_window.front().second;
+        _acked_window.pop_front();
+    }
+    auto span_us = MAX(arrival_us - _acked_window.front().first, (int64_t)100 * 1000);
+    _acked_bitrate = (uint32_t)(_acked_bytes * 8 * 1000 * 1000 / span_us);
+}
+
+void SendSideBwe::updateDelayBasedBitrate(uint64_t now_us) {
+    if (!_acked_bitrate) {
+        return;
+    }
+    if (_delay_based_bitrate <= 0) {
+        _delay_based_bitrate = _acked_bitrate;
+        _last_delay_update_us = now_us;
+        return;
+    }
+
+    switch (_usage) {
+        case BandwidthUsage::overuse: {
+            // 过载时降低到对端实际接收码率的85%，每200ms最多降低一次
+            if (now_us - _last_decrease_us > 200 * 1000) {
+                _delay_based_bitrate = MIN(_delay_based_bitrate, 0.85 * _acked_bitrate);
+                _last_decrease_us = now_us;
+            }
+            break;
+        }
+        case BandwidthUsage::underuse: /*网络队列在排空，保持码率*/ break;
+        case BandwidthUsage::normal: {
+            // 每秒增加8%，但不超过对端接收码率的1.5倍
+            auto dt = MIN(now_us - _last_delay_update_us, (uint64_t)1000 * 1000) / 1000000.0;
+            auto limit = 1.5 * _acked_bitrate + 10 * 1000;
+            if (_delay_based_bitrate < limit) {
+                _delay_based_bitrate = MIN(_delay_based_bitrate * pow(1.08, dt), limit);
+            }
+            break;
+        }
+        default: break;
+    }
+    _last_delay_update_us = now_us;
+}
+
+void SendSideBwe::updateLossBasedBitrate(uint32_t lost, uint32_t total, uint64_t now_us) {
+    if (!total) {
+        return;
+    }
+    _loss_rate = 0.8f * _loss_rate + 0.2f * ((float)lost / total);
+    if (!_acked_bitrate) {
+        return;
+    }
+    if (_loss_based_bitrate <= 0) {
+        _loss_based_bitrate = 1.5 * _acked_bitrate;
+        _last_loss_update_us = now_us;
+        return;
+    }
+
+    if (_loss_rate > 0.1f) {
+        // 丢包率大于10%时按丢包率降低码率，每300ms最多降低一次
+        if (now_us - _last_loss_update_us > 300 * 1000) {
+            _loss_based_bitrate *= (1 - 0.5 * _loss_rate);
+            _last_loss_update_us = now_us;
+        }
+    } else if (_loss_rate < 0.02f) {
+        // 丢包率小于2%时每秒增加5%
+        if (now_us - _last_loss_update_us > 1000 * 1000) {
+            _loss_based_bitrate = MIN(_loss_based_bitrate * 1.05, 1.5 * _acked_bitrate + 10 * 1000);
+            _last_loss_update_us = now_us;
+        }
+    }
+}
+
+uint32_t SendSideBwe::clampBitrate(double bitrate) const {
+    bitrate = MAX(bitrate, (double)MAX(_min_bitrate, kMinBitrate));
+    if (_max_bitrate) {
+        bitrate = MIN(bitrate, (double)_max_bitrate);
+    }
+    return (uint32_t)bitrate;
+}
+
+uint32_t SendSideBwe::getEstimatedBitrate() const {
+    if (_delay_based_bitrate <= 0) {
+        return 0;
+    }
+    auto bitrate = _delay_based_bitrate;
+    if (_loss_based_bitrate > 0) {
+        bitrate = MIN(bitrate, _loss_based_bitrate);
+    }
+    return clampBitrate(bitrate);
+}
+
+uint32_t SendSideBwe::getAckedBitrate() const {
+    return _acked_bitrate;
+}
+
+float SendSideBwe::getLossRate() const {
+    return _loss_rate;
+}
+
+SendSideBwe::BandwidthUsage SendSideBwe::getBandwidthUsage() const {
+    return _usage;
+}
+
+const char *SendSideBwe::getBandwidthUsageName(BandwidthUsage usage) {
+    switch (usage) {
+        case BandwidthUsage::normal: return "normal";
+        case BandwidthUsage::overuse: return "overuse";
+        case BandwidthUsage::underuse: return "underuse";
+        default: return "unknown";
+    }
+}
+
+} // namespace mediakit
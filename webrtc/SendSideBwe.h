@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2016-present The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/ZLMediaKit/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT-like license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_SENDSIDEBWE_H
+#define ZLMEDIAKIT_SENDSIDEBWE_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+namespace mediakit {
+
+class FCI_TWCC;
+
+/**
+ * 基于twcc反馈的发送端带宽估算(参考GCC算法)
+ * 延时估算：按发送时间把rtp分组，通过trendline滤波器计算单向延时的变化趋势，判断网络是否过载
+ * 丢包估算：根据twcc反馈中的丢包率调整码率
+ * 最终估算码率取两者中的较小值
+ */
+class SendSideBwe {
+public:
+    enum class BandwidthUsage : int {
+        normal = 0,
+        overuse,
+        underuse,
+    };
+
+    SendSideBwe();
+
+    /**
+     * 设置估算码率的范围，单位bps，0表示不限制
+     */
+    void setBitrateRange(uint32_t min_bitrate, uint32_t max_bitrate);
+
+    /**
+     * 记录发送的rtp
+     * @param twcc_seq transport-cc扩展中的序号
+     * @param size rtp大小
+     * @param now_us 发送时间，单位微秒
+     */
+    void onSendRtp(uint16_t twcc_seq, size_t size, uint64_t now_us);
+
+    /**
+     * 收到twcc反馈
+     * @param fci twcc rtcp中的fci
+     * @param fci_size fci长度
+     * @param now_us 当前时间，单位微秒
+     */
+    void onTwccFeedback(const FCI_TWCC &fci, size_t fci_size, uint64_t now_us);
+
+    /**
+     * 获取估算码率，单位bps，未收到反馈时返回0
+     */
+    uint32_t getEstimatedBitrate() const;
+
+    /**
+     * 获取对端确认接收的码率，单位bps
+     */
+    uint32_t getAckedBitrate() const;
+
+    /**
+     * 获取最近的丢包率，取值范围[0, 1]
+     */
+    float getLossRate() const;
+
+    BandwidthUsage getBandwidthUsage() const;
+    static const char *getBandwidthUsageName(BandwidthUsage usage);
+
+private:
+    void onPacketArrival(uint64_t send_us, int64_t arrival_us, size_t size);
+    void updateTrendline(double delay_variation_ms, int64_t arrival_ms);
+    void detectOveruse(double trend, int64_t arrival_ms);
+    void updateAckedBitrate(int64_t arrival_us, size_t size);
+    void updateDelayBasedBitrate(uint64_t now_us);
+    void updateLossBasedBitrate(uint32_t lost, uint32_t total, uint64_t now_us);
+    uint32_t clampBitrate(double bitrate) const;
+
+private:
+    struct SentPacket {
+        bool valid = false;
+        uint16_t seq = 0;
+        uint32_t size = 0;
+        uint64_t send_us = 0;
+    };
+
+    struct PacketGroup {
+        bool valid = false;
+        uint64_t first_send_us = 0;
+        uint64_t last_send_us = 0;
+        int64_t last_arrival_us = 0;
+    };
+
+    uint32_t _min_bitrate = 0;
+    uint32_t _max_bitrate = 0;
+
+    // 已发送rtp记录，按twcc序号取模索引
+    std::vector<SentPacket> _sent_packets;
+
+    // 按发送时间分组
+    PacketGroup _cur_group;
+    PacketGroup _prev_group;
+
+    // trendline滤波器
+    int64_t _first_arrival_ms = -1;
+    double _accumulated_delay = 0;
+    double _smoothed_delay = 0;
+    uint32_t _num_of_deltas = 0;
+    std::deque<std::pair<double /*arrival ms*/, double /*smoothed delay*/>> _delay_hist;
+
+    // 过载检测
+    double _threshold = 12.5;
+    double _prev_trend = 0;
+    double _time_over_using = -1;
+    int _overuse_counter = 0;
+    int64_t _last_threshold_update_ms = -1;
+    int64_t _last_trend_arrival_ms = -1;
+    BandwidthUsage _usage = BandwidthUsage::normal;
+
+    // 对端确认接收的码率统计
+    std::deque<std::pair<int64_t /*arrival us*/, size_t /*size*/>> _acked_window;
+    size_t _acked_bytes = 0;
+    uint32_t _acked_bitrate = 0;
+
+    // 码率控制
+    double _delay_based_bitrate = 0;
+    double _loss_based_bitrate = 0;
+    float _loss_rate = 0;
+    uint64_t _last_delay_update_us = 0;
+    uint64_t _last_loss_update_us = 0;
+    uint64_t _last_decrease_us = 0;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_SENDSIDEBWE_H
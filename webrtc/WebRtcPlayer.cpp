@@ -8,7 +8,9 @@
  * may be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <algorithm>
 #include "WebRtcPlayer.h"
+#include "WebRtcPusher.h"
 
 #include "Common/config.h"
 #include "Extension/Factory.h"
@@ -18,6 +20,20 @@ using namespace std;
 
 namespace mediakit {
 
+// 检查是否需要切换simulcast层的间隔
+static constexpr uint64_t kCheckLayerMS = 1000;
+// 升层前带宽需要持续满足的时长
+static constexpr uint64_t kUpgradeLayerMS = 5000;
+
+static std::shared_ptr<WebRtcPusher> getSimulcastPusher(const RtspMediaSource::Ptr &src) {
+    // rtsp源的事件先经过MultiMediaSourceMuxer等拦截器，再交给推流器处理
+    auto listener = src->getListener().lock();
+    while (auto interceptor = dynamic_pointer_cast<MediaSourceEventInterceptor>(listener)) {
+        listener = interceptor->getDelegate();
+    }
+    return dynamic_pointer_cast<WebRtcPusher>(listener);
+}
+
 WebRtcPlayer::Ptr WebRtcPlayer::create(const EventPoller::Ptr &poller,
                                        const RtspMediaSource::Ptr &src,
                                        const MediaInfo &info) {
@@ -48,57 +64,356 @@ void WebRtcPlayer::onStartWebRTC() {
     }
     WebRtcTransportImp::onStartWebRTC();
     if (canSendRtp()) {
-        playSrc->pause(false);
-        _reader = playSrc->getRing()->attach(getPoller(), true);
-        weak_ptr<WebRtcPlayer> weak_self = static_pointer_cast<WebRtcPlayer>(shared_from_this());
-        weak_ptr<Session> weak_session = static_pointer_cast<Session>(getSession());
-        _reader->setGetInfoCB([weak_session]() {
-            Any ret;
-            ret.set(static_pointer_cast<SockInfo>(weak_session.lock()));
-            return ret;
-        });
-        _reader->setReadCB([weak_self](const RtspMediaSource::RingDataType &pkt) {
-            auto strong_self = weak_self.lock();
-            if (!strong_self) {
-                return;
+        for (auto &track : playSrc->getTracks(false)) {
+            if (track->getTrackType() == TrackVideo) {
+                _video_codec = track->getCodecId();
             }
+        }
+        _reader = attachReader(playSrc, true);
 
-            if (strong_self->_send_config_frames_once && !pkt->empty()) {
-                const auto &first_rtp = pkt->front();
-                strong_self->sendConfigFrames(first_rtp->getSeq(), first_rtp->sample_rate, first_rtp->getStamp(), first_rtp->ntp_stamp);
-                strong_self->_send_config_frames_once = false;
+        auto pusher = getSimulcastPusher(playSrc);
+        if (pusher) {
+            // 播放的是rtc推流，可能是simulcast推流，定时检查是否需要切换层
+            _simulcast_pusher = pusher;
+            for (auto &pr : pusher->getSimulcastSources()) {
+                if (pr.second == playSrc) {
+                    _cur_rid = pr.first;
+                }
             }
-
-            size_t i = 0;
-            pkt->for_each([&](const RtpPacket::Ptr &rtp) {
-                //TraceL<<"send track type:"<<rtp->type<<" ts:"<<rtp->getStamp()<<" ntp:"<<rtp->ntp_stamp<<" size:"<<rtp->getPayloadSize()<<" i:"<<i;
-                strong_self->onSendRtp(rtp, ++i == pkt->size());
+            weak_ptr<WebRtcPlayer> weak_self = static_pointer_cast<WebRtcPlayer>(shared_from_this());
+            getPoller()->doDelayTask(kCheckLayerMS, [weak_self]() -> uint64_t {
+                auto strong_self = weak_self.lock();
+                if (!strong_self) {
+                    return 0;
+                }
+                strong_self->checkSimulcastLayer();
+                return kCheckLayerMS;
             });
-        });
-        _reader->setDetachCB([weak_self]() {
-            auto strong_self = weak_self.lock();
-            if (!strong_self) {
-                return;
+        }
+    }
+}
+
+RtspMediaSource::RingType::RingReader::Ptr WebRtcPlayer::attachReader(const RtspMediaSource::Ptr &src, bool use_cache) {
+    src->pause(false);
+    auto reader = src->getRing()->attach(getPoller(), use_cache);
+    // 区分当前层与切换中的目标层的reader
+    auto reader_ptr = reader.get();
+    weak_ptr<WebRtcPlayer> weak_self = static_pointer_cast<WebRtcPlayer>(shared_from_this());
+    weak_ptr<Session> weak_session = static_pointer_cast<Session>(getSession());
+    reader->setGetInfoCB([weak_session]() {
+        Any ret;
+        ret.set(static_pointer_cast<SockInfo>(weak_session.lock()));
+        return ret;
+    });
+    reader->setReadCB([weak_self, reader_ptr](const RtspMediaSource::RingDataType &pkt) {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        strong_self->onReadRtpList(reader_ptr, pkt);
+    });
+    reader->setDetachCB([weak_self, reader_ptr]() {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return;
+        }
+        if (reader_ptr == strong_self->_next_reader.get()) {
+            // 目标层注销了，放弃切换
+            strong_self->_next_reader = nullptr;
+            strong_self->_next_rid.clear();
+            return;
+        }
+        strong_self->onShutdown(SockException(Err_shutdown, "rtsp ring buffer detached"));
+    });
+
+    reader->setMessageCB([weak_self, reader_ptr] (const toolkit::Any &data) {
+        auto strong_self = weak_self.lock();
+        if (!strong_self || reader_ptr != strong_self->_reader.get()) {
+            return;
+        }
+        if (data.is<Buffer>()) {
+            auto &buffer = data.get<Buffer>();
+            // PPID 51: 文本string
+            // PPID 53: 二进制
+            strong_self->sendDatachannel(0, 51, buffer.data(), buffer.size());
+        } else {
+            WarnL << "Send unknown message type to webrtc player: " << data.type_name();
+        }
+    });
+    return reader;
+}
+
+void WebRtcPlayer::onReadRtpList(RtspMediaSource::RingType::RingReader *reader, const RtspMediaSource::RingDataType &pkt) {
+    if (reader == _next_reader.get()) {
+        if (!pkt->isKeyPos()) {
+            // 等待目标层的关键帧
+            return;
+        }
+        // 在关键帧处切换到目标层
+        InfoL << "webrtc player switch simulcast layer: " << _cur_rid << " -> " << _next_rid << ", " << _media_info.shortUrl();
+        _reader = std::move(_next_reader);
+        _play_src = _next_src;
+        _cur_rid = std::move(_next_rid);
+        _next_rid.clear();
+        bool changed = false;
+        pkt->for_each([&](const RtpPacket::Ptr &rtp) {
+            if (!changed && rtp->type == TrackVideo) {
+                // 视频seq与时间戳紧接上一层，播放器看到的是同一路连续的流
+                onChangeRtpSource(rtp);
+                changed = true;
             }
-            strong_self->onShutdown(SockException(Err_shutdown, "rtsp ring buffer detached"));
         });
+        _skip_old_audio = _have_audio_seq;
+        _have_video_stamp = false;
+        _wait_key_frame = false;
+    } else if (reader != _reader.get()) {
+        return;
+    }
+
+    if (_send_config_frames_once && !pkt->empty()) {
+        const auto &first_rtp = pkt->front();
+        sendConfigFrames(first_rtp->getSeq(), first_rtp->sample_rate, first_rtp->getStamp(), first_rtp->ntp_stamp);
+        _send_config_frames_once = false;
+    }
+    sendRtpList(pkt);
+}
+
+bool WebRtcPlayer::setSimulcastLayer(const std::string &rid) {
+    if (!rid.empty()) {
+        auto pusher = _simulcast_pusher.lock();
+        if (!pusher) {
+            return false;
+        }
+        auto layers = pusher->getSimulcastSources();
+        if (layers.find(rid) == layers.end()) {
+            return false;
+        }
+    } else if (_simulcast_pusher.expired()) {
+        return false;
+    }
+    _fixed_rid = rid;
+    _upgrade_pending = false;
+    checkSimulcastLayer();
+    return true;
+}
+
+std::vector<std::pair<std::string, RtspMediaSource::Ptr>> WebRtcPlayer::getSimulcastLayers() const {
+    std::vector<std::pair<std::string, RtspMediaSource::Ptr>> ret;
+    auto pusher = _simulcast_pusher.lock();
+    if (!pusher) {
+        return ret;
+    }
+    std::vector<std::pair<int, size_t>> speeds;
+    for (auto &pr : pusher->getSimulcastSources()) {
+        auto speed = pr.second->getBytesSpeed(TrackVideo);
+        if (speed > 0) {
+            speeds.emplace_back(speed, ret.size());
+            ret.emplace_back(pr);
+        }
+    }
+    std::sort(speeds.begin(), speeds.end());
+    std::vector<std::pair<std::string, RtspMediaSource::Ptr>> sorted;
+    for (auto &pr : speeds) {
+        sorted.emplace_back(std::move(ret[pr.second]));
+    }
+    return sorted;
+}
+
+void WebRtcPlayer::checkSimulcastLayer() {
+    auto layers = getSimulcastLayers();
+    if (layers.empty()) {
+        return;
+    }
+    auto play_src = _play_src.lock();
+    int cur = -1;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (layers[i].second == play_src) {
+            cur = (int)i;
+        }
+    }
 
-        _reader->setMessageCB([weak_self] (const toolkit::Any &data) {
-            auto strong_self = weak_self.lock();
-            if (!strong_self) {
-                return;
+    int target = -1;
+    GET_CONFIG(bool, auto_switch, Rtc::kSimulcastAutoSwitch);
+    auto bitrate = getEstimatedBitrate();
+    if (!_fixed_rid.empty()) {
+        for (size_t i = 0; i < layers.size(); ++i) {
+            if (layers[i].first == _fixed_rid) {
+                target = (int)i;
             }
-            if (data.is<Buffer>()) {
-                auto &buffer = data.get<Buffer>();
-                // PPID 51: 文本string
-                // PPID 53: 二进制
-                strong_self->sendDatachannel(0, 51, buffer.data(), buffer.size());
-            } else {
-                WarnL << "Send unknown message type to webrtc player: " << data.type_name();
+        }
+    } else if (!auto_switch || !bitrate) {
+        // 未开启自动切换或没有带宽估算结果，保持当前层，未播放任何层时选择最高层
+        target = cur != -1 ? cur : (int)layers.size() - 1;
+    } else {
+        // 选择码率不超过估算带宽80%的最高层，都超过时选择最低层
+        target = 0;
+        for (size_t i = 0; i < layers.size(); ++i) {
+            if ((uint64_t)layers[i].second->getBytesSpeed(TrackVideo) * 8 * 5 <= (uint64_t)bitrate * 4) {
+                target = (int)i;
             }
-        });
+        }
+        if (cur != -1 && target > cur) {
+            // 升层需要带宽持续满足,降层立即执行
+            if (!_upgrade_pending) {
+                _upgrade_pending = true;
+                _upgrade_ticker.resetTime();
+            }
+            if (_upgrade_ticker.elapsedTime() < kUpgradeLayerMS) {
+                target = cur;
+            }
+        } else {
+            _upgrade_pending = false;
+        }
+    }
+
+    if (target == -1 || target == cur) {
+        // 无需切换，取消切换中的目标层
+        _next_reader = nullptr;
+        _next_rid.clear();
+        return;
+    }
+    _upgrade_pending = false;
+    switchSimulcastLayer(layers[target].first, layers[target].second);
+}
+
+void WebRtcPlayer::switchSimulcastLayer(const std::string &rid, const RtspMediaSource::Ptr &src) {
+    if (_next_reader && _next_rid == rid) {
+        // 已经在等待该层的关键帧
+        return;
+    }
+    InfoL << "webrtc player prepare switch simulcast layer: " << _cur_rid << " -> " << rid
+          << ", estimated bitrate:" << getEstimatedBitrate() << ", " << _media_info.shortUrl();
+    _next_rid = rid;
+    _next_src = src;
+    // 不使用gop缓存，等待下一个关键帧再切换，避免时间戳回退
+    _next_reader = attachReader(src, false);
+}
+
+bool WebRtcPlayer::checkAudioSeq(const RtpPacket::Ptr &rtp) {
+    auto seq = rtp->getSeq();
+    if (_skip_old_audio) {
+        if ((int16_t)(seq - _audio_seq) <= 0) {
+            // 切换层后，目标层中已经发送过的音频
+            return false;
+        }
+        _skip_old_audio = false;
+    }
+    _have_audio_seq = true;
+    _audio_seq = seq;
+    return true;
+}
+
+#ifdef ENABLE_SCTP
+void WebRtcPlayer::OnSctpAssociationMessageReceived(RTC::SctpAssociation *sctpAssociation, uint16_t streamId, uint32_t ppid,
+                                                    const uint8_t *msg, size_t len) {
+    WebRtcTransportImp::OnSctpAssociationMessageReceived(sctpAssociation, streamId, ppid, msg, len);
+    // 播放器通过datachannel发送文本消息"simulcast=rid"指定播放的层，rid为空时自动切换
+    static const string kSimulcastPrefix = "simulcast=";
+    string str((char *)msg, len);
+    if (ppid != 51 || !start_with(str, kSimulcastPrefix)) {
+        return;
     }
+    auto rid = str.substr(kSimulcastPrefix.size());
+    trim(rid);
+    auto ok = setSimulcastLayer(rid);
+    string reply = (ok ? "simulcast ok: " : "simulcast failed: ") + rid;
+    sendDatachannel(streamId, 51, reply.data(), reply.size());
 }
+#endif
+
+void WebRtcPlayer::sendRtpList(const RtspMediaSource::RingDataType &pkt) {
+    auto bitrate = getEstimatedBitrate();
+    // 未开启带宽估算或尚未收到twcc反馈时全部发送
+    if (bitrate) {
+        markDropRtp(pkt, bitrate);
+    }
+    // 发送延后一个包，以便最后一个实际发送的rtp负责flush(音频或视频都可能被过滤)
+    RtpPacket::Ptr pending;
+    size_t i = 0;
+    pkt->for_each([&](const RtpPacket::Ptr &rtp) {
+        auto index = i++;
+        if (rtp->type == TrackAudio && !checkAudioSeq(rtp)) {
+            return;
+        }
+        if (bitrate && _drop_flags[index]) {
+            // 丢弃的rtp不占用seq，保证播放器收到的seq连续，不触发nack
+            onDropRtp(rtp);
+            return;
+        }
+        if (pending) {
+            onSendRtp(pending, false);
+        }
+        pending = rtp;
+    });
+    if (pending) {
+        onSendRtp(pending, true);
+    }
+}
+
+void WebRtcPlayer::markDropRtp(const RtspMediaSource::RingDataType &pkt, uint32_t bitrate) {
+    // 令牌按估算码率的1.25倍发放，最多累积1秒
+    auto byte_rate = (int64_t)bitrate * 5 / 4 / 8;
+    _send_budget = MIN(_send_budget + byte_rate * (int64_t)_budget_ticker.elapsedTime() / 1000, byte_rate);
+    _budget_ticker.resetTime();
+
+    if (pkt->isKeyPos()) {
+        _wait_key_frame = false;
+    }
+
+    _drop_flags.assign(pkt->size(), false);
+    size_t i = 0;
+    pkt->for_each([&](const RtpPacket::Ptr &rtp) {
+        auto index = i++;
+        if (rtp->type != TrackVideo) {
+            // 音频不丢弃
+            _send_budget -= rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+            return;
+        }
+        auto stamp = rtp->getStamp();
+        if (!_have_video_stamp || stamp != _video_stamp) {
+            // 新的一帧，按帧丢弃，避免发送不完整的帧
+            _have_video_stamp = true;
+            _video_stamp = stamp;
+            if (!_wait_key_frame && _send_budget < -2 * byte_rate) {
+                // 严重拥塞，丢弃视频直至下一个关键帧，清空欠账以便关键帧能发送出去
+                WarnL << "webrtc player congested, wait key frame, estimated bitrate:" << bitrate << ", " << _media_info.shortUrl();
+                _wait_key_frame = true;
+                _send_budget = 0;
+            }
+            _drop_cur_frame = _wait_key_frame || (_send_budget < 0 && isNonReferenceFrame(rtp));
+        }
+        if (_drop_cur_frame) {
+            _drop_flags[index] = true;
+            return;
+        }
+        _send_budget -= rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+    });
+}
+
+bool WebRtcPlayer::isNonReferenceFrame(const RtpPacket::Ptr &rtp) const {
+    auto payload = rtp->getPayload();
+    auto size = rtp->getPayloadSize();
+    switch (_video_codec) {
+        case CodecH264: {
+            // nal_ref_idc为0的帧不被其他帧参考，stap-a、fu-a的indicator中也携带nri
+            return size >= 1 && (payload[0] & 0x60) == 0;
+        }
+        case CodecH265: {
+            if (size < 3) {
+                return false;
+            }
+            auto type = (payload[0] >> 1) & 0x3F;
+            if (type == 49) {
+                // fu
+                type = payload[2] & 0x3F;
+            }
+            // TRAIL_N、TSA_N、STSA_N、RADL_N、RASL_N等子层非参考帧
+            return type <= 14 && type % 2 == 0;
+        }
+        default: return false;
+    }
+}
+
 void WebRtcPlayer::onDestory() {
     auto duration = getDuration();
     auto bytes_usage = getBytesUsage();
@@ -16,22 +16,53 @@
 
 namespace mediakit {
 
+class WebRtcPusher;
 class WebRtcPlayer : public WebRtcTransportImp {
 public:
     using Ptr = std::shared_ptr<WebRtcPlayer>;
     static Ptr create(const EventPoller::Ptr &poller, const RtspMediaSource::Ptr &src, const MediaInfo &info);
     MediaInfo getMediaInfo() { return _media_info; }
 
+    /**
+     * 指定播放的simulcast层，在目标层的下一个关键帧处切换
+     * 需要在所属poller线程调用
+     * @param rid 目标层的rid，为空时根据带宽估算自动切换
+     * @return 播放的不是simulcast推流或者没有该层时返回false
+     */
+    bool setSimulcastLayer(const std::string &rid);
+
+    /**
+     * 获取当前播放的simulcast层rid，需要在所属poller线程调用
+     */
+    const std::string &getSimulcastLayer() const { return _cur_rid; }
+
 protected:
     ///////WebRtcTransportImp override///////
     void onStartWebRTC() override;
     void onDestory() override;
     void onRtcConfigure(RtcConfigure &configure) const override;
+#ifdef ENABLE_SCTP
+    void OnSctpAssociationMessageReceived(RTC::SctpAssociation *sctpAssociation, uint16_t streamId, uint32_t ppid,
+                                          const uint8_t *msg, size_t len) override;
+#endif
 
 private:
     WebRtcPlayer(const EventPoller::Ptr &poller, const RtspMediaSource::Ptr &src, const MediaInfo &info);
 
+    RtspMediaSource::RingType::RingReader::Ptr attachReader(const RtspMediaSource::Ptr &src, bool use_cache);
+    void onReadRtpList(RtspMediaSource::RingType::RingReader *reader, const RtspMediaSource::RingDataType &pkt);
+    // 获取simulcast各层，按视频码率从低到高排序，忽略未收到视频的层
+    std::vector<std::pair<std::string, RtspMediaSource::Ptr>> getSimulcastLayers() const;
+    // 定时根据带宽估算或者指定的层选择目标层
+    void checkSimulcastLayer();
+    void switchSimulcastLayer(const std::string &rid, const RtspMediaSource::Ptr &src);
+    // 切换层后过滤重复的音频(各层的音频是同一路)
+    bool checkAudioSeq(const RtpPacket::Ptr &rtp);
     void sendConfigFrames(uint32_t before_seq, uint32_t sample_rate, uint32_t timestamp, uint64_t ntp_timestamp);
+    void sendRtpList(const RtspMediaSource::RingDataType &pkt);
+    // 根据估算带宽标记需要丢弃的rtp
+    void markDropRtp(const RtspMediaSource::RingDataType &pkt, uint32_t bitrate);
+    bool isNonReferenceFrame(const RtpPacket::Ptr &rtp) const;
 
 private:
     //媒体相关元数据
@@ -44,6 +75,36 @@ private:
 
     //播放rtsp源的reader对象
     RtspMediaSource::RingType::RingReader::Ptr _reader;
+
+    //视频编码类型，用于判断非参考帧
+    CodecId _video_codec = CodecInvalid;
+    //拥塞控制：按估算码率发放的发送令牌(字节)，小于0时丢弃非参考帧
+    int64_t _send_budget = 0;
+    Ticker _budget_ticker;
+    //严重拥塞时丢弃视频直至下一个关键帧
+    bool _wait_key_frame = false;
+    //当前视频帧是否丢弃
+    bool _drop_cur_frame = false;
+    bool _have_video_stamp = false;
+    uint32_t _video_stamp = 0;
+    std::vector<bool> _drop_flags;
+
+    //simulcast推流器，播放的不是rtc推流时为空
+    std::weak_ptr<WebRtcPusher> _simulcast_pusher;
+    //当前播放的simulcast层
+    std::string _cur_rid;
+    //指定播放的simulcast层，为空时按带宽估算自动切换
+    std::string _fixed_rid;
+    //切换中的目标层，收到其关键帧后替换_reader
+    std::string _next_rid;
+    std::weak_ptr<RtspMediaSource> _next_src;
+    RtspMediaSource::RingType::RingReader::Ptr _next_reader;
+    //升层需要带宽持续满足一段时间，避免频繁切换
+    bool _upgrade_pending = false;
+    Ticker _upgrade_ticker;
+    bool _skip_old_audio = false;
+    bool _have_audio_seq = false;
+    uint16_t _audio_seq = 0;
 };
 
 }// namespace mediakit
@@ -41,6 +41,11 @@ WebRtcPusher::WebRtcPusher(const EventPoller::Ptr &poller,
     CHECK(_push_src);
 }
 
+std::unordered_map<std::string, RtspMediaSource::Ptr> WebRtcPusher::getSimulcastSources() {
+    std::lock_guard<std::recursive_mutex> lock(_mtx);
+    return _push_src_sim;
+}
+
 bool WebRtcPusher::close(MediaSource &sender) {
     //此回调在其他线程触发
     string err = StrPrinter << "close media: " << sender.getUrl();
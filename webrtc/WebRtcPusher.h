@@ -22,6 +22,12 @@ public:
     static Ptr create(const EventPoller::Ptr &poller, const RtspMediaSource::Ptr &src,
                       const std::shared_ptr<void> &ownership, const MediaInfo &info, const ProtocolOption &option);
 
+    /**
+     * 获取simulcast推流各层的rtsp源，非simulcast推流时返回空
+     * 可在任意线程调用
+     */
+    std::unordered_map<std::string/*rid*/, RtspMediaSource::Ptr> getSimulcastSources();
+
 protected:
     ///////WebRtcTransportImp override///////
     void onStartWebRTC() override;
@@ -58,6 +58,12 @@ const string kMinBitrate = RTC_FIELD "min_bitrate";
 // 数据通道设置
 const string kDataChannelEcho = RTC_FIELD "datachannel_echo";
 
+// 是否开启基于twcc的发送端带宽估算，开启后播放器拥塞时将丢弃非参考帧或等待关键帧
+const string kSendSideBwe = RTC_FIELD "sendSideBwe";
+
+// 播放simulcast推流时是否根据带宽估算自动切换层
+const string kSimulcastAutoSwitch = RTC_FIELD "simulcastAutoSwitch";
+
 static onceToken token([]() {
     mINI::Instance()[kTimeOutSec] = 15;
     mINI::Instance()[kExternIP] = "";
@@ -70,6 +76,8 @@ static onceToken token([]() {
     mINI::Instance()[kMinBitrate] = 0;
 
     mINI::Instance()[kDataChannelEcho] = true;
+    mINI::Instance()[kSendSideBwe] = 0;
+    mINI::Instance()[kSimulcastAutoSwitch] = 1;
 });
 
 } // namespace RTC
@@ -129,6 +137,7 @@ WebRtcTransport::WebRtcTransport(const EventPoller::Ptr &poller) {
     static auto prefix = getServerPrefix();
     _identifier = prefix + to_string(++s_key);
     _packet_pool.setSize(64);
+    _arena_pool.setSize(8);
 }
 
 void WebRtcTransport::onCreate() {
@@ -469,16 +478,28 @@ void WebRtcTransport::inputSockData(char *buf, int len, RTC::TransportTuple *tup
     }
 }
 
+// 批量加密rtp时使用的内存块大小
+static constexpr size_t kSendArenaSize = 64 * 1024;
+
 void WebRtcTransport::sendRtpPacket(const char *buf, int len, bool flush, void *ctx) {
     if (_srtp_session_send) {
-        auto pkt = _packet_pool.obtain2();
-        // 预留rtx加入的两个字节
-        pkt->setCapacity((size_t)len + SRTP_MAX_TRAILER_LEN + 2);
-        memcpy(pkt->data(), buf, len);
-        onBeforeEncryptRtp(pkt->data(), len, ctx);
-        if (_srtp_session_send->EncryptRtp(reinterpret_cast<uint8_t *>(pkt->data()), &len)) {
-            pkt->setSize(len);
-            onSendSockData(std::move(pkt), flush);
+        // 预留rtx加入的两个字节与transport-cc扩展的8个字节
+        auto capacity = (size_t)len + SRTP_MAX_TRAILER_LEN + 2 + 8;
+        if (_send_arena && _send_arena.use_count() == 1) {
+            // 内存块中的rtp都已发送完毕，从头复用
+            _send_arena->reset(MAX(capacity, kSendArenaSize));
+        } else if (!_send_arena || !_send_arena->writable(capacity)) {
+            // rtp加密后连续存放在同一块内存中(跨flush复用直到写满)，避免每个rtp都申请内存；
+            // 写满的内存块在其中所有rtp发送完毕后回收到循环池
+            _send_arena = _arena_pool.obtain2();
+            _send_arena->reset(MAX(capacity, kSendArenaSize));
+        }
+        auto ptr = _send_arena->tail();
+        memcpy(ptr, buf, len);
+        onBeforeEncryptRtp(ptr, len, ctx);
+        if (_srtp_session_send->EncryptRtp(reinterpret_cast<uint8_t *>(ptr), &len)) {
+            // 别名构造，与内存块共享引用计数，不申请内存
+            onSendSockData(Buffer::Ptr(_send_arena, _send_arena->commit(len)), flush);
         }
     }
 }
@@ -520,6 +541,11 @@ void WebRtcTransportImp::onCreate() {
         getPoller());
 
     _twcc_ctx.setOnSendTwccCB([this](uint32_t ssrc, string fci) { onSendTwcc(ssrc, fci); });
+
+    GET_CONFIG(uint32_t, max_bitrate, Rtc::kMaxBitrate);
+    GET_CONFIG(uint32_t, min_bitrate, Rtc::kMinBitrate);
+    // 配置单位为kbps
+    _bwe.setBitrateRange(min_bitrate * 1000, max_bitrate * 1000);
 }
 
 void WebRtcTransportImp::OnDtlsTransportApplicationDataReceived(const RTC::DtlsTransport *dtlsTransport, const uint8_t *data, size_t len) {
@@ -565,6 +591,7 @@ void WebRtcTransportImp::onSendSockData(Buffer::Ptr buf, bool flush, RTC::Transp
     tuple->send(std::move(buf));
 
     if (flush) {
+        // linux下udp socket会通过sendmmsg一次性发送所有缓存的数据包
         tuple->flushAll();
     }
 }
@@ -962,12 +989,18 @@ void WebRtcTransportImp::onRtcp(const char *buf, size_t len) {
                 }
                 auto &track = it->second;
                 auto &fci = fb->getFci<FCI_NACK>();
-                track->nack_list.forEach(fci, [&](const RtpPacket::Ptr &rtp) {
-                    // rtp重传
-                    onSendRtp(rtp, true, true);
+                track->nack_list.forEach(fci, [&](const RtpPacket::Ptr &rtp, uint16_t seq) {
+                    // rtp重传，切换rtp源时重传缓存已清空，缓存中的rtp时间戳偏移与当前一致
+                    sendRtp(rtp, seq, rtp->getStamp() - track->rtp_stamp_offset, true, true);
                 });
                 break;
             }
+            case RTPFBType::RTCP_RTPFB_TWCC: {
+                // 播放器反馈的rtp接收情况，用于发送端带宽估算
+                RtcpFB *fb = (RtcpFB *)rtcp;
+                _bwe.onTwccFeedback(fb->getFci<FCI_TWCC>(), fb->getFciSize(), getCurrentMicrosecond());
+                break;
+            }
             default:
                 break;
             }
@@ -1128,18 +1161,67 @@ void WebRtcTransportImp::onSortedRtp(MediaTrack &track, const string &rid, RtpPa
 
 ///////////////////////////////////////////////////////////////////
 
+namespace {
+struct SendRtpContext {
+    bool rtx;
+    MediaTrack *track;
+    // 实际发送的rtp seq
+    uint16_t seq;
+    // 实际发送的rtp时间戳
+    uint32_t stamp;
+};
+} // namespace
+
 void WebRtcTransportImp::onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool rtx) {
     auto &track = _type_to_track[rtp->type];
     if (!track) {
         // 忽略，对方不支持该编码类型
         return;
     }
+    sendRtp(rtp, rtp->getSeq() - track->rtp_seq_offset, rtp->getStamp() - track->rtp_stamp_offset, flush, rtx);
+}
+
+void WebRtcTransportImp::onDropRtp(const RtpPacket::Ptr &rtp) {
+    auto &track = _type_to_track[rtp->type];
+    if (!track) {
+        return;
+    }
+    ++track->rtp_seq_offset;
+    ++_drop_rtp_count;
+}
+
+void WebRtcTransportImp::onChangeRtpSource(const RtpPacket::Ptr &first_rtp) {
+    auto &track = _type_to_track[first_rtp->type];
+    if (!track || !track->have_send_rtp) {
+        return;
+    }
+    // 两个rtp源的时间差，优先按ntp时间戳计算，无法计算时按25fps一帧计算
+    uint64_t diff_ms = 40;
+    if (track->last_send_ntp && first_rtp->ntp_stamp > track->last_send_ntp && first_rtp->ntp_stamp - track->last_send_ntp < 1000) {
+        diff_ms = first_rtp->ntp_stamp - track->last_send_ntp;
+    }
+    uint32_t next_stamp = track->last_send_stamp + (uint32_t)(diff_ms * first_rtp->sample_rate / 1000);
+    track->rtp_seq_offset = first_rtp->getSeq() - (uint16_t)(track->last_send_seq + 1);
+    track->rtp_stamp_offset = first_rtp->getStamp() - next_stamp;
+    // 缓存的rtp属于之前的rtp源，时间戳偏移不同，不再重传
+    track->nack_list.clear();
+}
+
+void WebRtcTransportImp::sendRtp(const RtpPacket::Ptr &rtp, uint16_t seq, uint32_t stamp, bool flush, bool rtx) {
+    auto &track = _type_to_track[rtp->type];
+    if (!track) {
+        return;
+    }
     if (!rtx) {
         // 统计rtp发送情况，好做sr汇报
         track->rtcp_context_send->onRtp(
-            rtp->getSeq(), rtp->getStamp(), rtp->ntp_stamp, rtp->sample_rate,
+            seq, stamp, rtp->ntp_stamp, rtp->sample_rate,
             rtp->size() - RtpPacket::kRtpTcpHeaderSize);
-        track->nack_list.pushBack(rtp);
+        track->nack_list.pushBack(rtp, seq);
+        track->have_send_rtp = true;
+        track->last_send_seq = seq;
+        track->last_send_stamp = stamp;
+        track->last_send_ntp = rtp->ntp_stamp;
 #if 0
         //此处模拟发送丢包
         if (rtp->type == TrackVideo && rtp->getSeq() % 100 == 0) {
@@ -1150,36 +1232,59 @@ void WebRtcTransportImp::onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool r
         // 发送rtx重传包
         // TraceL << "send rtx rtp:" << rtp->getSeq();
     }
-    pair<bool /*rtx*/, MediaTrack *> ctx { rtx, track.get() };
+    SendRtpContext ctx { rtx, track.get(), seq, stamp };
     sendRtpPacket(rtp->data() + RtpPacket::kRtpTcpHeaderSize, rtp->size() - RtpPacket::kRtpTcpHeaderSize, flush, &ctx);
     _bytes_usage += rtp->size() - RtpPacket::kRtpTcpHeaderSize;
 }
 
 void WebRtcTransportImp::onBeforeEncryptRtp(const char *buf, int &len, void *ctx) {
-    auto pr = (pair<bool /*rtx*/, MediaTrack *> *)ctx;
+    auto pr = (SendRtpContext *)ctx;
     auto header = (RtpHeader *)buf;
 
-    if (!pr->first || !pr->second->plan_rtx) {
-        // 普通的rtp,或者不支持rtx, 修改目标pt和ssrc
-        pr->second->rtp_ext_ctx->changeRtpExtId(header, false);
-        header->pt = pr->second->plan_rtp->pt;
-        header->ssrc = htonl(pr->second->answer_ssrc_rtp);
+    GET_CONFIG(bool, send_side_bwe, Rtc::kSendSideBwe);
+    auto twcc_ext = pr->track->rtp_ext_ctx->changeRtpExtId(header, false, nullptr, RtpExtType::transport_cc);
+    if (send_side_bwe) {
+        // 写入transport-cc序号，用于接收播放器的twcc反馈
+        auto twcc_ext_id = pr->track->rtp_ext_ctx->getExtId(RtpExtType::transport_cc);
+        if (twcc_ext_id) {
+            auto twcc_seq = _twcc_send_seq;
+            if (twcc_ext) {
+                twcc_ext.setTransportCCSeq(twcc_seq);
+                ++_twcc_send_seq;
+            } else if (auto size = RtpExt::appendTransportCCSeq(header, len, twcc_ext_id, twcc_seq)) {
+                len = size;
+                ++_twcc_send_seq;
+            }
+            if (twcc_seq != _twcc_send_seq) {
+                // rtx增加的2个字节忽略不计
+                _bwe.onSendRtp(twcc_seq, len, getCurrentMicrosecond());
+            }
+        }
+    }
+
+    // 切换rtp源后时间戳可能被修改
+    header->stamp = htonl(pr->stamp);
+    if (!pr->rtx || !pr->track->plan_rtx) {
+        // 普通的rtp,或者不支持rtx, 修改目标pt、ssrc和seq
+        header->pt = pr->track->plan_rtp->pt;
+        header->ssrc = htonl(pr->track->answer_ssrc_rtp);
+        header->seq = htons(pr->seq);
     } else {
         // 重传的rtp, rtx
-        pr->second->rtp_ext_ctx->changeRtpExtId(header, false);
-        header->pt = pr->second->plan_rtx->pt;
-        if (pr->second->answer_ssrc_rtx) {
+        header->pt = pr->track->plan_rtx->pt;
+        if (pr->track->answer_ssrc_rtx) {
             // 有rtx单独的ssrc,有些情况下，浏览器支持rtx，但是未指定rtx单独的ssrc
-            header->ssrc = htonl(pr->second->answer_ssrc_rtx);
+            header->ssrc = htonl(pr->track->answer_ssrc_rtx);
         } else {
             // 未单独指定rtx的ssrc，那么使用rtp的ssrc
-            header->ssrc = htonl(pr->second->answer_ssrc_rtp);
+            header->ssrc = htonl(pr->track->answer_ssrc_rtp);
         }
 
-        auto origin_seq = ntohs(header->seq);
+        // osn为原始rtp发送时的seq
+        auto origin_seq = pr->seq;
         // seq跟原来的不一样
-        header->seq = htons(_rtx_seq[pr->second->media->type]);
-        ++_rtx_seq[pr->second->media->type];
+        header->seq = htons(_rtx_seq[pr->track->media->type]);
+        ++_rtx_seq[pr->track->media->type];
 
         auto payload = header->getPayloadData();
         auto payload_size = header->getPayloadSize(len);
@@ -1224,6 +1329,19 @@ uint64_t WebRtcTransportImp::getDuration() const {
     return _alive_ticker.createdTime() / 1000;
 }
 
+uint32_t WebRtcTransportImp::getEstimatedBitrate() const {
+    GET_CONFIG(bool, send_side_bwe, Rtc::kSendSideBwe);
+    return send_side_bwe ? _bwe.getEstimatedBitrate() : 0;
+}
+
+const SendSideBwe &WebRtcTransportImp::getBwe() const {
+    return _bwe;
+}
+
+uint64_t WebRtcTransportImp::getDropRtpCount() const {
+    return _drop_rtp_count;
+}
+
 void WebRtcTransportImp::onRtcpBye(){}
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -23,6 +23,7 @@
 #include "Network/Session.h"
 #include "Nack.h"
 #include "TwccContext.h"
+#include "SendSideBwe.h"
 #include "SctpAssociation.hpp"
 #include "Rtcp/RtcpContext.h"
 
@@ -33,8 +34,69 @@ namespace Rtc {
 extern const std::string kPort;
 extern const std::string kTcpPort;
 extern const std::string kTimeOutSec;
+extern const std::string kSimulcastAutoSwitch;
 }//namespace RTC
 
+/**
+ * 加密后的rtp连续存放在该内存块中，写满后才更换内存块
+ * 各rtp的Buffer对象也预先分配在块内，通过shared_ptr别名构造共享内存块的引用计数，
+ * 所以发送时无需为每个rtp申请内存，块内所有rtp发送完毕后内存块回收到循环池
+ */
+class RtpSendArena {
+public:
+    using Ptr = std::shared_ptr<RtpSendArena>;
+    // 每个内存块最多存放的rtp个数
+    static constexpr size_t kMaxPackets = 128;
+
+    RtpSendArena() : _buffer(toolkit::BufferRaw::create()), _slices(kMaxPackets) {}
+
+    /**
+     * 开始新的批次
+     */
+    void reset(size_t capacity) {
+        _buffer->setCapacity(capacity);
+        _buffer->setSize(0);
+        _count = 0;
+    }
+
+    /**
+     * 是否还能存放长度为len的rtp
+     */
+    bool writable(size_t len) const { return _count < kMaxPackets && _buffer->getCapacity() - _buffer->size() >= len; }
+
+    /**
+     * 空闲内存的起始地址
+     */
+    char *tail() const { return _buffer->data() + _buffer->size(); }
+
+    /**
+     * 确认在tail()处写入了len字节，返回引用这段数据的Buffer对象，其生命周期由内存块管理
+     */
+    toolkit::Buffer *commit(size_t len) {
+        auto &slice = _slices[_count++];
+        slice._data = tail();
+        slice._size = len;
+        _buffer->setSize(_buffer->size() + len);
+        return &slice;
+    }
+
+private:
+    class Slice : public toolkit::Buffer {
+    public:
+        char *data() const override { return _data; }
+        size_t size() const override { return _size; }
+
+    public:
+        char *_data = nullptr;
+        size_t _size = 0;
+    };
+
+private:
+    size_t _count = 0;
+    toolkit::BufferRaw::Ptr _buffer;
+    std::vector<Slice> _slices;
+};
+
 class WebRtcInterface {
 public:
     virtual ~WebRtcInterface() = default;
@@ -184,6 +246,9 @@ private:
     Ticker _ticker;
     // 循环池
     ResourcePool<BufferRaw> _packet_pool;
+    // 当前rtp加密后存放的连续内存块及其循环池
+    RtpSendArena::Ptr _send_arena;
+    ResourcePool<RtpSendArena> _arena_pool;
 
 #ifdef ENABLE_SCTP
     RTC::SctpAssociationImp::Ptr _sctp;
@@ -206,6 +271,15 @@ public:
     //for send rtp
     NackList nack_list;
     RtcpContext::Ptr rtcp_context_send;
+    //拥塞丢弃的rtp个数，发送时seq减去该值，保证发送的seq连续
+    uint16_t rtp_seq_offset = 0;
+    //切换rtp源(simulcast层)后的时间戳偏移，发送时时间戳减去该值
+    uint32_t rtp_stamp_offset = 0;
+    //最后发送的rtp，用于切换rtp源时衔接seq与时间戳
+    bool have_send_rtp = false;
+    uint16_t last_send_seq = 0;
+    uint32_t last_send_stamp = 0;
+    uint64_t last_send_ntp = 0;
 
     //for recv rtp
     std::unordered_map<std::string/*rid*/, std::shared_ptr<RtpChannel> > rtp_channel;
@@ -247,6 +321,15 @@ public:
     bool canSendRtp() const;
     bool canRecvRtp() const;
     void onSendRtp(const RtpPacket::Ptr &rtp, bool flush, bool rtx = false);
+    //拥塞时丢弃rtp，后续发送的rtp seq保持连续
+    void onDropRtp(const RtpPacket::Ptr &rtp);
+    //切换rtp源(例如simulcast层)，后续发送的rtp seq与时间戳紧接已发送的rtp，播放器看到的是同一路连续的流
+    void onChangeRtpSource(const RtpPacket::Ptr &first_rtp);
+
+    //发送端带宽估算码率，单位bps，未开启或未收到twcc反馈时返回0
+    uint32_t getEstimatedBitrate() const;
+    const SendSideBwe &getBwe() const;
+    uint64_t getDropRtpCount() const;
 
     void createRtpChannel(const std::string &rid, uint32_t ssrc, MediaTrack &track);
     void removeTuple(RTC::TransportTuple* tuple);
@@ -281,6 +364,7 @@ private:
     void onSortedRtp(MediaTrack &track, const std::string &rid, RtpPacket::Ptr rtp);
     void onSendNack(MediaTrack &track, const FCI_NACK &nack, uint32_t ssrc);
     void onSendTwcc(uint32_t ssrc, const std::string &twcc_fci);
+    void sendRtp(const RtpPacket::Ptr &rtp, uint16_t seq, uint32_t stamp, bool flush, bool rtx);
 
     void registerSelf();
     void unregisterSelf();
@@ -302,6 +386,12 @@ private:
     Ticker _pli_ticker;
     //twcc rtcp发送上下文对象
     TwccContext _twcc_ctx;
+    //基于twcc反馈的发送端带宽估算
+    SendSideBwe _bwe;
+    //发送rtp时的transport-cc序号
+    uint16_t _twcc_send_seq = 0;
+    //拥塞丢弃的rtp个数
+    uint64_t _drop_rtp_count = 0;
     //根据发送rtp的track类型获取相关信息
     MediaTrack::Ptr _type_to_track[2];
     //根据rtcp的ssrc获取相关信息，收发rtp和rtx的ssrc都会记录